@@ -32,9 +32,16 @@
 #ifndef HUGGINGFACE_HUB_H
 #define HUGGINGFACE_HUB_H
 
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
 #include <stdint.h>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace huggingface_hub {
 /**
@@ -51,6 +58,64 @@ struct FileMetadata {
   std::string sha256; /**< SHA-256 hash of the file */
 };
 
+/**
+ * @struct FileListing
+ * @brief Compact metadata of many files of a repository.
+ *
+ * Entries are stored as parallel arrays: digests are kept in binary form,
+ * commit IDs are interned and every path lives in a single arena. An entry
+ * costs about 70 bytes plus its path, against several hundred bytes and
+ * four heap allocations for a FileMetadata.
+ */
+struct FileListing {
+  std::string path_arena;             /**< Every path, back to back */
+  std::vector<uint64_t> path_offsets; /**< Start of each path in the arena,
+                                           followed by the arena size */
+  std::vector<uint64_t> sizes;        /**< Size of each file in bytes */
+  std::vector<uint8_t> oids;          /**< 20-byte git object ID of each
+                                           file */
+  std::vector<uint8_t> sha256s;       /**< 32-byte SHA-256 of each file, all
+                                           zero if it is not stored in LFS */
+  std::vector<uint32_t> commit_ids;   /**< Index of each file's commit in
+                                           commits */
+  std::vector<uint8_t> commits;       /**< Interned 20-byte commit IDs, zero
+                                           when not listed */
+  /** Position in commits of each binary commit ID, used by add() */
+  std::unordered_map<std::string, uint32_t> commit_lookup;
+
+  /**
+   * @brief Get the number of files.
+   */
+  size_t size() const { return sizes.size(); }
+
+  /**
+   * @brief Get the path of a file, valid until the listing changes.
+   */
+  std::string_view path(size_t index) const;
+
+  /**
+   * @brief Check whether a file is stored in LFS.
+   */
+  bool is_lfs(size_t index) const;
+
+  /**
+   * @brief Expand a file into a FileMetadata for the single-file APIs.
+   */
+  FileMetadata metadata(size_t index) const;
+
+  /**
+   * @brief Find a file by path.
+   *
+   * @return The index of the file, or size() if it is not listed.
+   */
+  size_t find(std::string_view path) const;
+
+  /**
+   * @brief Append a file; malformed digests are stored as zeros.
+   */
+  void add(std::string_view path, const FileMetadata &metadata);
+};
+
 /**
  * @struct DownloadResult
  * @brief Structure to hold the result of a download operation.
@@ -59,10 +124,324 @@ struct FileMetadata {
  * file.
  */
 struct DownloadResult {
-  bool success;     /**< Indicates if the download was successful */
-  std::string path; /**< Path to the downloaded file */
+  bool success;                 /**< Indicates if the download was successful */
+  std::string path;             /**< Path to the downloaded file */
+  bool deadline_missed = false; /**< Failed because the deadline passed or
+                                     would have been missed */
+};
+
+/**
+ * @enum IpResolve
+ * @brief IP version preference used when resolving host names.
+ */
+enum class IpResolve {
+  ANY, /**< Use whatever the resolver returns */
+  V4,  /**< Only use IPv4 addresses */
+  V6   /**< Only use IPv6 addresses */
+};
+
+/**
+ * @struct TransportConfig
+ * @brief Connection tuning applied to every HTTP handle.
+ *
+ * A zero value leaves the corresponding curl or kernel default in place.
+ * Setting explicit socket buffer sizes disables the kernel autotuning of that
+ * buffer, so they are only worth setting on links where autotuning is known
+ * to be too conservative.
+ */
+struct TransportConfig {
+  long connect_timeout_ms = 10000; /**< Timeout of the connection phase */
+  long api_timeout_ms = 60000;     /**< Total timeout of API requests */
+  long total_timeout_ms = 0;       /**< Total timeout of blob transfers */
+  long low_speed_limit = 1024;     /**< Abort below this rate (bytes/s)... */
+  long low_speed_time = 30;        /**< ...sustained for this many seconds */
+  long receive_buffer_size = 0;    /**< curl receive buffer, capped at
+                                        CURL_MAX_READ_SIZE */
+  int socket_receive_buffer = 0;   /**< SO_RCVBUF of each socket */
+  int socket_send_buffer = 0;      /**< SO_SNDBUF of each socket */
+  bool tcp_nodelay = true;         /**< Disable Nagle's algorithm */
+  bool tcp_keepalive = true;       /**< Enable TCP keepalive probes */
+  long keepalive_idle = 60;        /**< Idle seconds before the first probe */
+  long keepalive_interval = 15;    /**< Seconds between keepalive probes */
+
+  IpResolve ip_resolve = IpResolve::ANY; /**< IP version preference */
+  std::string ca_bundle;                 /**< PEM file of the trusted CAs,
+                                              for mirrors behind a private
+                                              CA; curl's default if empty */
+
+  /**
+   * Hand TLS record encryption and decryption to the kernel (kTLS) when
+   * curl uses OpenSSL and both OpenSSL and the kernel support it. OpenSSL
+   * can only offload a socket BIO, which curl 7.87 and later no longer
+   * hands it, so with those versions this option does nothing. Whether a
+   * connection was offloaded is counted in KernelTlsStats.
+   */
+  bool kernel_tls = false;
+
+  /**
+   * @brief Preset for a local network or an in-rack cache server.
+   *
+   * Short timeouts and a high low-speed threshold so that a stalled peer is
+   * dropped quickly.
+   */
+  static TransportConfig lan();
+
+  /**
+   * @brief Preset for regular internet links to the Hub.
+   */
+  static TransportConfig wan();
+
+  /**
+   * @brief Preset for high bandwidth-delay product links.
+   *
+   * Large curl and socket buffers so that a single connection can fill a
+   * long fat pipe, with tolerant low-speed settings.
+   */
+  static TransportConfig high_bdp();
+};
+
+/**
+ * @brief Set the transport configuration used by every new HTTP handle.
+ *
+ * @param config The transport configuration.
+ */
+void set_transport_config(const TransportConfig &config);
+
+/**
+ * @brief Get the transport configuration used by new HTTP handles.
+ *
+ * @return A copy of the current transport configuration.
+ */
+TransportConfig get_transport_config();
+
+/**
+ * @struct PrewarmStats
+ * @brief Statistics about connection pre-warming.
+ */
+struct PrewarmStats {
+  size_t hosts_warmed = 0;       /**< Hosts with a warm pooled connection */
+  size_t hosts_failed = 0;       /**< Hosts that could not be reached */
+  double warmup_seconds = 0;     /**< DNS, TCP and TLS time spent in the
+                                      background while warming */
+  size_t connections_reused = 0; /**< Warm connections later reused */
+  double time_saved_seconds = 0; /**< Setup time those reuses avoided */
 };
 
+/**
+ * @brief Open pooled connections to the Hub hosts in the background.
+ *
+ * Resolves and connects (DNS, TCP and TLS) to the API host and the known CDN
+ * hosts while the application is initializing, and leaves the connections in
+ * the shared pool used by every request of the library. The first download
+ * then skips the connection setup. Returns immediately. The requests go
+ * through the transfer layer, so they are recorded and replayed like any
+ * other.
+ *
+ * @param hosts Host names to warm. Empty warms the endpoint (HF_ENDPOINT)
+ * and, for the public Hub, the known CDN hosts.
+ */
+void prewarm(const std::vector<std::string> &hosts = {});
+
+/**
+ * @brief Get the connection pre-warming statistics.
+ *
+ * @return A copy of the current statistics.
+ */
+PrewarmStats get_prewarm_stats();
+
+/**
+ * @struct ConnectionCacheConfig
+ * @brief Configuration of the connection state kept across restarts.
+ *
+ * When enabled, resolved addresses and TLS sessions are saved to
+ * `.connections` under the cache root and loaded when the configuration is
+ * set. The first requests of a new process then skip the DNS lookup and
+ * resume the TLS handshake. TLS sessions are only kept when curl is built
+ * with OpenSSL.
+ */
+struct ConnectionCacheConfig {
+  bool enabled = false; /**< Persist DNS entries and TLS sessions */
+  /** Cache root holding the `.connections` file */
+  std::string cache_dir = "~/.cache/huggingface/hub";
+  long dns_ttl_seconds = 300;      /**< Lifetime of a saved address */
+  long session_ttl_seconds = 7200; /**< Lifetime of a saved TLS session,
+                                        capped by the server lifetime */
+  bool early_data = false;         /**< Send idempotent GETs as TLS 1.3
+                                        early data, when curl supports it */
+};
+
+/**
+ * @struct ConnectionCacheStats
+ * @brief Statistics about the persisted connection state.
+ */
+struct ConnectionCacheStats {
+  size_t dns_entries_loaded = 0; /**< Addresses loaded from the file */
+  size_t sessions_loaded = 0;    /**< TLS sessions loaded from the file */
+  size_t lookups_skipped = 0;    /**< Connections that used a loaded
+                                      address */
+  size_t sessions_offered = 0;   /**< Handshakes offered a loaded session */
+  size_t handshakes_resumed = 0; /**< Handshakes that resumed a session */
+};
+
+/**
+ * @brief Set the connection cache configuration and load its file.
+ *
+ * @param config The connection cache configuration.
+ */
+void set_connection_cache_config(const ConnectionCacheConfig &config);
+
+/**
+ * @brief Get the connection cache configuration.
+ *
+ * @return A copy of the current configuration.
+ */
+ConnectionCacheConfig get_connection_cache_config();
+
+/**
+ * @brief Get the connection cache statistics.
+ *
+ * @return A copy of the current statistics.
+ */
+ConnectionCacheStats get_connection_cache_stats();
+
+/**
+ * @struct KernelTlsStats
+ * @brief Statistics about kernel TLS offload, see TransportConfig.
+ */
+struct KernelTlsStats {
+  size_t handshakes = 0;        /**< Handshakes with kTLS requested */
+  size_t receive_offloaded = 0; /**< Connections decrypted by the kernel */
+  size_t send_offloaded = 0;    /**< Connections encrypted by the kernel */
+};
+
+/**
+ * @brief Get the kernel TLS offload statistics.
+ *
+ * @return A copy of the current statistics.
+ */
+KernelTlsStats get_kernel_tls_stats();
+
+/**
+ * @struct HedgingConfig
+ * @brief Configuration of hedged API requests.
+ *
+ * When enabled, an API request that has not answered after a delay derived
+ * from the recent latency distribution is duplicated, either to another
+ * address of the API host or to a mirror, and the first successful answer is
+ * used. Hedges are budgeted both as a fraction of all requests and per second
+ * so that hedging cannot amplify the load on a struggling API.
+ */
+struct HedgingConfig {
+  bool enabled = false;             /**< Enable hedged API requests */
+  double percentile = 0.95;         /**< Latency percentile used as delay */
+  long initial_delay_ms = 500;      /**< Delay before latencies are known */
+  long min_delay_ms = 50;           /**< Lower bound of the hedging delay */
+  long max_delay_ms = 2000;         /**< Upper bound of the hedging delay */
+  double max_hedge_ratio = 0.1;     /**< Maximum hedges per request sent */
+  double max_hedges_per_second = 2; /**< Maximum hedges sent per second */
+  std::string mirror_endpoint;      /**< Endpoint receiving the hedges, empty
+                                         to hedge to another address of the
+                                         API host */
+};
+
+/**
+ * @struct HedgingStats
+ * @brief Counters of hedged API requests.
+ */
+struct HedgingStats {
+  uint64_t requests = 0;          /**< API requests sent */
+  uint64_t hedges_sent = 0;       /**< Hedges sent */
+  uint64_t hedges_won = 0;        /**< Hedges that answered first */
+  uint64_t hedges_suppressed = 0; /**< Hedges skipped by the rate limits */
+};
+
+/**
+ * @brief Set the hedging configuration of API requests.
+ *
+ * @param config The hedging configuration.
+ */
+void set_hedging_config(const HedgingConfig &config);
+
+/**
+ * @brief Get the hedging configuration of API requests.
+ *
+ * @return A copy of the current hedging configuration.
+ */
+HedgingConfig get_hedging_config();
+
+/**
+ * @brief Get the hedging counters.
+ *
+ * @return A copy of the current counters.
+ */
+HedgingStats get_hedging_stats();
+
+/**
+ * @struct ApiRateLimitConfig
+ * @brief Client-side rate limit of Hub API requests.
+ *
+ * API requests (metadata lookups) draw from a token bucket that is separate
+ * from blob transfers. A 429 answer pauses every API request for the
+ * Retry-After delay given by the server.
+ */
+struct ApiRateLimitConfig {
+  double requests_per_second = 0; /**< Sustained rate, 0 for no limit */
+  double burst = 10;              /**< Requests that can be sent at once */
+  int max_retries_on_429 = 3;     /**< Retries of a rate-limited request */
+};
+
+/**
+ * @struct MetadataCoalescingConfig
+ * @brief Coalescing of concurrent metadata requests.
+ *
+ * Metadata requests for the same repository and revision issued within the
+ * window are merged into a single paths-info call, and each caller receives
+ * the metadata of its own file.
+ */
+struct MetadataCoalescingConfig {
+  long window_ms = 0;     /**< Time a request waits for others, 0 disables */
+  size_t max_paths = 100; /**< Maximum number of paths per merged request */
+};
+
+/**
+ * @struct ApiStats
+ * @brief Counters of the API rate limiter and request coalescing.
+ */
+struct ApiStats {
+  uint64_t requests_throttled = 0;     /**< Requests delayed by the limiter */
+  double throttled_seconds = 0;        /**< Total delay added by the limiter */
+  uint64_t rate_limited_responses = 0; /**< 429 answers received */
+  uint64_t coalesced_paths = 0;        /**< Paths merged into another request */
+};
+
+/**
+ * @brief Set the client-side rate limit of API requests.
+ *
+ * @param config The rate limit configuration.
+ */
+void set_api_rate_limit_config(const ApiRateLimitConfig &config);
+
+/**
+ * @brief Get the client-side rate limit of API requests.
+ *
+ * @return A copy of the current rate limit configuration.
+ */
+ApiRateLimitConfig get_api_rate_limit_config();
+
+/**
+ * @brief Set the coalescing configuration of metadata requests.
+ *
+ * @param config The coalescing configuration.
+ */
+void set_metadata_coalescing_config(const MetadataCoalescingConfig &config);
+
+/**
+ * @brief Get the API rate limiter and coalescing counters.
+ *
+ * @return A copy of the current counters.
+ */
+ApiStats get_api_stats();
+
 /**
  * @brief Get metadata of a model file from Hugging Face Hub.
  *
@@ -77,6 +456,108 @@ struct DownloadResult {
 std::variant<struct FileMetadata, std::string>
 get_model_metadata_from_hf(const std::string &repo, const std::string &file);
 
+struct PatternAutomaton;
+
+/**
+ * @class PatternSet
+ * @brief Glob patterns compiled into a single automaton.
+ *
+ * `*` and `?` stop at slashes, `**` crosses them, `[...]` is a bracket
+ * expression and a leading `!` negates a pattern. Patterns without a slash
+ * match a name at any depth, and a pattern matching a directory matches
+ * every path below it. The last matching pattern decides whether a path is
+ * selected; when none matches, the path is selected only if every pattern is
+ * negated. Each path is matched in a single pass over its bytes. Copies
+ * share the automaton, which is safe to use from several threads.
+ */
+class PatternSet {
+public:
+  /**
+   * @brief Compile a pattern set; an empty set selects every path.
+   */
+  explicit PatternSet(const std::vector<std::string> &patterns = {});
+
+  /**
+   * @brief Build a set from allow and ignore lists.
+   *
+   * @param allow Patterns of the paths to select, every path if empty.
+   * @param ignore Patterns of the paths to drop, taking precedence.
+   */
+  static PatternSet from_filters(const std::vector<std::string> &allow,
+                                 const std::vector<std::string> &ignore);
+
+  /**
+   * @brief Check whether the set has no patterns.
+   */
+  bool empty() const { return !automaton_; }
+
+  /**
+   * @brief Check whether a path is selected.
+   */
+  bool matches(std::string_view path) const;
+
+  /**
+   * @brief Check whether any path below a directory may be selected.
+   *
+   * A false answer is exact, so the whole subtree can be skipped.
+   */
+  bool may_match_under(std::string_view directory) const;
+
+private:
+  std::shared_ptr<PatternAutomaton> automaton_;
+};
+
+/**
+ * @struct Deadline
+ * @brief Time by which a download call must return.
+ *
+ * The remaining budget caps the connect, stall and transfer timeouts of each
+ * request, and failed transfers are resumed while it lasts. The call fails
+ * early once the throughput measured so far shows that the bytes left cannot
+ * arrive in time. Files matching `priority` are downloaded first.
+ */
+struct Deadline {
+  /** Time the call must return by, the clock's epoch for no deadline */
+  std::chrono::steady_clock::time_point at{};
+  PatternSet priority; /**< Files the deadline depends on */
+
+  /**
+   * @brief A deadline a given budget from now.
+   */
+  static Deadline after(std::chrono::milliseconds budget,
+                        const PatternSet &priority = PatternSet());
+
+  /**
+   * @brief Check whether a deadline was set.
+   */
+  bool is_set() const {
+    return at != std::chrono::steady_clock::time_point();
+  }
+};
+
+/**
+ * @brief List the files of a repository revision.
+ *
+ * The tree API is walked one page at a time, and each page is folded into
+ * the compact listing before the next one is requested. Without a filter the
+ * tree is listed recursively; with one, directories are listed one by one
+ * and those in which no path can match are never requested.
+ *
+ * @param repo_id The repository ID.
+ * @param repo_type "model", "dataset" or "space".
+ * @param revision The branch, tag or commit to list.
+ * @param filter The patterns of the files to keep.
+ * @param with_commits Also fetch the last commit of every file, which the
+ *        Hub computes per entry and makes listing much slower.
+ * @return A variant containing either the FileListing or an error message.
+ */
+std::variant<FileListing, std::string>
+list_repo_files(const std::string &repo_id,
+                const std::string &repo_type = "model",
+                const std::string &revision = "main",
+                const PatternSet &filter = PatternSet(),
+                bool with_commits = false);
+
 /**
  * @brief Download a file from Hugging Face Hub.
  *
@@ -89,19 +570,23 @@ get_model_metadata_from_hf(const std::string &repo, const std::string &file);
  * "~/.cache/huggingface/hub".
  * @param force_download If true, forces the download even if the file already
  * exists in the cache.
+ * @param deadline The time by which the download must be done, none if unset.
  * @return A DownloadResult structure containing the success status and the path
  * of the downloaded file.
  */
 struct DownloadResult
 hf_hub_download(const std::string &repo_id, const std::string &filename,
                 const std::string &cache_dir = "~/.cache/huggingface/hub",
-                bool force_download = false, bool verbose = false);
+                bool force_download = false, bool verbose = false,
+                const Deadline &deadline = Deadline());
 
 /**
  * @brief Download a file from Hugging Face Hub.
  *
  * This function downloads a specified file from a given repository on the
- * Hugging Face Hub and saves it to the specified cache directory.
+ * Hugging Face Hub and saves it to the specified cache directory. Files named
+ * `<name>-<i>-of-<n>.<ext>` are downloaded with all their shards, several at
+ * a time. The header of each GGUF shard must give its place in the split.
  *
  * @param repo_id The repository ID.
  * @param filename The name of the file to download.
@@ -109,13 +594,951 @@ hf_hub_download(const std::string &repo_id, const std::string &filename,
  * "~/.cache/huggingface/hub".
  * @param force_download If true, forces the download even if the file already
  * exists in the cache.
+ * @param deadline The time by which every shard must be done, none if unset.
  * @return A DownloadResult structure containing the success status and the path
  * of the downloaded file.
  */
 struct DownloadResult hf_hub_download_with_shards(
     const std::string &repo_id, const std::string &filename,
     const std::string &cache_dir = "~/.cache/huggingface/hub",
-    bool force_download = false);
+    bool force_download = false, const Deadline &deadline = Deadline());
+
+/**
+ * @struct ReplayOptions
+ * @brief Options controlling how a recorded session is replayed.
+ */
+struct ReplayOptions {
+  double time_scale = 1.0; /**< Multiplier applied to the recorded timing.
+                                1.0 keeps the original timing, 0.1 replays ten
+                                times faster and 0 disables all delays */
+  bool preload = true;     /**< Load every body in memory instead of reading
+                                them from the cassette file on demand */
+};
+
+/**
+ * @brief Start recording every HTTP exchange to a cassette file.
+ *
+ * Request and response metadata, response headers, timing samples and
+ * response bodies are appended to the cassette as each exchange completes.
+ * Bodies larger than max_body_bytes are truncated; the original size and
+ * timing are still recorded so a replay delivers the same number of bytes.
+ *
+ * @param cassette_path Path of the cassette file, overwritten if it exists.
+ * @param max_body_bytes Maximum number of body bytes stored per exchange.
+ * @return True if the cassette could be opened.
+ */
+bool start_session_recording(const std::string &cassette_path,
+                             uint64_t max_body_bytes = UINT64_MAX);
+
+/**
+ * @brief Stop recording and close the cassette file.
+ */
+void stop_session_recording();
+
+/**
+ * @brief Serve every HTTP exchange from a recorded cassette.
+ *
+ * While replay is active no request reaches the network. Identical requests
+ * are served in recording order and wrap around once exhausted. Truncated
+ * bodies are padded with zero bytes up to their original size.
+ *
+ * @param cassette_path Path of a cassette written by start_session_recording.
+ * @param options Replay timing and loading options.
+ * @return True if the cassette could be loaded.
+ */
+bool start_session_replay(const std::string &cassette_path,
+                          const ReplayOptions &options = ReplayOptions());
+
+/**
+ * @brief Stop replaying and go back to the network.
+ */
+void stop_session_replay();
+
+/**
+ * @struct UploadFile
+ * @brief A local file to upload and its destination in the repository.
+ */
+struct UploadFile {
+  std::string local_path;   /**< Path of the local file */
+  std::string path_in_repo; /**< Destination path in the repository */
+};
+
+/**
+ * @struct UploadOptions
+ * @brief Options of an upload.
+ */
+struct UploadOptions {
+  std::string repo_type = "model"; /**< "model", "dataset" or "space" */
+  std::string revision = "main";   /**< Branch to commit to */
+  std::string commit_message = "Upload files with huggingface-hub-cpp";
+  std::string commit_description; /**< Extended commit description */
+  int parallel_parts = 8;         /**< Files hashed or parts uploaded at
+                                       once */
+  int max_retries = 3;            /**< Retries of each uploaded part */
+  std::string cache_dir;          /**< Cache seeded with the new commit, if
+                                       not empty; refs/ moves to it once
+                                       every file of it is cached */
+};
+
+/**
+ * @struct UploadResult
+ * @brief Result of an upload.
+ */
+struct UploadResult {
+  bool success;                  /**< Indicates if the commit was created */
+  std::string commit_oid;        /**< Hash of the new commit */
+  std::string error;             /**< Error message on failure */
+  size_t files_uploaded = 0;     /**< LFS files sent to the storage */
+  size_t files_deduplicated = 0; /**< LFS files the Hub already had */
+  uint64_t bytes_uploaded = 0;   /**< Bytes of LFS files sent */
+};
+
+/**
+ * @brief Upload files to a repository in a single commit.
+ *
+ * Files are hashed with SHA-256 through mmap, and the preupload endpoint
+ * decides which ones are stored through LFS. The LFS batch endpoint skips
+ * blobs that the Hub already stores, and large blobs are sent as multipart
+ * uploads with parts sent in parallel and retried individually. Regular files
+ * are inlined in the commit. The Hub endpoint can be pointed at a local mock
+ * server with the HF_ENDPOINT variable.
+ *
+ * @param repo_id The repository ID.
+ * @param files The files to upload.
+ * @param options The upload options.
+ * @return An UploadResult structure with the new commit hash.
+ */
+UploadResult upload_files(const std::string &repo_id,
+                          const std::vector<UploadFile> &files,
+                          const UploadOptions &options = UploadOptions());
+
+/**
+ * @enum CommitOperationType
+ * @brief Kind of change made by a commit operation.
+ */
+enum class CommitOperationType {
+  ADD,           /**< Add or replace a file */
+  DELETE_FILE,   /**< Delete a file */
+  DELETE_FOLDER, /**< Delete a folder and everything under it */
+  COPY           /**< Copy a file already stored in the repository */
+};
+
+/**
+ * @struct CommitOperation
+ * @brief A single change of a batched commit.
+ */
+struct CommitOperation {
+  CommitOperationType type = CommitOperationType::ADD; /**< Kind of change */
+  std::string path_in_repo; /**< Path changed in the repository */
+  std::string local_path;   /**< File added, if content is empty */
+  std::string content;      /**< Bytes added instead of a local file */
+  std::string src_path;     /**< Source path of a copy */
+  std::string src_revision; /**< Source revision of a copy, the commit
+                                 revision if empty */
+
+  static CommitOperation add_file(const std::string &local_path,
+                                  const std::string &path_in_repo);
+  static CommitOperation add_bytes(const std::string &content,
+                                   const std::string &path_in_repo);
+  static CommitOperation delete_file(const std::string &path_in_repo);
+  static CommitOperation delete_folder(const std::string &path_in_repo);
+  static CommitOperation copy_file(const std::string &src_path,
+                                   const std::string &path_in_repo,
+                                   const std::string &src_revision = "");
+};
+
+/**
+ * @brief Create a single commit from a batch of operations.
+ *
+ * Added files go through the same preupload and LFS path as upload_files().
+ * Regular files are base64-encoded into the NDJSON commit payload while it is
+ * being sent, so the payload is never held in memory as a whole. Copies of
+ * LFS files reuse the stored blob and copies of regular files are inlined.
+ * When options.cache_dir is set, refs/<revision> is pointed at the new commit
+ * and the added LFS files are linked into its snapshot.
+ *
+ * @param repo_id The repository ID.
+ * @param operations The changes of the commit, applied in order.
+ * @param options The upload options.
+ * @return An UploadResult structure with the new commit hash.
+ */
+UploadResult create_commit(const std::string &repo_id,
+                           const std::vector<CommitOperation> &operations,
+                           const UploadOptions &options = UploadOptions());
+
+/**
+ * @struct DiskSpaceConfig
+ * @brief Admission control of downloads against the free space of the cache.
+ */
+struct DiskSpaceConfig {
+  bool enabled = false;               /**< Reserve space before each download */
+  bool cross_process = false;         /**< Share the ledger with other processes
+                                           through a file in the cache root */
+  uint64_t min_free_bytes = 0;        /**< Space always left free */
+  long wait_timeout_ms = 0;           /**< Time a download waits for space, 0
+                                           fails at once */
+  bool gc_unreferenced = false;       /**< Delete blobs no snapshot links
+                                           to when space is short */
+  uint64_t gc_min_age_seconds = 3600; /**< Only blobs untouched for this
+                                           long are collected */
+  /** Extra cleanup run when space is short; gets the cache root and the
+      missing bytes, and returns the bytes it freed */
+  std::function<uint64_t(const std::string &, uint64_t)> gc_callback;
+};
+
+/**
+ * @struct DiskSpaceStats
+ * @brief Counters of the disk space ledger.
+ */
+struct DiskSpaceStats {
+  uint64_t reserved_bytes = 0;      /**< Bytes held by this process */
+  uint64_t active_reservations = 0; /**< Downloads holding space */
+  uint64_t admissions = 0;          /**< Downloads admitted */
+  uint64_t admissions_delayed = 0;  /**< Downloads that waited for space */
+  uint64_t admissions_refused = 0;  /**< Downloads refused for lack of space */
+  uint64_t gc_runs = 0;             /**< Cleanups run to make room */
+  uint64_t gc_freed_bytes = 0;      /**< Bytes freed by those cleanups */
+};
+
+/**
+ * @brief Set the disk space admission control of downloads.
+ *
+ * Each download reserves the bytes it still has to write in a ledger keyed
+ * on the cache root, and is only admitted if that fits in the free space
+ * left by the other reservations. Reservations count down as their partial
+ * files grow.
+ *
+ * @param config The disk space configuration.
+ */
+void set_disk_space_config(const DiskSpaceConfig &config);
+
+/**
+ * @brief Get the disk space admission control of downloads.
+ *
+ * @return A copy of the current disk space configuration.
+ */
+DiskSpaceConfig get_disk_space_config();
+
+/**
+ * @brief Get the disk space ledger counters.
+ *
+ * @return A copy of the current counters.
+ */
+DiskSpaceStats get_disk_space_stats();
+
+/**
+ * @enum DurabilityMode
+ * @brief What a finished download makes durable before it is used.
+ */
+enum class DurabilityMode {
+  NONE, /**< Leave everything to the page cache */
+  BLOB, /**< Sync blob contents before they are renamed into place */
+  FULL  /**< Also sync refs and the directories holding blobs and links */
+};
+
+/**
+ * @struct DurabilityConfig
+ * @brief Durability of the files written to the cache.
+ */
+struct DurabilityConfig {
+  DurabilityMode mode = DurabilityMode::NONE; /**< What is synced */
+  /** Dirty bytes of a blob handed to the kernel writeback at once */
+  uint64_t write_behind_bytes = 8 * 1024 * 1024;
+};
+
+/**
+ * @brief Set the durability of the files written to the cache.
+ *
+ * Outside NONE, blob data is handed to the kernel writeback while it is
+ * downloaded, so the fsync at the end only waits for the last window.
+ *
+ * @param config The durability configuration.
+ */
+void set_durability_config(const DurabilityConfig &config);
+
+/**
+ * @brief Get the durability of the files written to the cache.
+ *
+ * @return A copy of the current durability configuration.
+ */
+DurabilityConfig get_durability_config();
+
+struct CacheViewState;
+
+/**
+ * @class CacheView
+ * @brief In-memory view of the model cache kept current with inotify.
+ *
+ * After start() scans the cache once, the refs/, snapshots/ and blobs/
+ * folders of every model are watched and the view tracks which files of
+ * which revision are complete. Lookups only read the in-memory maps and
+ * never touch the file system. A snapshot file counts as complete once the
+ * blob it links to exists.
+ */
+class CacheView {
+public:
+  /**
+   * @brief Callback run on the watcher thread with the repository and the
+   * commit that became complete.
+   */
+  typedef std::function<void(const std::string &repo_id,
+                             const std::string &commit)>
+      Callback;
+
+  explicit CacheView(const std::string &cache_dir = "~/.cache/huggingface/hub");
+  ~CacheView();
+  CacheView(const CacheView &) = delete;
+  CacheView &operator=(const CacheView &) = delete;
+
+  /**
+   * @brief Scan the cache and start watching it.
+   *
+   * @return False if inotify could not be set up.
+   */
+  bool start();
+
+  /**
+   * @brief Stop watching; the view keeps its last state.
+   */
+  void stop();
+
+  /**
+   * @brief Get the snapshot path of a complete file.
+   *
+   * @param repo_id The repository ID.
+   * @param filename The path of the file in the repository.
+   * @param revision A ref name such as "main", or a commit hash.
+   * @return The path, or an empty string if the file is not complete.
+   */
+  std::string resolve(const std::string &repo_id, const std::string &filename,
+                      const std::string &revision = "main") const;
+
+  /**
+   * @brief List the complete files of a revision.
+   */
+  std::vector<std::string> files(const std::string &repo_id,
+                                 const std::string &revision = "main") const;
+
+  /**
+   * @brief Run a callback once every listed file of a revision is complete.
+   *
+   * The callback runs immediately if the files are already complete, and at
+   * most once. With no files, any complete file of the revision is enough.
+   *
+   * @return An ID for unsubscribe().
+   */
+  size_t subscribe(const std::string &repo_id,
+                   const std::vector<std::string> &files, Callback callback,
+                   const std::string &revision = "main");
+
+  /**
+   * @brief Cancel a subscription that has not fired yet.
+   */
+  void unsubscribe(size_t id);
+
+private:
+  std::unique_ptr<CacheViewState> state_;
+};
+
+/**
+ * @brief Download the files of a model repository selected by a filter.
+ *
+ * The main branch is resolved to a commit and every file is linked under
+ * snapshots/<commit>. Links are staged in a hidden directory and published
+ * with renames, then `snapshots/<commit>.complete` is written listing every
+ * file published so far, so readers never see a half-filled snapshot.
+ *
+ * @param repo_id The repository ID.
+ * @param filter The patterns of the files to download, every file if empty.
+ * @param cache_dir The directory to cache the downloaded files.
+ * @param force_download If true, forces the download even if the files
+ * already exist in the cache.
+ * @param deadline The time by which the snapshot must be published, none if
+ * unset. Files matching its priority patterns are downloaded first.
+ * @return A DownloadResult structure whose path is the snapshot directory.
+ */
+struct DownloadResult
+snapshot_download(const std::string &repo_id,
+                  const PatternSet &filter = PatternSet(),
+                  const std::string &cache_dir = "~/.cache/huggingface/hub",
+                  bool force_download = false,
+                  const Deadline &deadline = Deadline());
+
+/**
+ * @brief Check the completion marker of a snapshot without locking.
+ *
+ * @param snapshot_path The snapshot directory returned by
+ * snapshot_download().
+ * @param files The files that must be published, none to only check that
+ * the snapshot was published.
+ * @return True if the marker exists and lists every file.
+ */
+bool is_snapshot_complete(const std::string &snapshot_path,
+                          const std::vector<std::string> &files = {});
+
+/**
+ * @struct WarmOptions
+ * @brief Options of a page cache warm-up.
+ */
+struct WarmOptions {
+  /** Cache holding the snapshot */
+  std::string cache_dir = "~/.cache/huggingface/hub";
+  int parallel_reads = 16;           /**< Chunks read at once */
+  uint64_t chunk_size = 16ULL << 20; /**< Bytes queued by each read */
+  uint64_t memory_budget = 0;        /**< Bytes to warm at most, the physical
+                                          memory size if 0 */
+};
+
+/**
+ * @struct WarmResult
+ * @brief Result of a page cache warm-up.
+ */
+struct WarmResult {
+  bool success;                    /**< Indicates if every file was cached */
+  size_t files_warmed = 0;         /**< Blobs read into the page cache */
+  size_t files_missing = 0;        /**< Files absent from the cache */
+  uint64_t bytes_warmed = 0;       /**< Bytes read into the page cache */
+  bool budget_reached = false;     /**< Indicates if the budget cut reads */
+  double seconds = 0;              /**< Time spent reading */
+  double gigabytes_per_second = 0; /**< Read throughput */
+};
+
+/**
+ * @brief Read the cached blobs of a model into the page cache.
+ *
+ * Blobs are split into chunks that are queued with readahead() from
+ * parallel threads, interleaving the devices they live on, so a restarted
+ * node loads a model from memory instead of cold disk reads.
+ *
+ * @param repo_id The repository ID.
+ * @param revision The branch or commit of the cached snapshot.
+ * @param files The files to warm, every file of the snapshot if empty.
+ * @param options The warm-up options.
+ * @return A WarmResult structure with the bytes read and the throughput.
+ */
+WarmResult warm(const std::string &repo_id,
+                const std::string &revision = "main",
+                const std::vector<std::string> &files = {},
+                const WarmOptions &options = WarmOptions());
+
+/**
+ * @enum TransferState
+ * @brief Stage of an in-flight download.
+ */
+enum class TransferState {
+  METADATA,    /**< Resolving the file on the Hub */
+  CONNECTING,  /**< Waiting for the first bytes */
+  DOWNLOADING, /**< Receiving the blob */
+  VERIFYING,   /**< Checking and syncing the received blob */
+  PUBLISHING   /**< Moving the blob and its links into the cache */
+};
+
+/**
+ * @struct TransferInfo
+ * @brief Snapshot of an in-flight download.
+ */
+struct TransferInfo {
+  uint64_t id = 0;             /**< Identifier, stable while in flight */
+  std::string repo_id;         /**< Repository of the file */
+  std::string filename;        /**< Path of the file in the repository */
+  TransferState state;         /**< Current stage */
+  uint64_t bytes_done = 0;     /**< Bytes of the blob on disk */
+  uint64_t bytes_total = 0;    /**< Size of the blob, 0 if not known yet */
+  double bytes_per_second = 0; /**< Rate over the last second or so */
+  int connections = 0;         /**< Open connections of the transfer */
+  int retries = 0;             /**< Attempts that were started again */
+  double age_seconds = 0;      /**< Time since the transfer started */
+};
+
+/**
+ * @brief List the downloads in flight in this process.
+ *
+ * Thread-safe and cheap enough to be polled every second, e.g. from a
+ * health endpoint.
+ *
+ * @return One entry per in-flight download, oldest first.
+ */
+std::vector<TransferInfo> get_active_transfers();
+
+/**
+ * @struct MemoryCacheConfig
+ * @brief Configuration of the in-process cache of small files.
+ */
+struct MemoryCacheConfig {
+  bool enabled = false;                /**< Keep small files in memory */
+  uint64_t max_bytes = 64ULL << 20;    /**< Bytes kept at most */
+  uint64_t max_file_size = 4ULL << 20; /**< Larger files are not kept */
+};
+
+/**
+ * @struct MemoryCacheStats
+ * @brief Statistics of the in-process cache of small files.
+ */
+struct MemoryCacheStats {
+  size_t hits = 0;      /**< Reads answered from memory */
+  size_t misses = 0;    /**< Reads that went to the disk or the Hub */
+  size_t entries = 0;   /**< Blobs kept in memory */
+  uint64_t bytes = 0;   /**< Bytes kept in memory */
+  size_t evictions = 0; /**< Blobs dropped to stay within the budget */
+};
+
+/**
+ * @brief Set the configuration of the in-process cache of small files.
+ *
+ * Disabling the cache or lowering its budget drops the files over it.
+ *
+ * @param config The memory cache configuration.
+ */
+void set_memory_cache_config(const MemoryCacheConfig &config);
+
+/**
+ * @brief Get the configuration of the in-process cache of small files.
+ *
+ * @return A copy of the current configuration.
+ */
+MemoryCacheConfig get_memory_cache_config();
+
+/**
+ * @brief Get the statistics of the in-process cache of small files.
+ *
+ * @return A copy of the current statistics.
+ */
+MemoryCacheStats get_memory_cache_stats();
+
+/**
+ * @brief Drop every file kept by the in-process cache.
+ */
+void clear_memory_cache();
+
+/**
+ * @brief Read a file of a repository into an immutable shared buffer.
+ *
+ * Files kept by the in-process cache are answered without any file system or
+ * network operation. Otherwise the file is read from the disk cache, after
+ * downloading it with hf_hub_download() if it is missing, and kept in memory
+ * when it is under MemoryCacheConfig::max_file_size. While the cache is
+ * enabled, larger files are refused with an error instead of being read.
+ * Entries are keyed by blob hash, so identical files of several repositories
+ * share a buffer.
+ *
+ * @param repo_id The repository ID.
+ * @param filename The file to read.
+ * @param cache_dir The directory of the disk cache.
+ * @param revision The branch or commit to read the file from. Only main is
+ * downloaded when the file is missing from the disk cache.
+ * @return The file contents, or an error message.
+ */
+std::variant<std::shared_ptr<const std::string>, std::string>
+read_cached_file(const std::string &repo_id, const std::string &filename,
+                 const std::string &cache_dir = "~/.cache/huggingface/hub",
+                 const std::string &revision = "main");
+
+/**
+ * @struct ByteplaneConfig
+ * @brief Configuration of the byte-plane transport encoding.
+ *
+ * A LAN cache server or mirror can send blobs split into byte planes (all
+ * first bytes of each element, then all second bytes...) and compressed
+ * with zstd in independent frames, which shrinks bf16 and fp16 weights whose
+ * exponent bytes repeat. Blobs are asked for with `X-Byteplane-Accept: zstd`
+ * and decoded while they are written when the answer carries
+ * `X-Byteplane-Encoding: zstd`. Servers that ignore the header send the raw
+ * blob. Only available when the library is built with zstd.
+ */
+struct ByteplaneConfig {
+  bool enabled = false; /**< Ask servers for byte-plane encoded blobs */
+};
+
+/**
+ * @struct ByteplaneStats
+ * @brief Statistics of the byte-plane transport encoding.
+ */
+struct ByteplaneStats {
+  size_t blobs_decoded = 0;   /**< Blobs received encoded */
+  size_t blobs_rejected = 0;  /**< Encoded blobs that failed to decode or
+                                   did not match their SHA-256 */
+  uint64_t wire_bytes = 0;    /**< Encoded bytes received */
+  uint64_t decoded_bytes = 0; /**< Bytes written after decoding */
+};
+
+/**
+ * @brief Set the byte-plane transport encoding configuration.
+ *
+ * @param config The byte-plane configuration.
+ */
+void set_byteplane_config(const ByteplaneConfig &config);
+
+/**
+ * @brief Get the byte-plane transport encoding configuration.
+ *
+ * @return A copy of the current configuration.
+ */
+ByteplaneConfig get_byteplane_config();
+
+/**
+ * @brief Get the byte-plane transport encoding statistics.
+ *
+ * @return A copy of the current statistics.
+ */
+ByteplaneStats get_byteplane_stats();
+
+/**
+ * @brief Encode a blob for the byte-plane transport, as a mirror serves it.
+ *
+ * The blob is cut into 4 MiB chunks that are split and compressed on
+ * several threads, each into its own frame.
+ *
+ * @param input_path The blob to encode.
+ * @param output_path The file receiving the encoded stream.
+ * @param element_size Bytes per element, 2 for bf16 and fp16, 4 for fp32.
+ * @param threads Chunks compressed at once, the number of cores if 0.
+ * @param level The zstd compression level.
+ * @return True on success, false on error or without zstd support.
+ */
+bool encode_byte_planes(const std::string &input_path,
+                        const std::string &output_path, int element_size = 2,
+                        int threads = 0, int level = 3);
+
+/**
+ * @brief Files of a snapshot, mapped to the name of their blob.
+ */
+typedef std::map<std::string, std::string> SnapshotManifest;
+
+/**
+ * @class StorageBackend
+ * @brief Storage of the cache contents: blobs, refs and snapshot manifests.
+ *
+ * Blobs are named as in the cache layout, by SHA-256 for LFS files and by
+ * git object ID otherwise. Implementations must be safe to call from
+ * several threads.
+ */
+class StorageBackend {
+public:
+  virtual ~StorageBackend() = default;
+
+  /**
+   * @brief Store a local file as a blob of a repository.
+   */
+  virtual bool put_blob(const std::string &repo_id, const std::string &blob,
+                        const std::string &local_path) = 0;
+
+  /**
+   * @brief Copy a blob into a local file, replacing it.
+   */
+  virtual bool get_blob(const std::string &repo_id, const std::string &blob,
+                        const std::string &local_path) = 0;
+
+  /**
+   * @brief Read a byte range of a blob.
+   */
+  virtual bool read_blob_range(const std::string &repo_id,
+                               const std::string &blob, uint64_t offset,
+                               uint64_t length, std::string &data) = 0;
+
+  /**
+   * @brief Check whether a blob is stored.
+   *
+   * @param size Receives the blob size when not null.
+   */
+  virtual bool stat_blob(const std::string &repo_id, const std::string &blob,
+                         uint64_t *size = nullptr) = 0;
+
+  /**
+   * @brief Read the commit a ref points at, empty if the ref is missing.
+   */
+  virtual std::string read_ref(const std::string &repo_id,
+                               const std::string &ref) = 0;
+
+  /**
+   * @brief Point a ref at a commit.
+   */
+  virtual bool write_ref(const std::string &repo_id, const std::string &ref,
+                         const std::string &commit) = 0;
+
+  /**
+   * @brief Read the files of a snapshot, false if it is not stored.
+   */
+  virtual bool read_manifest(const std::string &repo_id,
+                             const std::string &commit,
+                             SnapshotManifest &manifest) = 0;
+
+  /**
+   * @brief Record the files of a snapshot, whose blobs are already stored.
+   */
+  virtual bool write_manifest(const std::string &repo_id,
+                              const std::string &commit,
+                              const SnapshotManifest &manifest) = 0;
+
+  /**
+   * @brief Add files to the manifest of a snapshot, keeping those that
+   * other writers stored.
+   *
+   * The default reads, merges and writes the manifest, which loses files
+   * when two writers merge at once. Backends shared between machines
+   * override it with an atomic update.
+   */
+  virtual bool merge_manifest(const std::string &repo_id,
+                              const std::string &commit,
+                              const SnapshotManifest &files);
+};
+
+/**
+ * @brief Create a backend storing the cache in a local or mounted folder,
+ * with the same layout as the download cache.
+ *
+ * @param cache_dir The cache folder.
+ * @return The backend.
+ */
+std::shared_ptr<StorageBackend>
+create_posix_storage(const std::string &cache_dir = "~/.cache/huggingface/hub");
+
+/**
+ * @struct ObjectStoreConfig
+ * @brief Location and credentials of an S3-compatible bucket.
+ *
+ * Objects are addressed in path style, `<endpoint>/<bucket>/<key>`, which
+ * S3, MinIO and most compatible stores accept. Keys follow the cache layout
+ * below the prefix, with manifests stored as
+ * `<repo folder>/snapshots/<commit>.manifest`.
+ */
+struct ObjectStoreConfig {
+  /** Store URL, e.g. "https://s3.us-east-1.amazonaws.com" */
+  std::string endpoint;
+  std::string bucket;                    /**< Bucket name */
+  std::string prefix;                    /**< Key prefix, e.g. "hub/" */
+  std::string region = "us-east-1";      /**< Region used for signing */
+  std::string access_key;                /**< AWS_ACCESS_KEY_ID if empty */
+  std::string secret_key;                /**< AWS_SECRET_ACCESS_KEY if empty */
+  uint64_t part_size = 64 * 1024 * 1024; /**< Bytes per multipart part and
+                                              per ranged get */
+  int parallel_parts = 8;                /**< Parts transferred at once */
+};
+
+/**
+ * @brief Create a backend storing the cache in an S3-compatible bucket.
+ *
+ * Blobs larger than a part are uploaded with parallel multipart puts and
+ * downloaded with parallel ranged gets.
+ *
+ * @param config The bucket configuration.
+ * @return The backend.
+ */
+std::shared_ptr<StorageBackend>
+create_object_storage(const ObjectStoreConfig &config);
+
+/**
+ * @brief Share downloads through a storage backend, or stop if null.
+ *
+ * Blobs are fetched from the shared storage before the Hub is asked for
+ * them, and blobs, refs and snapshot manifests downloaded from the Hub are
+ * stored there, so nodes without a shared filesystem share one cache.
+ *
+ * @param storage The shared storage.
+ */
+void set_shared_storage(std::shared_ptr<StorageBackend> storage);
+
+/**
+ * @brief Get the shared storage, null if downloads are not shared.
+ */
+std::shared_ptr<StorageBackend> get_shared_storage();
+
+/**
+ * @struct SharedStorageStats
+ * @brief Statistics of the shared storage tier.
+ */
+struct SharedStorageStats {
+  size_t blobs_fetched = 0;     /**< Blobs copied from the shared storage */
+  size_t blobs_published = 0;   /**< Blobs copied to the shared storage */
+  size_t failures = 0;          /**< Shared storage operations that failed */
+  uint64_t bytes_fetched = 0;   /**< Bytes copied from the shared storage */
+  uint64_t bytes_published = 0; /**< Bytes copied to the shared storage */
+};
+
+/**
+ * @brief Get the shared storage statistics.
+ *
+ * @return A copy of the current statistics.
+ */
+SharedStorageStats get_shared_storage_stats();
+
+/**
+ * @struct SwarmConfig
+ * @brief Configuration of the peer-to-peer chunk swarm.
+ *
+ * In swarm mode LFS blobs are downloaded in fixed-size chunks. A chunk is
+ * fetched from a peer only once its SHA-256 is trusted: listed by the peers
+ * holding the whole verified blob, or, while there are none, by at least
+ * min_agreeing_peers peers. The other chunks are fetched from the origin
+ * with ranged requests. Completed chunks are served to peers over HTTP
+ * while the rest of the blob downloads, and the whole blob is checked
+ * against its SHA-256 before it is published. Every node of a swarm must
+ * use the same chunk size.
+ */
+struct SwarmConfig {
+  bool enabled = false; /**< Download LFS blobs through the swarm */
+  int listen_port = 0;  /**< Port serving chunks to peers, 0 not to serve */
+  /** Address peers use to reach this node */
+  std::string advertise_host = "127.0.0.1";
+  std::vector<std::string> peers; /**< Static peers, as "host:port" */
+  /** Tracker listing the peers, as "host:port", empty for none */
+  std::string tracker;
+  uint64_t chunk_size = 16 * 1024 * 1024; /**< Bytes per chunk */
+  int parallel_chunks = 8;                /**< Chunks fetched at once */
+  /** Peers that must list the same chunk hash while no peer holds the
+      verified blob; 1 trusts any single peer */
+  int min_agreeing_peers = 2;
+};
+
+/**
+ * @struct SwarmStats
+ * @brief Statistics of the peer-to-peer chunk swarm.
+ */
+struct SwarmStats {
+  size_t chunks_from_peers = 0;   /**< Chunks fetched from peers */
+  size_t chunks_from_origin = 0;  /**< Chunks fetched from the origin */
+  size_t chunks_rejected = 0;     /**< Peer chunks failing their hash */
+  size_t chunks_served = 0;       /**< Chunks sent to peers */
+  uint64_t bytes_from_peers = 0;  /**< Bytes fetched from peers */
+  uint64_t bytes_from_origin = 0; /**< Bytes fetched from the origin */
+  uint64_t bytes_served = 0;      /**< Bytes sent to peers */
+};
+
+/**
+ * @brief Set the swarm configuration, starting or stopping the chunk
+ * server.
+ *
+ * @param config The swarm configuration.
+ * @return False if the chunk server cannot listen on the port.
+ */
+bool set_swarm_config(const SwarmConfig &config);
+
+/**
+ * @brief Get the swarm configuration.
+ *
+ * @return A copy of the current configuration.
+ */
+SwarmConfig get_swarm_config();
+
+/**
+ * @brief Get the swarm statistics.
+ *
+ * @return A copy of the current statistics.
+ */
+SwarmStats get_swarm_stats();
+
+/**
+ * @brief Run a swarm tracker in the background.
+ *
+ * Nodes announce themselves to the tracker and learn the other nodes that
+ * announced themselves in the last minute. Chunk servers answer the same
+ * requests, so a node can also act as the tracker of the others.
+ *
+ * @param port The port to listen on.
+ * @return False if the tracker cannot listen on the port.
+ */
+bool start_swarm_tracker(int port);
+
+/**
+ * @struct QueuedFile
+ * @brief A file requested through a download job.
+ */
+struct QueuedFile {
+  std::string repo_id;           /**< Repository ID */
+  std::string filename;          /**< Path of the file in the repository */
+  std::string revision = "main"; /**< Branch, tag or commit */
+};
+
+/**
+ * @struct JobProgress
+ * @brief Progress of a download job, over all of its files.
+ */
+struct JobProgress {
+  std::string job_id;           /**< Job ID, empty if the job does not exist */
+  size_t files_total = 0;       /**< Files requested */
+  size_t files_done = 0;        /**< Files in the cache */
+  size_t files_skipped = 0;     /**< Done files whose blob was already cached */
+  size_t files_failed = 0;      /**< Files whose last attempt failed */
+  uint64_t bytes_total = 0;     /**< Size of the files whose size is known */
+  uint64_t bytes_done = 0;      /**< Bytes in the cache, partial files
+                                     included */
+  bool complete = false;        /**< Every file is in the cache */
+  bool deadline_missed = false; /**< The run stopped at its deadline */
+};
+
+/**
+ * @brief Record a batch of files to download as a job under the cache root.
+ *
+ * The job and a journal of its progress are kept in `<cache_dir>/.jobs`,
+ * so a job interrupted by the end of the process is resumed by
+ * resume_download_jobs(). Repeated files are recorded once.
+ *
+ * @param files The files to download.
+ * @param cache_dir The cache directory.
+ * @return The job ID, empty if the job could not be recorded.
+ */
+std::string
+enqueue_downloads(const std::vector<QueuedFile> &files,
+                  const std::string &cache_dir = "~/.cache/huggingface/hub");
+
+/**
+ * @brief Download the files of a job that are not in the cache yet.
+ *
+ * Files whose blob is already cached are only linked into their snapshot.
+ * Partial blobs left by an interrupted run are resumed. A job runs in one
+ * process at a time. A run stopped by its deadline leaves the files it did
+ * not reach to the next run.
+ *
+ * @param job_id The job ID.
+ * @param cache_dir The cache directory.
+ * @param deadline The time by which the run must end, none if unset. Files
+ * matching its priority patterns are downloaded first.
+ * @return The progress of the job once the run ends.
+ */
+JobProgress
+run_download_job(const std::string &job_id,
+                 const std::string &cache_dir = "~/.cache/huggingface/hub",
+                 const Deadline &deadline = Deadline());
+
+/**
+ * @brief Run every job of the cache that is not complete, e.g. at startup.
+ *
+ * Jobs running in another process are left to it.
+ *
+ * @param cache_dir The cache directory.
+ * @param deadline The time by which every job must be done, none if unset.
+ * @return The progress of each job that was run.
+ */
+std::vector<JobProgress>
+resume_download_jobs(const std::string &cache_dir = "~/.cache/huggingface/hub",
+                     const Deadline &deadline = Deadline());
+
+/**
+ * @brief Get the progress of a job, including one running in another
+ * process.
+ *
+ * @param job_id The job ID.
+ * @param cache_dir The cache directory.
+ * @return The progress, with an empty job_id if the job does not exist.
+ */
+JobProgress
+get_job_progress(const std::string &job_id,
+                 const std::string &cache_dir = "~/.cache/huggingface/hub");
+
+/**
+ * @struct DeadlineStats
+ * @brief Statistics of the download calls given a deadline.
+ */
+struct DeadlineStats {
+  uint64_t calls = 0;        /**< Calls given a deadline */
+  uint64_t expired = 0;      /**< Calls that ran out of time */
+  uint64_t failed_early = 0; /**< Calls given up on from their throughput */
+  uint64_t retries = 0;      /**< Transfers resumed within a deadline */
+};
+
+/**
+ * @brief Get the deadline statistics of this process.
+ */
+DeadlineStats get_deadline_stats();
 
 #endif // HUGGINGFACE_HUB_H
 } // namespace huggingface_hub
\ No newline at end of file
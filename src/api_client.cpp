@@ -0,0 +1,548 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <regex>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+// Number of recent API latencies kept to compute the hedging delay
+const size_t LATENCY_WINDOW = 128;
+// Below this many samples the initial hedging delay is used
+const size_t MIN_LATENCY_SAMPLES = 16;
+// Maximum number of hedges that can be saved up by the ratio budget
+const double MAX_HEDGE_BURST = 10;
+
+std::mutex hedging_mutex;
+HedgingConfig hedging_config;
+HedgingStats hedging_stats;
+std::deque<double> api_latencies_ms;
+
+// Token buckets limiting how many hedges can be sent
+double ratio_tokens = 0;
+double rate_tokens = 1;
+std::chrono::steady_clock::time_point rate_refill =
+    std::chrono::steady_clock::now();
+
+// Token bucket shared by every API request, separate from blob bandwidth
+std::mutex rate_limit_mutex;
+ApiRateLimitConfig rate_limit_config;
+ApiStats api_stats;
+double api_tokens = -1; // Negative until the bucket is first filled
+std::chrono::steady_clock::time_point api_refill =
+    std::chrono::steady_clock::now();
+std::chrono::steady_clock::time_point api_paused_until =
+    std::chrono::steady_clock::now();
+
+struct ApiRequest {
+  CURL *curl = nullptr;
+  struct curl_slist *headers = nullptr;
+  struct curl_slist *connect_to = nullptr;
+  std::string response;
+  std::string response_headers;
+
+  ~ApiRequest() {
+    if (curl) {
+      curl_easy_cleanup(curl);
+    }
+    curl_slist_free_all(headers);
+    curl_slist_free_all(connect_to);
+  }
+};
+
+void setup_api_post(ApiRequest &request, const std::string &url,
+                    const std::string &body) {
+  request.headers =
+      curl_slist_append(request.headers, "Content-Type: application/json");
+  request.headers = append_auth_header(request.headers);
+  curl_easy_setopt(request.curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(request.curl, CURLOPT_HTTPHEADER, request.headers);
+  curl_easy_setopt(request.curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                   (curl_off_t)body.size());
+  curl_easy_setopt(request.curl, CURLOPT_COPYPOSTFIELDS, body.c_str());
+  curl_easy_setopt(request.curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(request.curl, CURLOPT_FAILONERROR, 1L);
+  curl_easy_setopt(request.curl, CURLOPT_WRITEFUNCTION, write_string_data);
+  curl_easy_setopt(request.curl, CURLOPT_WRITEDATA, &request.response);
+  curl_easy_setopt(request.curl, CURLOPT_HEADERFUNCTION, write_string_data);
+  curl_easy_setopt(request.curl, CURLOPT_HEADERDATA,
+                   &request.response_headers);
+}
+
+void record_latency(double latency_ms) {
+  std::lock_guard<std::mutex> lock(hedging_mutex);
+  api_latencies_ms.push_back(latency_ms);
+  if (api_latencies_ms.size() > LATENCY_WINDOW) {
+    api_latencies_ms.pop_front();
+  }
+}
+
+long hedge_delay_ms(const HedgingConfig &config) {
+  std::lock_guard<std::mutex> lock(hedging_mutex);
+  if (api_latencies_ms.size() < MIN_LATENCY_SAMPLES) {
+    return config.initial_delay_ms;
+  }
+  std::vector<double> sorted(api_latencies_ms.begin(), api_latencies_ms.end());
+  size_t rank = std::min(sorted.size() - 1,
+                         static_cast<size_t>(config.percentile *
+                                             (sorted.size() - 1)));
+  std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+  long delay = static_cast<long>(sorted[rank]);
+  return std::max(config.min_delay_ms, std::min(config.max_delay_ms, delay));
+}
+
+// Take one API token, waiting for it when wait is true
+bool acquire_api_token(bool wait) {
+  auto wait_start = std::chrono::steady_clock::now();
+  bool throttled = false;
+  while (true) {
+    std::chrono::duration<double> delay;
+    {
+      std::lock_guard<std::mutex> lock(rate_limit_mutex);
+      double rate = rate_limit_config.requests_per_second;
+      double burst = std::max(1.0, rate_limit_config.burst);
+      auto now = std::chrono::steady_clock::now();
+      double elapsed = std::chrono::duration<double>(now - api_refill).count();
+      api_refill = now;
+      api_tokens =
+          api_tokens < 0 ? burst : std::min(burst, api_tokens + elapsed * rate);
+
+      if (now >= api_paused_until && (rate <= 0 || api_tokens >= 1)) {
+        if (rate > 0) {
+          api_tokens -= 1;
+        }
+        if (throttled) {
+          ++api_stats.requests_throttled;
+          api_stats.throttled_seconds +=
+              std::chrono::duration<double>(now - wait_start).count();
+        }
+        return true;
+      }
+      if (!wait) {
+        return false;
+      }
+
+      if (now < api_paused_until) {
+        delay = api_paused_until - now;
+      } else {
+        delay = std::chrono::duration<double>((1 - api_tokens) / rate);
+      }
+    }
+    throttled = true;
+    std::this_thread::sleep_for(delay);
+  }
+}
+
+// Stop sending API requests until the server-provided delay has elapsed
+void pause_api_requests(long seconds) {
+  std::lock_guard<std::mutex> lock(rate_limit_mutex);
+  ++api_stats.rate_limited_responses;
+  auto until = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+  api_paused_until = std::max(api_paused_until, until);
+}
+
+long parse_retry_after(const std::string &headers) {
+  std::smatch match;
+  if (std::regex_search(headers, match,
+                        std::regex(R"(\n[Rr]etry-[Aa]fter:\s*(\d+))"))) {
+    return std::stol(match[1]);
+  }
+  return 1;
+}
+
+long parse_status(const std::string &headers) {
+  // The last status line wins when redirects were followed
+  long status = 0;
+  std::regex status_line(R"(HTTP/[0-9.]+\s+(\d{3}))");
+  for (auto it =
+           std::sregex_iterator(headers.begin(), headers.end(), status_line);
+       it != std::sregex_iterator(); ++it) {
+    status = std::stol((*it)[1]);
+  }
+  return status;
+}
+
+// Every request earns a fraction of a hedge, and hedges are additionally
+// capped per second, so a slow API cannot make us double our load
+bool acquire_hedge_token(const HedgingConfig &config) {
+  std::lock_guard<std::mutex> lock(hedging_mutex);
+  auto now = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(now - rate_refill).count();
+  rate_refill = now;
+  rate_tokens =
+      std::min(std::max(1.0, config.max_hedges_per_second),
+               rate_tokens + elapsed * config.max_hedges_per_second);
+
+  if (ratio_tokens < 1 || rate_tokens < 1 || !acquire_api_token(false)) {
+    ++hedging_stats.hedges_suppressed;
+    return false;
+  }
+  ratio_tokens -= 1;
+  rate_tokens -= 1;
+  ++hedging_stats.hedges_sent;
+  return true;
+}
+
+// Pin the hedge to another address of the API host when it has several
+void pin_alternate_address(ApiRequest &hedge, CURL *primary,
+                           const std::string &url) {
+  CURLU *handle = curl_url();
+  char *host = nullptr;
+  char *port = nullptr;
+  if (curl_url_set(handle, CURLUPART_URL, url.c_str(), 0) != CURLUE_OK ||
+      curl_url_get(handle, CURLUPART_HOST, &host, 0) != CURLUE_OK ||
+      curl_url_get(handle, CURLUPART_PORT, &port, CURLU_DEFAULT_PORT) !=
+          CURLUE_OK) {
+    curl_free(host);
+    curl_url_cleanup(handle);
+    return;
+  }
+
+  char *primary_ip = nullptr;
+  curl_easy_getinfo(primary, CURLINFO_PRIMARY_IP, &primary_ip);
+  std::string used_ip = primary_ip ? primary_ip : "";
+
+  struct addrinfo hints = {};
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *addresses = nullptr;
+  if (getaddrinfo(host, nullptr, &hints, &addresses) == 0) {
+    for (struct addrinfo *it = addresses; it; it = it->ai_next) {
+      char ip[INET6_ADDRSTRLEN] = {0};
+      const void *address =
+          it->ai_family == AF_INET
+              ? static_cast<const void *>(
+                    &reinterpret_cast<sockaddr_in *>(it->ai_addr)->sin_addr)
+              : static_cast<const void *>(
+                    &reinterpret_cast<sockaddr_in6 *>(it->ai_addr)->sin6_addr);
+      if (!inet_ntop(it->ai_family, address, ip, sizeof(ip)) ||
+          used_ip == ip) {
+        continue;
+      }
+      // CURLOPT_RESOLVE would land in the shared DNS cache and pin every
+      // later request; a connect-to entry only applies to this handle
+      std::string entry = std::string(host) + ":" + port + ":" +
+                          (it->ai_family == AF_INET6 ? "[" + std::string(ip) +
+                                                           "]"
+                                                     : std::string(ip)) +
+                          ":" + port;
+      hedge.connect_to = curl_slist_append(hedge.connect_to, entry.c_str());
+      curl_easy_setopt(hedge.curl, CURLOPT_CONNECT_TO, hedge.connect_to);
+      // Make sure the pinned address is actually used
+      curl_easy_setopt(hedge.curl, CURLOPT_FRESH_CONNECT, 1L);
+      log_debug("Hedging API request to " + std::string(ip));
+      break;
+    }
+    freeaddrinfo(addresses);
+  }
+
+  curl_free(host);
+  curl_free(port);
+  curl_url_cleanup(handle);
+}
+
+CURLcode hedged_api_post(const HedgingConfig &config, const std::string &path,
+                         const std::string &body, std::string &response,
+                         std::string &headers) {
+  std::string url = get_hf_endpoint() + path;
+
+  ApiRequest primary;
+  primary.curl = create_curl_handle(true);
+  if (!primary.curl) {
+    return CURLE_FAILED_INIT;
+  }
+  setup_api_post(primary, url, body);
+
+  ApiRequest hedge;
+  CURLM *multi = curl_multi_init();
+  curl_multi_add_handle(multi, primary.curl);
+
+  auto start = std::chrono::steady_clock::now();
+  auto hedge_at = start + std::chrono::milliseconds(hedge_delay_ms(config));
+  bool hedge_considered = false;
+  int active = 1;
+  CURL *winner = nullptr;
+  CURLcode result = CURLE_OK;
+
+  while (active > 0 && !winner) {
+    int running = 0;
+    curl_multi_perform(multi, &running);
+
+    int queued = 0;
+    CURLMsg *message;
+    while ((message = curl_multi_info_read(multi, &queued))) {
+      if (message->msg != CURLMSG_DONE) {
+        continue;
+      }
+      --active;
+      result = message->data.result;
+      curl_multi_remove_handle(multi, message->easy_handle);
+      if (result == CURLE_OK || active == 0) {
+        winner = message->easy_handle;
+        break;
+      }
+    }
+    if (winner || active == 0) {
+      break;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (!hedge_considered && now >= hedge_at) {
+      hedge_considered = true;
+      if (acquire_hedge_token(config)) {
+        hedge.curl = create_curl_handle(true);
+        if (hedge.curl) {
+          if (config.mirror_endpoint.empty()) {
+            setup_api_post(hedge, url, body);
+            pin_alternate_address(hedge, primary.curl, url);
+          } else {
+            setup_api_post(hedge, config.mirror_endpoint + path, body);
+          }
+          curl_multi_add_handle(multi, hedge.curl);
+          ++active;
+        }
+      }
+    }
+
+    int timeout_ms = 1000;
+    if (!hedge_considered) {
+      timeout_ms = std::max<long>(
+          1, std::chrono::duration_cast<std::chrono::milliseconds>(hedge_at -
+                                                                   now)
+                 .count());
+    }
+    curl_multi_poll(multi, nullptr, 0, std::min(timeout_ms, 1000), nullptr);
+  }
+
+  // Abandon the loser, if any
+  curl_multi_remove_handle(multi, primary.curl);
+  if (hedge.curl) {
+    curl_multi_remove_handle(multi, hedge.curl);
+  }
+  curl_multi_cleanup(multi);
+
+  if (result == CURLE_OK) {
+    record_latency(std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count());
+  }
+  if (winner == hedge.curl) {
+    std::lock_guard<std::mutex> lock(hedging_mutex);
+    hedging_stats.hedges_won += result == CURLE_OK;
+    response = std::move(hedge.response);
+    headers = std::move(hedge.response_headers);
+  } else if (winner == primary.curl) {
+    response = std::move(primary.response);
+    headers = std::move(primary.response_headers);
+  }
+  return result;
+}
+
+CURLcode send_api_request(const std::string &method, const std::string &path,
+                          const std::string &body, std::string &response,
+                          std::string &headers) {
+  CURL *curl = create_curl_handle(true);
+  if (!curl) {
+    return CURLE_FAILED_INIT;
+  }
+
+  struct curl_slist *http_headers = NULL;
+  if (method == "POST") {
+    http_headers =
+        curl_slist_append(http_headers, "Content-Type: application/json");
+  }
+  http_headers = append_auth_header(http_headers);
+
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, http_headers);
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+
+  HttpTransfer transfer;
+  transfer.method = method;
+  transfer.url = get_hf_endpoint() + path;
+  transfer.request_body = body;
+  transfer.write_function = write_string_data;
+  transfer.write_data = &response;
+  transfer.header_function = write_string_data;
+  transfer.header_data = &headers;
+  CURLcode res = http_perform(curl, transfer);
+
+  curl_slist_free_all(http_headers);
+  curl_easy_cleanup(curl);
+  return res;
+}
+
+CURLcode send_api_post(const std::string &path, const std::string &body,
+                       std::string &response, std::string &headers) {
+  HedgingConfig config;
+  {
+    std::lock_guard<std::mutex> lock(hedging_mutex);
+    config = hedging_config;
+    ++hedging_stats.requests;
+    ratio_tokens =
+        std::min(MAX_HEDGE_BURST, ratio_tokens + config.max_hedge_ratio);
+  }
+
+  // Recorded and replayed sessions need a single, deterministic exchange
+  if (config.enabled && session_is_live()) {
+    return hedged_api_post(config, path, body, response, headers);
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  CURLcode res = send_api_request("POST", path, body, response, headers);
+  if (res == CURLE_OK) {
+    record_latency(std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count());
+  }
+  return res;
+}
+
+// Send a request through the rate limiter, retrying after 429 responses
+template <typename Send>
+CURLcode send_rate_limited(Send send, std::string &response,
+                           std::string &headers) {
+  int max_retries = get_api_rate_limit_config().max_retries_on_429;
+  for (int attempt = 0;; ++attempt) {
+    acquire_api_token(true);
+
+    headers.clear();
+    response.clear();
+    CURLcode res = send(response, headers);
+    if (res != CURLE_HTTP_RETURNED_ERROR || parse_status(headers) != 429) {
+      return res;
+    }
+
+    long retry_after = parse_retry_after(headers);
+    pause_api_requests(retry_after);
+    if (attempt >= max_retries || !deadline_allows_wait(retry_after)) {
+      return res;
+    }
+    log_debug("API rate limited, retrying in " + std::to_string(retry_after) +
+              "s");
+  }
+}
+
+} // namespace
+
+std::string get_hf_endpoint() {
+  const char *endpoint = std::getenv("HF_ENDPOINT");
+  std::string url = endpoint && *endpoint ? endpoint : "https://huggingface.co";
+  while (!url.empty() && url.back() == '/') {
+    url.pop_back();
+  }
+  return url;
+}
+
+struct curl_slist *append_auth_header(struct curl_slist *headers) {
+  std::string token;
+  const char *env_token = std::getenv("HF_TOKEN");
+  if (env_token && *env_token) {
+    token = env_token;
+  } else {
+    const char *hf_home = std::getenv("HF_HOME");
+    std::string token_path =
+        hf_home ? std::string(hf_home) + "/token"
+                : expand_user_home("~/.cache/huggingface/token").string();
+    std::ifstream token_file(token_path);
+    token_file >> token;
+  }
+
+  if (token.empty()) {
+    return headers;
+  }
+  return curl_slist_append(headers, ("Authorization: Bearer " + token).c_str());
+}
+
+void set_hedging_config(const HedgingConfig &config) {
+  std::lock_guard<std::mutex> lock(hedging_mutex);
+  hedging_config = config;
+}
+
+HedgingConfig get_hedging_config() {
+  std::lock_guard<std::mutex> lock(hedging_mutex);
+  return hedging_config;
+}
+
+HedgingStats get_hedging_stats() {
+  std::lock_guard<std::mutex> lock(hedging_mutex);
+  return hedging_stats;
+}
+
+
+void set_api_rate_limit_config(const ApiRateLimitConfig &config) {
+  std::lock_guard<std::mutex> lock(rate_limit_mutex);
+  rate_limit_config = config;
+  api_tokens = std::min(api_tokens, std::max(1.0, config.burst));
+}
+
+ApiRateLimitConfig get_api_rate_limit_config() {
+  std::lock_guard<std::mutex> lock(rate_limit_mutex);
+  return rate_limit_config;
+}
+
+ApiStats get_api_stats() {
+  std::lock_guard<std::mutex> lock(rate_limit_mutex);
+  return api_stats;
+}
+
+void count_coalesced_paths(size_t paths) {
+  std::lock_guard<std::mutex> lock(rate_limit_mutex);
+  api_stats.coalesced_paths += paths;
+}
+
+CURLcode api_post(const std::string &path, const std::string &body,
+                  std::string &response) {
+  std::string headers;
+  return send_rate_limited(
+      [&](std::string &out, std::string &out_headers) {
+        return send_api_post(path, body, out, out_headers);
+      },
+      response, headers);
+}
+
+CURLcode api_get(const std::string &path, std::string &response,
+                 std::string &headers) {
+  return send_rate_limited(
+      [&](std::string &out, std::string &out_headers) {
+        return send_api_request("GET", path, "", out, out_headers);
+      },
+      response, headers);
+}
+
+} // namespace huggingface_hub
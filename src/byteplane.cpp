@@ -0,0 +1,283 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+#ifdef HFHUB_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+// Stream layout: the magic, then frames of a 12-byte little-endian header
+// (raw size, encoded size, element size, frame type, 2 reserved bytes)
+// followed by the encoded chunk
+const char MAGIC[4] = {'B', 'P', 'Z', '1'};
+const size_t FRAME_HEADER_SIZE = 12;
+const size_t CHUNK_SIZE = 4 * 1024 * 1024;
+
+enum FrameType : uint8_t {
+  FRAME_ZSTD = 0,   // zstd frame of the byte planes
+  FRAME_STORED = 1, // Raw chunk, when compressing did not pay off
+};
+
+std::mutex byteplane_mutex;
+ByteplaneConfig byteplane_config;
+ByteplaneStats byteplane_stats;
+
+#ifdef HFHUB_HAVE_ZSTD
+void put_u32(char *out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) {
+    out[i] = static_cast<char>(value >> (8 * i));
+  }
+}
+
+uint32_t get_u32(const char *in) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+  }
+  return value;
+}
+
+// Byte k of every element goes to plane k; a partial last element is kept
+// as is after the planes
+void split_planes(const char *in, size_t size, int width, char *out) {
+  size_t count = size / width;
+  for (size_t i = 0; i < count; ++i) {
+    for (int k = 0; k < width; ++k) {
+      out[k * count + i] = in[i * width + k];
+    }
+  }
+  memcpy(out + count * width, in + count * width, size - count * width);
+}
+
+void join_planes(const char *in, size_t size, int width, char *out) {
+  size_t count = size / width;
+  for (size_t i = 0; i < count; ++i) {
+    for (int k = 0; k < width; ++k) {
+      out[i * width + k] = in[k * count + i];
+    }
+  }
+  memcpy(out + count * width, in + count * width, size - count * width);
+}
+
+std::string encode_chunk(const char *data, size_t size, int width,
+                         int level) {
+  std::string planes(size, '\0');
+  split_planes(data, size, width, &planes[0]);
+
+  std::string frame(FRAME_HEADER_SIZE + ZSTD_compressBound(size), '\0');
+  size_t encoded = ZSTD_compress(&frame[FRAME_HEADER_SIZE],
+                                 frame.size() - FRAME_HEADER_SIZE,
+                                 planes.data(), size, level);
+  FrameType type = FRAME_ZSTD;
+  if (ZSTD_isError(encoded) || encoded >= size) {
+    type = FRAME_STORED;
+    encoded = size;
+    memcpy(&frame[FRAME_HEADER_SIZE], data, size);
+  }
+  put_u32(&frame[0], size);
+  put_u32(&frame[4], encoded);
+  frame[8] = static_cast<char>(width);
+  frame[9] = static_cast<char>(type);
+  frame.resize(FRAME_HEADER_SIZE + encoded);
+  return frame;
+}
+#endif
+
+} // namespace
+
+void set_byteplane_config(const ByteplaneConfig &config) {
+  std::lock_guard<std::mutex> lock(byteplane_mutex);
+  byteplane_config = config;
+}
+
+ByteplaneConfig get_byteplane_config() {
+  std::lock_guard<std::mutex> lock(byteplane_mutex);
+  return byteplane_config;
+}
+
+ByteplaneStats get_byteplane_stats() {
+  std::lock_guard<std::mutex> lock(byteplane_mutex);
+  return byteplane_stats;
+}
+
+bool byteplane_enabled() {
+#ifdef HFHUB_HAVE_ZSTD
+  return get_byteplane_config().enabled;
+#else
+  return false;
+#endif
+}
+
+bool ByteplaneDecoder::feed(const char *data, size_t size) {
+#ifdef HFHUB_HAVE_ZSTD
+  buffer.append(data, size);
+  wire_bytes += size;
+
+  size_t offset = 0;
+  if (!started) {
+    if (buffer.size() < sizeof(MAGIC)) {
+      return true;
+    }
+    if (memcmp(buffer.data(), MAGIC, sizeof(MAGIC)) != 0) {
+      log_error("Byte-plane stream has no magic");
+      return false;
+    }
+    started = true;
+    offset = sizeof(MAGIC);
+  }
+
+  std::string planes, chunk;
+  while (buffer.size() - offset >= FRAME_HEADER_SIZE) {
+    const char *header = buffer.data() + offset;
+    uint32_t raw_size = get_u32(header);
+    uint32_t encoded_size = get_u32(header + 4);
+    int width = static_cast<uint8_t>(header[8]);
+    uint8_t type = static_cast<uint8_t>(header[9]);
+    // The sizes come from the wire, so bound them before buffering a frame
+    if (raw_size > CHUNK_SIZE ||
+        encoded_size > ZSTD_compressBound(CHUNK_SIZE)) {
+      log_error("Oversized byte-plane frame");
+      return false;
+    }
+    if (buffer.size() - offset - FRAME_HEADER_SIZE < encoded_size) {
+      break;
+    }
+    const char *payload = header + FRAME_HEADER_SIZE;
+
+    if (type == FRAME_STORED && encoded_size == raw_size) {
+      chunk.assign(payload, raw_size);
+    } else if (type == FRAME_ZSTD && width > 0) {
+      planes.resize(raw_size);
+      chunk.resize(raw_size);
+      size_t decoded =
+          ZSTD_decompress(&planes[0], raw_size, payload, encoded_size);
+      if (ZSTD_isError(decoded) || decoded != raw_size) {
+        log_error("Corrupt byte-plane frame");
+        return false;
+      }
+      join_planes(planes.data(), raw_size, width, &chunk[0]);
+    } else {
+      log_error("Unknown byte-plane frame type " + std::to_string(type));
+      return false;
+    }
+
+    hash.update(chunk.data(), chunk.size());
+    decoded_bytes += chunk.size();
+    if (!sink(chunk.data(), chunk.size())) {
+      return false;
+    }
+    offset += FRAME_HEADER_SIZE + encoded_size;
+  }
+
+  // Only consumed frames are dropped, so partial frames are never copied
+  // more than once per frame
+  if (offset > 0) {
+    buffer.erase(0, offset);
+  }
+  return true;
+#else
+  (void)data;
+  (void)size;
+  return false;
+#endif
+}
+
+bool ByteplaneDecoder::finish(const std::string &expected_sha256) {
+  bool valid = started && buffer.empty();
+  if (valid && !expected_sha256.empty() &&
+      hash.hex_digest() != expected_sha256) {
+    log_error("Decoded blob does not match its SHA-256");
+    valid = false;
+  }
+
+  std::lock_guard<std::mutex> lock(byteplane_mutex);
+  ++(valid ? byteplane_stats.blobs_decoded : byteplane_stats.blobs_rejected);
+  byteplane_stats.wire_bytes += wire_bytes;
+  byteplane_stats.decoded_bytes += decoded_bytes;
+  return valid;
+}
+
+bool encode_byte_planes(const std::string &input_path,
+                        const std::string &output_path, int element_size,
+                        int threads, int level) {
+#ifdef HFHUB_HAVE_ZSTD
+  std::ifstream input(input_path, std::ios::binary);
+  std::ofstream output(output_path, std::ios::binary | std::ios::trunc);
+  if (!input || !output || element_size < 1 || element_size > 255) {
+    log_error("Cannot encode " + input_path + " into " + output_path);
+    return false;
+  }
+  if (threads <= 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  output.write(MAGIC, sizeof(MAGIC));
+
+  // Each round reads one chunk per thread and writes the frames in order
+  std::vector<std::string> chunks(threads), frames(threads);
+  while (input) {
+    size_t count = 0;
+    for (; count < chunks.size() && input; ++count) {
+      chunks[count].resize(CHUNK_SIZE);
+      input.read(&chunks[count][0], CHUNK_SIZE);
+      chunks[count].resize(input.gcount());
+      if (chunks[count].empty()) {
+        break;
+      }
+    }
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < count; ++i) {
+      workers.emplace_back([&, i]() {
+        frames[i] = encode_chunk(chunks[i].data(), chunks[i].size(),
+                                 element_size, level);
+      });
+    }
+    for (size_t i = 0; i < workers.size(); ++i) {
+      workers[i].join();
+      output.write(frames[i].data(), frames[i].size());
+    }
+  }
+  return static_cast<bool>(output.flush());
+#else
+  (void)element_size;
+  (void)threads;
+  (void)level;
+  log_error("Cannot encode " + input_path + " into " + output_path +
+            ": built without zstd");
+  return false;
+#endif
+}
+
+} // namespace huggingface_hub
@@ -0,0 +1,176 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cerrno>
+#include <filesystem>
+#include <map>
+#include <mutex>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+// Folders under snapshots/ kept open per repository before starting over
+const size_t MAX_OPEN_DIRECTORIES = 4096;
+
+std::mutex repo_caches_mutex;
+std::map<std::string, std::shared_ptr<RepoCache>> repo_caches;
+
+DirectoryRef open_directory(const std::string &path) {
+  auto directory = std::make_shared<DirectoryHandle>();
+  directory->fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  return directory->fd >= 0 ? directory : nullptr;
+}
+
+// A folder deleted behind our back keeps its descriptor but has no links
+bool still_linked(const DirectoryRef &directory) {
+  struct stat stat_buf;
+  return directory && fstat(directory->fd, &stat_buf) == 0 &&
+         stat_buf.st_nlink > 0;
+}
+
+} // namespace
+
+DirectoryHandle::~DirectoryHandle() {
+  if (fd >= 0) {
+    close(fd);
+  }
+}
+
+std::string repo_folder_name(const std::string &repo_id) {
+  std::string model_folder = "models/" + repo_id;
+  size_t pos = 0;
+  while ((pos = model_folder.find("/", pos)) != std::string::npos) {
+    model_folder.replace(pos, 1, "--");
+    pos += 2;
+  }
+  return model_folder;
+}
+
+std::shared_ptr<RepoCache> open_repo_cache(const std::string &cache_dir,
+                                           const std::string &repo_id) {
+  std::string path = expand_user_home(cache_dir).string() + "/" +
+                     repo_folder_name(repo_id) + "/";
+
+  std::lock_guard<std::mutex> lock(repo_caches_mutex);
+  auto it = repo_caches.find(path);
+  if (it != repo_caches.end() && still_linked(it->second->refs) &&
+      still_linked(it->second->blobs) &&
+      still_linked(it->second->snapshots)) {
+    return it->second;
+  }
+
+  std::filesystem::create_directories(path + "refs");
+  std::filesystem::create_directories(path + "blobs");
+  std::filesystem::create_directories(path + "snapshots");
+
+  auto cache = std::make_shared<RepoCache>();
+  cache->path = path;
+  cache->refs = open_directory(path + "refs");
+  cache->blobs = open_directory(path + "blobs");
+  cache->snapshots = open_directory(path + "snapshots");
+  if (!cache->refs || !cache->blobs || !cache->snapshots) {
+    throw std::filesystem::filesystem_error(
+        "Failed to open the cache folders", path,
+        std::error_code(errno, std::generic_category()));
+  }
+  repo_caches[path] = cache;
+  return cache;
+}
+
+DirectoryRef snapshot_directory(RepoCache &cache,
+                                const std::string &relative) {
+  if (relative.empty()) {
+    return cache.snapshots;
+  }
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    auto it = cache.directories.find(relative);
+    if (it != cache.directories.end() && still_linked(it->second)) {
+      return it->second;
+    }
+    // Deleted since it was opened, links made in it would be lost
+    if (it != cache.directories.end()) {
+      cache.directories.erase(it);
+    }
+  }
+
+  size_t slash = relative.rfind('/');
+  DirectoryRef parent = snapshot_directory(
+      cache, slash == std::string::npos ? "" : relative.substr(0, slash));
+  if (!parent) {
+    return nullptr;
+  }
+  std::string name =
+      slash == std::string::npos ? relative : relative.substr(slash + 1);
+  if (mkdirat(parent->fd, name.c_str(), 0755) != 0 && errno != EEXIST) {
+    log_error("Failed to create " + cache.path + "snapshots/" + relative);
+    return nullptr;
+  }
+  auto directory = std::make_shared<DirectoryHandle>();
+  directory->fd =
+      openat(parent->fd, name.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (directory->fd < 0) {
+    log_error("Failed to open " + cache.path + "snapshots/" + relative);
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  if (cache.directories.size() >= MAX_OPEN_DIRECTORIES) {
+    cache.directories.clear();
+  }
+  cache.directories[relative] = directory;
+  return directory;
+}
+
+void forget_snapshot_directories(RepoCache &cache, const std::string &root,
+                                 bool sync) {
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  for (auto it = cache.directories.begin(); it != cache.directories.end();) {
+    bool under_root = it->first == root || it->first.rfind(root + "/", 0) == 0;
+    if (under_root && sync) {
+      fsync(it->second->fd);
+    }
+    it = under_root ? cache.directories.erase(it) : std::next(it);
+  }
+}
+
+bool stat_at(int directory, const std::string &name, uint64_t *size) {
+  struct statx stat_buf;
+  if (statx(directory, name.c_str(), AT_STATX_SYNC_AS_STAT, STATX_SIZE,
+            &stat_buf) != 0) {
+    return false;
+  }
+  if (size) {
+    *size = stat_buf.stx_size;
+  }
+  return true;
+}
+
+} // namespace huggingface_hub
@@ -0,0 +1,444 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <shared_mutex>
+#include <thread>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+const uint32_t WATCH_MASK = IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO |
+                            IN_DELETE | IN_MOVED_FROM | IN_DELETE_SELF;
+
+struct Subscription {
+  std::string repo_id;
+  std::string revision;
+  std::vector<std::string> files;
+  CacheView::Callback callback;
+};
+
+// Turn "models--org--name" into "org/name"
+std::string repo_of_folder(const std::string &folder) {
+  const std::string prefix = "models--";
+  if (folder.rfind(prefix, 0) != 0) {
+    return "";
+  }
+  std::string repo_id = folder.substr(prefix.size());
+  size_t pos = 0;
+  while ((pos = repo_id.find("--", pos)) != std::string::npos) {
+    repo_id.replace(pos, 2, "/");
+    ++pos;
+  }
+  return repo_id;
+}
+
+} // namespace
+
+struct CacheViewState {
+  std::filesystem::path root;
+  int inotify_fd = -1;
+  int stop_fd = -1;
+  std::thread thread;
+
+  // Only the watcher thread touches the watch table and pending links
+  std::map<int, std::filesystem::path> watches;
+  std::map<std::string, std::set<std::pair<std::string, std::string>>>
+      pending;
+
+  mutable std::shared_mutex mutex;
+  // repo -> revision -> commit
+  std::map<std::string, std::map<std::string, std::string>> refs;
+  // repo -> commit -> file -> blob
+  std::map<std::string,
+           std::map<std::string, std::map<std::string, std::string>>>
+      files;
+  std::map<size_t, Subscription> subscriptions;
+  size_t next_subscription = 1;
+
+  std::string commit_of(const std::string &repo_id,
+                        const std::string &revision) const;
+  bool complete(const Subscription &subscription) const;
+  void watch_tree(const std::filesystem::path &directory);
+  void rescan();
+  void update(const std::filesystem::path &path, bool present,
+              bool written);
+  void notify();
+  void run();
+};
+
+std::string CacheViewState::commit_of(const std::string &repo_id,
+                                      const std::string &revision) const {
+  auto repo = refs.find(repo_id);
+  if (repo != refs.end()) {
+    auto ref = repo->second.find(revision);
+    if (ref != repo->second.end()) {
+      return ref->second;
+    }
+  }
+  return revision;
+}
+
+bool CacheViewState::complete(const Subscription &subscription) const {
+  auto repo = files.find(subscription.repo_id);
+  if (repo == files.end()) {
+    return false;
+  }
+  auto snapshot =
+      repo->second.find(commit_of(subscription.repo_id, subscription.revision));
+  if (snapshot == repo->second.end() || snapshot->second.empty()) {
+    return false;
+  }
+  return std::all_of(subscription.files.begin(), subscription.files.end(),
+                     [&](const std::string &file) {
+                       return snapshot->second.count(file) > 0;
+                     });
+}
+
+void CacheViewState::watch_tree(const std::filesystem::path &directory) {
+  int wd = inotify_add_watch(inotify_fd, directory.c_str(), WATCH_MASK);
+  if (wd < 0) {
+    log_debug("Failed to watch " + directory.string());
+    return;
+  }
+  watches[wd] = directory;
+
+  // Entries created before the watch existed are picked up by this scan
+  std::error_code error;
+  for (const auto &entry :
+       std::filesystem::directory_iterator(directory, error)) {
+    if (entry.is_directory(error) && !entry.is_symlink(error)) {
+      watch_tree(entry.path());
+    } else {
+      update(entry.path(), true, true);
+    }
+  }
+}
+
+// Catch up after the kernel dropped events: walk the tree again, then drop
+// the refs and links that are gone
+void CacheViewState::rescan() {
+  log_debug("Event queue overflowed, rescanning " + root.string());
+  watch_tree(root);
+
+  std::vector<std::filesystem::path> known;
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    for (const auto &repo : refs) {
+      for (const auto &ref : repo.second) {
+        known.push_back(root / repo_folder_name(repo.first) / "refs" /
+                        ref.first);
+      }
+    }
+    for (const auto &repo : files) {
+      for (const auto &snapshot : repo.second) {
+        for (const auto &file : snapshot.second) {
+          known.push_back(root / repo_folder_name(repo.first) / "snapshots" /
+                          snapshot.first / file.first);
+        }
+      }
+    }
+  }
+  std::error_code error;
+  for (const auto &path : known) {
+    auto status = std::filesystem::symlink_status(path, error);
+    if (!std::filesystem::exists(status)) {
+      update(path, false, false);
+    }
+  }
+}
+
+void CacheViewState::update(const std::filesystem::path &path, bool present,
+                            bool written) {
+  std::vector<std::string> parts;
+  for (const auto &part : path.lexically_relative(root)) {
+    parts.push_back(part.string());
+  }
+  if (parts.size() < 3) {
+    return;
+  }
+  std::string repo_id = repo_of_folder(parts[0]);
+  if (repo_id.empty()) {
+    return;
+  }
+  std::string rest = parts[2];
+  for (size_t i = 3; i < parts.size(); ++i) {
+    rest += "/" + parts[i];
+  }
+
+  // Touch the file system before taking the lock, so lookups never wait on
+  // a system call
+  std::error_code error;
+  if (parts[1] == "refs") {
+    std::string commit;
+    if (present) {
+      std::ifstream ref_file(path);
+      ref_file >> commit;
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (commit.empty()) {
+      refs[repo_id].erase(rest);
+    } else {
+      refs[repo_id][rest] = commit;
+    }
+  } else if (parts[1] == "snapshots" && parts.size() >= 4 &&
+             parts[2][0] != '.') {
+    // Hidden staging trees only become visible once they are renamed
+    std::string commit = parts[2];
+    std::string file = rest.substr(commit.size() + 1);
+    bool link = present && std::filesystem::is_symlink(path, error);
+    if (present && !link && !written) {
+      // Plain files are only complete once they are closed
+      return;
+    }
+    std::filesystem::path blob = path;
+    if (link) {
+      blob = std::filesystem::read_symlink(path, error);
+      if (blob.is_relative()) {
+        blob = path.parent_path() / blob;
+      }
+      blob = blob.lexically_normal();
+    }
+    bool available = present && std::filesystem::exists(blob, error);
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (available) {
+      files[repo_id][commit][file] = blob.string();
+    } else {
+      files[repo_id][commit].erase(file);
+      if (present) {
+        pending[blob.string()].insert({repo_id, commit + "/" + file});
+      }
+    }
+  } else if (parts[1] == "blobs") {
+    std::string blob = path.lexically_normal().string();
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    if (!present) {
+      for (auto &snapshot : files[repo_id]) {
+        for (auto it = snapshot.second.begin(); it != snapshot.second.end();) {
+          it = it->second == blob ? snapshot.second.erase(it) : std::next(it);
+        }
+      }
+      return;
+    }
+    auto waiting = pending.find(blob);
+    if (waiting == pending.end()) {
+      return;
+    }
+    for (const auto &link : waiting->second) {
+      size_t slash = link.second.find('/');
+      files[link.first][link.second.substr(0, slash)]
+           [link.second.substr(slash + 1)] = blob;
+    }
+    pending.erase(waiting);
+  }
+}
+
+void CacheViewState::notify() {
+  std::vector<std::pair<Subscription, std::string>> ready;
+  {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    for (auto it = subscriptions.begin(); it != subscriptions.end();) {
+      if (complete(it->second)) {
+        ready.push_back(
+            {it->second, commit_of(it->second.repo_id, it->second.revision)});
+        it = subscriptions.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+  // Callbacks run without the lock so they can query the view
+  for (const auto &entry : ready) {
+    entry.first.callback(entry.first.repo_id, entry.second);
+  }
+}
+
+void CacheViewState::run() {
+  alignas(struct inotify_event) char buffer[64 * 1024];
+  struct pollfd fds[2] = {{inotify_fd, POLLIN, 0}, {stop_fd, POLLIN, 0}};
+
+  while (poll(fds, 2, -1) >= 0 && !(fds[1].revents & POLLIN)) {
+    ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+    if (length <= 0) {
+      continue;
+    }
+
+    bool overflowed = false;
+    for (char *ptr = buffer; ptr < buffer + length;) {
+      struct inotify_event *event = reinterpret_cast<inotify_event *>(ptr);
+      ptr += sizeof(struct inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        overflowed = true;
+        continue;
+      }
+      auto watch = watches.find(event->wd);
+      if (watch == watches.end()) {
+        continue;
+      }
+      if (event->mask & IN_IGNORED) {
+        watches.erase(watch);
+        continue;
+      }
+      if (event->len == 0) {
+        continue;
+      }
+
+      std::filesystem::path path = watch->second / event->name;
+      bool created = event->mask & (IN_CREATE | IN_MOVED_TO);
+      if ((event->mask & IN_ISDIR) && created) {
+        watch_tree(path);
+      } else if (created || (event->mask & IN_CLOSE_WRITE)) {
+        update(path, true, event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO));
+      } else if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        update(path, false, false);
+      }
+    }
+    if (overflowed) {
+      rescan();
+    }
+    notify();
+  }
+}
+
+CacheView::CacheView(const std::string &cache_dir)
+    : state_(std::make_unique<CacheViewState>()) {
+  state_->root = expand_user_home(cache_dir).lexically_normal();
+}
+
+CacheView::~CacheView() { stop(); }
+
+bool CacheView::start() {
+  if (state_->inotify_fd >= 0) {
+    return true;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(state_->root, error);
+  state_->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  state_->stop_fd = eventfd(0, EFD_CLOEXEC);
+  if (state_->inotify_fd < 0 || state_->stop_fd < 0) {
+    log_error("Failed to set up inotify for " + state_->root.string());
+    stop();
+    return false;
+  }
+
+  state_->watch_tree(state_->root);
+  log_debug("Watching " + std::to_string(state_->watches.size()) +
+            " cache directories");
+  state_->thread = std::thread(&CacheViewState::run, state_.get());
+  return true;
+}
+
+void CacheView::stop() {
+  if (state_->thread.joinable()) {
+    uint64_t one = 1;
+    if (write(state_->stop_fd, &one, sizeof(one)) != sizeof(one)) {
+      log_error("Failed to stop the cache watcher");
+    }
+    state_->thread.join();
+  }
+  for (int *fd : {&state_->inotify_fd, &state_->stop_fd}) {
+    if (*fd >= 0) {
+      close(*fd);
+      *fd = -1;
+    }
+  }
+  state_->watches.clear();
+  state_->pending.clear();
+}
+
+std::string CacheView::resolve(const std::string &repo_id,
+                               const std::string &filename,
+                               const std::string &revision) const {
+  std::shared_lock<std::shared_mutex> lock(state_->mutex);
+  auto repo = state_->files.find(repo_id);
+  if (repo == state_->files.end()) {
+    return "";
+  }
+  std::string commit = state_->commit_of(repo_id, revision);
+  auto snapshot = repo->second.find(commit);
+  if (snapshot == repo->second.end() || !snapshot->second.count(filename)) {
+    return "";
+  }
+  return (state_->root / repo_folder_name(repo_id) / "snapshots" / commit /
+          filename)
+      .string();
+}
+
+std::vector<std::string> CacheView::files(const std::string &repo_id,
+                                          const std::string &revision) const {
+  std::vector<std::string> result;
+  std::shared_lock<std::shared_mutex> lock(state_->mutex);
+  auto repo = state_->files.find(repo_id);
+  if (repo != state_->files.end()) {
+    auto snapshot = repo->second.find(state_->commit_of(repo_id, revision));
+    if (snapshot != repo->second.end()) {
+      for (const auto &file : snapshot->second) {
+        result.push_back(file.first);
+      }
+    }
+  }
+  return result;
+}
+
+size_t CacheView::subscribe(const std::string &repo_id,
+                            const std::vector<std::string> &files,
+                            Callback callback, const std::string &revision) {
+  Subscription subscription{repo_id, revision, files, callback};
+  std::string commit;
+  size_t id;
+  {
+    std::unique_lock<std::shared_mutex> lock(state_->mutex);
+    id = state_->next_subscription++;
+    if (!state_->complete(subscription)) {
+      state_->subscriptions[id] = subscription;
+      return id;
+    }
+    commit = state_->commit_of(repo_id, revision);
+  }
+  callback(repo_id, commit);
+  return id;
+}
+
+void CacheView::unsubscribe(size_t id) {
+  std::unique_lock<std::shared_mutex> lock(state_->mutex);
+  state_->subscriptions.erase(id);
+}
+
+} // namespace huggingface_hub
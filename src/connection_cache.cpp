@@ -0,0 +1,372 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <unistd.h>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+// Connection state file, stored in the cache root
+const char *CONNECTIONS_FILE = ".connections";
+// Changes are collected for this long before the file is rewritten
+const auto SAVE_DELAY = std::chrono::seconds(1);
+
+struct DnsEntry {
+  std::string host;
+  long port = 0;
+  std::string address;
+  int64_t expires = 0;
+  bool loaded = false; // Read from the file rather than resolved here
+};
+
+struct SessionEntry {
+  std::string der; // Serialized SSL_SESSION
+  int64_t expires = 0;
+};
+
+std::mutex cache_mutex;
+std::atomic<bool> cache_enabled(false);
+ConnectionCacheConfig cache_config;
+ConnectionCacheStats cache_stats;
+std::map<std::string, DnsEntry> dns_entries;        // By "host:port"
+std::map<std::string, SessionEntry> session_entries; // By host name
+
+// Entries handed to CURLOPT_RESOLVE. Handles keep a pointer to the list, so
+// replaced lists are retired instead of freed.
+curl_slist *resolve_list = nullptr;
+std::vector<curl_slist *> retired_resolve_lists;
+int64_t resolve_list_expires = 0;
+
+std::atomic<bool> save_pending(false);
+
+int64_t now_seconds() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+std::filesystem::path connections_path(const ConnectionCacheConfig &config) {
+  return expand_user_home(config.cache_dir) / CONNECTIONS_FILE;
+}
+
+// Must be called with cache_mutex held
+void rebuild_resolve_list() {
+  if (resolve_list) {
+    retired_resolve_lists.push_back(resolve_list);
+  }
+  resolve_list = nullptr;
+  resolve_list_expires = INT64_MAX;
+  int64_t now = now_seconds();
+  for (const auto &entry : dns_entries) {
+    const DnsEntry &dns = entry.second;
+    if (!dns.loaded || dns.expires <= now) {
+      continue;
+    }
+    // A leading "+" lets curl expire the entry like a resolved one
+    std::string address = dns.address.find(':') != std::string::npos
+                              ? "[" + dns.address + "]"
+                              : dns.address;
+    std::string line =
+        "+" + dns.host + ":" + std::to_string(dns.port) + ":" + address;
+    resolve_list = curl_slist_append(resolve_list, line.c_str());
+    resolve_list_expires = std::min(resolve_list_expires, dns.expires);
+  }
+}
+
+// Must be called with cache_mutex held
+void load_connections_file() {
+  dns_entries.clear();
+  session_entries.clear();
+  std::ifstream file(connections_path(cache_config));
+  std::string line;
+  int64_t now = now_seconds();
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string kind, host;
+    fields >> kind >> host;
+    if (kind == "dns") {
+      DnsEntry dns;
+      dns.host = host;
+      dns.loaded = true;
+      if (fields >> dns.port >> dns.address >> dns.expires &&
+          dns.expires > now) {
+        dns_entries[host + ":" + std::to_string(dns.port)] = dns;
+        ++cache_stats.dns_entries_loaded;
+      }
+    } else if (kind == "tls") {
+      SessionEntry session;
+      std::string hex;
+      if (fields >> session.expires >> hex && session.expires > now) {
+        session.der.resize(hex.size() / 2);
+        if (from_hex(hex, reinterpret_cast<uint8_t *>(&session.der[0]),
+                     session.der.size())) {
+          session_entries[host] = session;
+          ++cache_stats.sessions_loaded;
+        }
+      }
+    }
+  }
+  rebuild_resolve_list();
+}
+
+void save_connections_file() {
+  std::string content;
+  std::filesystem::path path;
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    path = connections_path(cache_config);
+    for (const auto &entry : dns_entries) {
+      const DnsEntry &dns = entry.second;
+      content += "dns " + dns.host + " " + std::to_string(dns.port) + " " +
+                 dns.address + " " + std::to_string(dns.expires) + "\n";
+    }
+    for (const auto &entry : session_entries) {
+      const SessionEntry &session = entry.second;
+      content += "tls " + entry.first + " " +
+                 std::to_string(session.expires) + " " +
+                 to_hex(reinterpret_cast<const uint8_t *>(session.der.data()),
+                        session.der.size()) +
+                 "\n";
+    }
+  }
+
+  // Processes sharing the cache replace the whole file, last writer wins.
+  // Sessions hold resumption secrets, so only the owner may read the file.
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+  write_file_atomically(path, content, 0600);
+}
+
+void flush_connections_file() {
+  if (save_pending.exchange(false)) {
+    save_connections_file();
+  }
+}
+
+// Saves are batched on a background thread, away from the handshake and
+// transfer paths; anything still pending is written at exit
+void schedule_save() {
+  static std::once_flag exit_flush;
+  std::call_once(exit_flush, []() { std::atexit(flush_connections_file); });
+  if (save_pending.exchange(true)) {
+    return;
+  }
+  std::thread([]() {
+    std::this_thread::sleep_for(SAVE_DELAY);
+    flush_connections_file();
+  }).detach();
+}
+
+} // namespace
+
+void set_connection_cache_config(const ConnectionCacheConfig &config) {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  cache_config = config;
+  cache_enabled = config.enabled;
+  if (config.enabled) {
+    load_connections_file();
+  }
+}
+
+ConnectionCacheConfig get_connection_cache_config() {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  return cache_config;
+}
+
+ConnectionCacheStats get_connection_cache_stats() {
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  return cache_stats;
+}
+
+void apply_connection_cache(CURL *curl) {
+  if (!cache_enabled) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(cache_mutex);
+  if (resolve_list_expires <= now_seconds()) {
+    rebuild_resolve_list();
+  }
+  if (resolve_list) {
+    curl_easy_setopt(curl, CURLOPT_RESOLVE, resolve_list);
+  }
+}
+
+void note_connection(CURL *curl, const std::string &url) {
+  if (!cache_enabled) {
+    return;
+  }
+  long new_connections = 0;
+  curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_connections);
+  char *address = nullptr;
+  long port = 0;
+  curl_easy_getinfo(curl, CURLINFO_PRIMARY_IP, &address);
+  curl_easy_getinfo(curl, CURLINFO_PRIMARY_PORT, &port);
+  if (new_connections == 0 || !address || !*address || port == 0) {
+    return;
+  }
+
+  char *effective_url = nullptr;
+  curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effective_url);
+  CURLU *handle = curl_url();
+  char *host = nullptr;
+  curl_url_set(handle, CURLUPART_URL,
+               effective_url ? effective_url : url.c_str(), 0);
+  curl_url_get(handle, CURLUPART_HOST, &host, 0);
+  std::string host_name = host ? host : "";
+  curl_free(host);
+  curl_url_cleanup(handle);
+  if (host_name.empty() || host_name == address) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    DnsEntry &dns = dns_entries[host_name + ":" + std::to_string(port)];
+    if (dns.loaded && dns.address == address) {
+      ++cache_stats.lookups_skipped;
+    }
+    // Rewrite the file only when an address is new or about to expire
+    int64_t now = now_seconds();
+    if (dns.address == address && dns.expires > now + 60) {
+      return;
+    }
+    dns.host = host_name;
+    dns.port = port;
+    dns.address = address;
+    dns.expires = now + cache_config.dns_ttl_seconds;
+  }
+  schedule_save();
+}
+
+#ifdef HFHUB_HAVE_OPENSSL
+namespace {
+
+typedef int (*NewSessionCallback)(SSL *, SSL_SESSION *);
+
+// Session callback installed by curl, chained so its own cache still works
+std::atomic<NewSessionCallback> curl_new_session(nullptr);
+
+int save_session(SSL *ssl, SSL_SESSION *session) {
+  const char *host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+  int length = i2d_SSL_SESSION(session, nullptr);
+  if (host && length > 0) {
+    SessionEntry entry;
+    entry.der.resize(length);
+    unsigned char *out = reinterpret_cast<unsigned char *>(&entry.der[0]);
+    i2d_SSL_SESSION(session, &out);
+    {
+      std::lock_guard<std::mutex> lock(cache_mutex);
+      entry.expires =
+          now_seconds() + std::min<long>(cache_config.session_ttl_seconds,
+                                         SSL_SESSION_get_timeout(session));
+      session_entries[host] = entry;
+    }
+    schedule_save();
+  }
+
+  NewSessionCallback next = curl_new_session;
+  return next ? next(ssl, session) : 0;
+}
+
+} // namespace
+
+void prepare_session_cache(SSL_CTX *ssl_context) {
+  if (!cache_enabled) {
+    return;
+  }
+  NewSessionCallback previous = SSL_CTX_sess_get_new_cb(ssl_context);
+  if (previous && previous != save_session) {
+    curl_new_session = previous;
+  }
+  SSL_CTX_set_session_cache_mode(
+      ssl_context,
+      SSL_CTX_get_session_cache_mode(ssl_context) | SSL_SESS_CACHE_CLIENT);
+  SSL_CTX_sess_set_new_cb(ssl_context, save_session);
+}
+
+void note_session_handshake(SSL *ssl, int where) {
+  if (!cache_enabled) {
+    return;
+  }
+  if (where & SSL_CB_HANDSHAKE_DONE) {
+    if (SSL_session_reused(ssl)) {
+      std::lock_guard<std::mutex> lock(cache_mutex);
+      ++cache_stats.handshakes_resumed;
+    }
+    return;
+  }
+  // Offer a saved session when curl has none of its own for the host
+  if (!(where & SSL_CB_HANDSHAKE_START) || SSL_get_session(ssl)) {
+    return;
+  }
+
+  const char *host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+  if (!host) {
+    return;
+  }
+  std::string der;
+  {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    auto it = session_entries.find(host);
+    if (it == session_entries.end() || it->second.expires <= now_seconds()) {
+      return;
+    }
+    der = it->second.der;
+  }
+  const unsigned char *in = reinterpret_cast<const unsigned char *>(der.data());
+  SSL_SESSION *session = d2i_SSL_SESSION(nullptr, &in, der.size());
+  if (session) {
+    if (SSL_SESSION_is_resumable(session) && SSL_set_session(ssl, session)) {
+      std::lock_guard<std::mutex> lock(cache_mutex);
+      ++cache_stats.sessions_offered;
+    }
+    SSL_SESSION_free(session);
+  }
+}
+#endif
+
+void allow_early_data(CURL *curl) {
+#ifdef CURLSSLOPT_EARLYDATA
+  if (cache_enabled && get_connection_cache_config().early_data) {
+    curl_easy_setopt(curl, CURLOPT_SSL_OPTIONS, (long)CURLSSLOPT_EARLYDATA);
+  }
+#else
+  (void)curl;
+#endif
+}
+
+} // namespace huggingface_hub
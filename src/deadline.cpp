@@ -0,0 +1,228 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+// Throughput is only trusted once bytes flowed for this long
+const double MIN_SAMPLE_SECONDS = 2.0;
+// A call is given up when it needs this many times the time left
+const double MISS_MARGIN = 1.5;
+// Resumed attempts of one transfer within a deadline
+const int MAX_RETRIES = 3;
+// Stalls are detected within this share of the time left
+const long STALL_SHARE = 4;
+
+// Budget of the outermost call with a deadline on this thread
+struct DeadlineState {
+  Clock::time_point at;
+  Clock::time_point first_byte;
+  uint64_t planned = 0;
+  uint64_t transferred = 0;
+  bool missed = false;
+};
+
+thread_local DeadlineState *current = nullptr;
+
+std::mutex stats_mutex;
+DeadlineStats stats;
+
+double seconds_between(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<double>(to - from).count();
+}
+
+void give_up(const std::string &reason, bool early) {
+  current->missed = true;
+  {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    ++(early ? stats.failed_early : stats.expired);
+  }
+  log_error("Deadline: " + reason);
+}
+
+} // namespace
+
+Deadline Deadline::after(std::chrono::milliseconds budget,
+                         const PatternSet &priority) {
+  Deadline deadline;
+  deadline.at = Clock::now() + budget;
+  deadline.priority = priority;
+  return deadline;
+}
+
+DeadlineScope::DeadlineScope(const Deadline &deadline, bool counted) {
+  if (!deadline.is_set()) {
+    return;
+  }
+  if (current) {
+    previous_ = current->at;
+    current->at = std::min(current->at, deadline.at);
+    return;
+  }
+  owner_ = true;
+  current = new DeadlineState();
+  current->at = deadline.at;
+  if (counted) {
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    ++stats.calls;
+  }
+}
+
+DeadlineScope::~DeadlineScope() {
+  if (owner_) {
+    delete current;
+    current = nullptr;
+  } else if (previous_ != Clock::time_point()) {
+    current->at = previous_;
+  }
+}
+
+Deadline current_deadline() {
+  Deadline deadline;
+  if (current) {
+    deadline.at = current->at;
+  }
+  return deadline;
+}
+
+long deadline_remaining_ms() {
+  if (!current) {
+    return -1;
+  }
+  auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+      current->at - Clock::now());
+  return std::max<long>(1, remaining.count());
+}
+
+void plan_deadline_bytes(uint64_t bytes) {
+  if (current) {
+    current->planned += bytes;
+  }
+}
+
+void note_deadline_bytes(uint64_t bytes) {
+  if (current && bytes > 0) {
+    if (current->first_byte == Clock::time_point()) {
+      current->first_byte = Clock::now();
+    }
+    current->transferred += bytes;
+  }
+}
+
+bool deadline_on_track(uint64_t in_flight) {
+  if (!current) {
+    return true;
+  }
+  if (current->missed) {
+    return false;
+  }
+  Clock::time_point now = Clock::now();
+  if (now >= current->at) {
+    give_up("out of time", false);
+    return false;
+  }
+
+  uint64_t done = current->transferred + in_flight;
+  if (done > 0 && current->first_byte == Clock::time_point()) {
+    current->first_byte = now;
+  }
+  double elapsed = done > 0 ? seconds_between(current->first_byte, now) : 0;
+  if (elapsed < MIN_SAMPLE_SECONDS || current->planned <= done) {
+    return true;
+  }
+  double rate = done / elapsed;
+  double needed = (current->planned - done) / rate;
+  double left = seconds_between(now, current->at);
+  if (needed > left * MISS_MARGIN) {
+    std::ostringstream reason;
+    reason.precision(1);
+    reason << std::fixed << (current->planned - done) / 1048576.0
+           << " MB left at " << rate / 1048576.0 << " MB/s need " << needed
+           << "s but " << left << "s remain, giving up";
+    give_up(reason.str(), true);
+    return false;
+  }
+  return true;
+}
+
+bool deadline_missed() {
+  return current && (current->missed || Clock::now() >= current->at);
+}
+
+bool deadline_allows_retry(CURLcode res, int attempt) {
+  if (!current || attempt >= MAX_RETRIES) {
+    return false;
+  }
+  switch (res) {
+  case CURLE_COULDNT_CONNECT:
+  case CURLE_OPERATION_TIMEDOUT:
+  case CURLE_PARTIAL_FILE:
+  case CURLE_RECV_ERROR:
+  case CURLE_SEND_ERROR:
+  case CURLE_GOT_NOTHING:
+  case CURLE_HTTP2_STREAM:
+    break;
+  default:
+    return false;
+  }
+  if (!deadline_on_track()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  ++stats.retries;
+  return true;
+}
+
+bool deadline_allows_wait(long seconds) {
+  return !current || seconds * 1000 < deadline_remaining_ms();
+}
+
+void apply_deadline_timeouts(long &connect_timeout_ms, long &timeout_ms,
+                             long &low_speed_time) {
+  long remaining = deadline_remaining_ms();
+  if (remaining < 0) {
+    return;
+  }
+  connect_timeout_ms = std::min(connect_timeout_ms, remaining);
+  timeout_ms = timeout_ms > 0 ? std::min(timeout_ms, remaining) : remaining;
+  low_speed_time =
+      std::min(low_speed_time, std::max(1L, remaining / 1000 / STALL_SHARE));
+}
+
+DeadlineStats get_deadline_stats() {
+  std::lock_guard<std::mutex> lock(stats_mutex);
+  return stats;
+}
+
+} // namespace huggingface_hub
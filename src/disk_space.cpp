@@ -0,0 +1,327 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+// Ledger shared with other processes, stored in each cache root
+const char *LEDGER_FILE = ".reservations";
+// Waiting downloads look at the disk again this often
+const auto RECHECK_INTERVAL = std::chrono::seconds(1);
+
+struct Reservation {
+  long pid = 0;
+  uint64_t id = 0;
+  uint64_t bytes = 0;
+  uint64_t base_size = 0; // Size of the partial file when it was admitted
+  std::string root;
+  std::string partial_path;
+};
+
+std::mutex ledger_mutex;
+std::condition_variable ledger_cv;
+DiskSpaceConfig disk_space_config;
+DiskSpaceStats disk_space_stats;
+std::map<uint64_t, Reservation> reservations;
+uint64_t next_reservation = 1;
+
+// Bytes a reservation has not written yet
+uint64_t outstanding(const Reservation &reservation) {
+  struct stat stat_buf;
+  uint64_t written = 0;
+  if (stat(reservation.partial_path.c_str(), &stat_buf) == 0 &&
+      static_cast<uint64_t>(stat_buf.st_size) > reservation.base_size) {
+    written = stat_buf.st_size - reservation.base_size;
+  }
+  return written >= reservation.bytes ? 0 : reservation.bytes - written;
+}
+
+uint64_t free_bytes(const std::string &root) {
+  struct statvfs stat_buf;
+  if (statvfs(root.c_str(), &stat_buf) != 0) {
+    return 0;
+  }
+  return static_cast<uint64_t>(stat_buf.f_bavail) * stat_buf.f_frsize;
+}
+
+bool process_alive(long pid) {
+  return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+}
+
+// Exclusive lock on the ledger file of a cache root
+class LedgerFile {
+public:
+  explicit LedgerFile(const std::string &root) {
+    fd_ = open((root + "/" + LEDGER_FILE).c_str(), O_RDWR | O_CREAT | O_CLOEXEC,
+               0644);
+    if (fd_ >= 0 && flock(fd_, LOCK_EX) != 0) {
+      close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  ~LedgerFile() {
+    if (fd_ >= 0) {
+      flock(fd_, LOCK_UN);
+      close(fd_);
+    }
+  }
+
+  // Entries of other live processes
+  std::vector<Reservation> read_others() const {
+    std::vector<Reservation> entries;
+    std::string text;
+    char buffer[4096];
+    ssize_t length;
+    off_t offset = 0;
+    while (fd_ >= 0 &&
+           (length = pread(fd_, buffer, sizeof(buffer), offset)) > 0) {
+      text.append(buffer, length);
+      offset += length;
+    }
+
+    std::istringstream lines(text);
+    Reservation entry;
+    while (lines >> entry.pid >> entry.id >> entry.bytes >> entry.base_size) {
+      lines.ignore(1);
+      std::getline(lines, entry.partial_path);
+      if (entry.pid != getpid() && process_alive(entry.pid)) {
+        entries.push_back(entry);
+      }
+    }
+    return entries;
+  }
+
+  void write(const std::vector<Reservation> &entries) const {
+    std::string text;
+    for (const auto &entry : entries) {
+      text += std::to_string(entry.pid) + " " + std::to_string(entry.id) +
+              " " + std::to_string(entry.bytes) + " " +
+              std::to_string(entry.base_size) + " " + entry.partial_path +
+              "\n";
+    }
+    if (fd_ < 0 || ftruncate(fd_, 0) != 0 ||
+        pwrite(fd_, text.data(), text.size(), 0) !=
+            static_cast<ssize_t>(text.size())) {
+      log_error("Failed to update the disk space ledger");
+    }
+  }
+
+  // Rewrite the file with the other processes' entries and this process'
+  void publish(const std::string &root) const {
+    std::vector<Reservation> entries = read_others();
+    for (const auto &entry : reservations) {
+      if (entry.second.root == root) {
+        entries.push_back(entry.second);
+      }
+    }
+    write(entries);
+  }
+
+private:
+  int fd_ = -1;
+};
+
+// Delete blobs no snapshot links to and that were not touched recently
+uint64_t collect_unreferenced_blobs(const std::string &root,
+                                    uint64_t min_age_seconds) {
+  namespace fs = std::filesystem;
+  uint64_t freed = 0;
+  std::error_code error;
+  auto cutoff = fs::file_time_type::clock::now() -
+                std::chrono::seconds(min_age_seconds);
+
+  for (const auto &repo : fs::directory_iterator(root, error)) {
+    fs::path blobs = repo.path() / "blobs";
+    fs::path snapshots = repo.path() / "snapshots";
+    if (!fs::is_directory(blobs, error)) {
+      continue;
+    }
+
+    std::set<std::string> referenced;
+    for (auto it = fs::recursive_directory_iterator(snapshots, error);
+         it != fs::recursive_directory_iterator(); it.increment(error)) {
+      if (it->is_symlink(error)) {
+        referenced.insert(fs::read_symlink(it->path(), error).filename());
+      }
+    }
+
+    for (const auto &blob : fs::directory_iterator(blobs, error)) {
+      std::string name = blob.path().filename();
+      if (!blob.is_regular_file(error) || referenced.count(name) ||
+          blob.path().extension() == ".incomplete" ||
+          blob.last_write_time(error) > cutoff) {
+        continue;
+      }
+      uint64_t size = blob.file_size(error);
+      if (fs::remove(blob.path(), error)) {
+        log_debug("Collected unreferenced blob " + blob.path().string());
+        freed += size;
+      }
+    }
+  }
+  return freed;
+}
+
+} // namespace
+
+void set_disk_space_config(const DiskSpaceConfig &config) {
+  std::lock_guard<std::mutex> lock(ledger_mutex);
+  disk_space_config = config;
+  ledger_cv.notify_all();
+}
+
+DiskSpaceConfig get_disk_space_config() {
+  std::lock_guard<std::mutex> lock(ledger_mutex);
+  return disk_space_config;
+}
+
+DiskSpaceStats get_disk_space_stats() {
+  std::lock_guard<std::mutex> lock(ledger_mutex);
+  DiskSpaceStats stats = disk_space_stats;
+  stats.active_reservations = reservations.size();
+  for (const auto &entry : reservations) {
+    stats.reserved_bytes += outstanding(entry.second);
+  }
+  return stats;
+}
+
+bool reserve_disk_space(const std::string &root, uint64_t bytes,
+                        const std::string &partial_path, uint64_t &id) {
+  id = 0;
+  std::unique_lock<std::mutex> lock(ledger_mutex);
+  DiskSpaceConfig config = disk_space_config;
+  if (!config.enabled) {
+    return true;
+  }
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(config.wait_timeout_ms);
+  bool delayed = false;
+  bool collected = false;
+  while (true) {
+    std::unique_ptr<LedgerFile> ledger;
+    uint64_t reserved = 0;
+    if (config.cross_process) {
+      ledger = std::make_unique<LedgerFile>(root);
+      for (const auto &entry : ledger->read_others()) {
+        reserved += outstanding(entry);
+      }
+    }
+    for (const auto &entry : reservations) {
+      if (entry.second.root == root) {
+        reserved += outstanding(entry.second);
+      }
+    }
+
+    uint64_t available = free_bytes(root);
+    uint64_t required = bytes + reserved + config.min_free_bytes;
+    if (available >= required) {
+      Reservation reservation;
+      reservation.pid = getpid();
+      reservation.id = next_reservation++;
+      reservation.bytes = bytes;
+      reservation.base_size = get_file_size(partial_path);
+      reservation.root = root;
+      reservation.partial_path = partial_path;
+      reservations[reservation.id] = reservation;
+      if (ledger) {
+        ledger->publish(root);
+      }
+      ++disk_space_stats.admissions;
+      disk_space_stats.admissions_delayed += delayed;
+      id = reservation.id;
+      return true;
+    }
+    ledger.reset();
+
+    if (!collected && (config.gc_unreferenced || config.gc_callback)) {
+      // Cleanups can be slow, so other downloads keep going meanwhile
+      collected = true;
+      lock.unlock();
+      uint64_t freed = 0;
+      if (config.gc_unreferenced) {
+        freed += collect_unreferenced_blobs(root, config.gc_min_age_seconds);
+      }
+      if (config.gc_callback) {
+        freed += config.gc_callback(root, required - available);
+      }
+      lock.lock();
+      ++disk_space_stats.gc_runs;
+      disk_space_stats.gc_freed_bytes += freed;
+      log_info("Freed " + std::to_string(freed) + " bytes in " + root);
+      continue;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (now >= deadline) {
+      ++disk_space_stats.admissions_refused;
+      log_error("Not enough disk space in " + root + ": " +
+                std::to_string(required) + " bytes needed, " +
+                std::to_string(available) + " available");
+      return false;
+    }
+    delayed = true;
+    ledger_cv.wait_until(lock, std::min(deadline, now + RECHECK_INTERVAL));
+  }
+}
+
+void release_disk_space(uint64_t id) {
+  if (id == 0) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(ledger_mutex);
+  auto it = reservations.find(id);
+  if (it == reservations.end()) {
+    return;
+  }
+  std::string root = it->second.root;
+  reservations.erase(it);
+  if (disk_space_config.cross_process) {
+    LedgerFile(root).publish(root);
+  }
+  ledger_cv.notify_all();
+}
+
+} // namespace huggingface_hub
@@ -0,0 +1,409 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+enum EntryState { ENTRY_PENDING, ENTRY_DONE, ENTRY_FAILED };
+
+struct JobEntry {
+  QueuedFile file;
+  EntryState state = ENTRY_PENDING;
+  bool skipped = false;    // The blob was cached before the job needed it
+  bool size_known = false; // Set once the file was listed
+  uint64_t size = 0;
+  std::string blob;
+};
+
+std::atomic<unsigned> job_counter(0);
+
+std::filesystem::path jobs_path(const std::string &cache_dir) {
+  return expand_user_home(cache_dir) / ".jobs";
+}
+
+bool is_commit_hash(const std::string &revision) {
+  return revision.size() == 40 &&
+         revision.find_first_not_of("0123456789abcdef") == std::string::npos;
+}
+
+// Filenames are matched literally from the repository root, not as globs.
+// The leading '/' anchors names without a slash, which would otherwise match
+// at any depth and make the listing walk every directory.
+std::string literal_pattern(const std::string &filename) {
+  std::string pattern = "/";
+  for (char c : filename) {
+    if (c == '*' || c == '?' || c == '[' || c == '!' || c == '\\') {
+      pattern += '\\';
+    }
+    pattern += c;
+  }
+  return pattern;
+}
+
+// The queue holds one "<repo_id>\t<revision>\t<filename>" line per file.
+// The journal holds "size <index> <bytes> <blob>", "done <index> <skipped>"
+// and "failed <index>" lines; a line cut by a crash has no newline and is
+// ignored.
+bool load_job(const std::string &cache_dir, const std::string &job_id,
+              std::vector<JobEntry> &entries) {
+  std::filesystem::path jobs = jobs_path(cache_dir);
+  std::ifstream queue(jobs / (job_id + ".queue"));
+  if (!queue) {
+    return false;
+  }
+  std::string line;
+  while (std::getline(queue, line)) {
+    size_t first = line.find('\t');
+    size_t second = line.find('\t', first + 1);
+    if (first == std::string::npos || second == std::string::npos) {
+      continue;
+    }
+    JobEntry entry;
+    entry.file.repo_id = line.substr(0, first);
+    entry.file.revision = line.substr(first + 1, second - first - 1);
+    entry.file.filename = line.substr(second + 1);
+    entries.push_back(entry);
+  }
+
+  std::ifstream journal_file(jobs / (job_id + ".journal"));
+  std::stringstream content;
+  content << journal_file.rdbuf();
+  std::string journal = content.str();
+  journal.erase(journal.rfind('\n') == std::string::npos
+                    ? 0
+                    : journal.rfind('\n') + 1);
+  std::istringstream records(journal);
+  while (std::getline(records, line)) {
+    std::istringstream record(line);
+    std::string kind;
+    size_t index;
+    if (!(record >> kind >> index) || index >= entries.size()) {
+      continue;
+    }
+    JobEntry &entry = entries[index];
+    if (kind == "size" && record >> entry.size >> entry.blob) {
+      entry.size_known = true;
+    } else if (kind == "done") {
+      entry.state = ENTRY_DONE;
+      record >> entry.skipped;
+    } else if (kind == "failed") {
+      entry.state = ENTRY_FAILED;
+    }
+  }
+  return true;
+}
+
+JobProgress progress_of(const std::string &cache_dir, const std::string &job_id,
+                        const std::vector<JobEntry> &entries) {
+  JobProgress progress;
+  progress.job_id = job_id;
+  progress.files_total = entries.size();
+  for (const auto &entry : entries) {
+    if (entry.size_known) {
+      progress.bytes_total += entry.size;
+    }
+    if (entry.state == ENTRY_DONE) {
+      ++progress.files_done;
+      progress.files_skipped += entry.skipped;
+      progress.bytes_done += entry.size;
+    } else if (entry.state == ENTRY_FAILED) {
+      ++progress.files_failed;
+    }
+    // Count the part of the blob an earlier or concurrent run wrote
+    if (entry.state != ENTRY_DONE && entry.size_known) {
+      std::error_code error;
+      uint64_t partial = std::filesystem::file_size(
+          expand_user_home(cache_dir) / repo_folder_name(entry.file.repo_id) /
+              "blobs" / (entry.blob + ".incomplete"),
+          error);
+      progress.bytes_done += error ? 0 : std::min(partial, entry.size);
+    }
+  }
+  progress.complete = progress.files_done == progress.files_total;
+  return progress;
+}
+
+// Append one record to the journal with a single write
+void append_record(int fd, const std::string &record) {
+  std::string line = record + "\n";
+  if (write(fd, line.data(), line.size()) !=
+      static_cast<ssize_t>(line.size())) {
+    log_error("Failed to write the job journal: " +
+              std::string(strerror(errno)));
+  }
+  if (get_durability_config().mode == DurabilityMode::FULL) {
+    fdatasync(fd);
+  }
+}
+
+// Download the outstanding files of one repository at one revision; false
+// if the deadline stopped the run
+bool run_group(const std::string &cache_dir, std::vector<JobEntry> &entries,
+               const std::vector<size_t> &indices, int journal) {
+  const QueuedFile &first = entries[indices[0]].file;
+  const std::string &repo_id = first.repo_id;
+  std::string commit = first.revision;
+  if (!is_commit_hash(commit)) {
+    std::string response, headers;
+    CURLcode res = api_get("/api/models/" + repo_id + "/revision/" +
+                               first.revision,
+                           response, headers);
+    commit = res == CURLE_OK ? json_string_of(response, "sha") : "";
+  }
+  std::vector<std::string> patterns;
+  for (size_t index : indices) {
+    patterns.push_back(literal_pattern(entries[index].file.filename));
+  }
+  auto listing_result =
+      commit.empty() ? std::variant<FileListing, std::string>(
+                           "Failed to resolve the revision " +
+                           first.revision + " of " + repo_id)
+                     : list_repo_files(repo_id, "model", commit,
+                                       PatternSet(patterns));
+  if (std::holds_alternative<std::string>(listing_result)) {
+    log_error(std::get<std::string>(listing_result));
+    if (deadline_missed()) {
+      return false;
+    }
+    for (size_t index : indices) {
+      append_record(journal, "failed " + std::to_string(index));
+    }
+    return true;
+  }
+  const FileListing &listing = std::get<FileListing>(listing_result);
+
+  std::shared_ptr<RepoCache> cache = open_repo_cache(cache_dir, repo_id);
+  for (size_t index : indices) {
+    size_t position = listing.find(entries[index].file.filename);
+    if (position < listing.size()) {
+      plan_deadline_bytes(
+          blob_bytes_missing(*cache, listing.metadata(position)));
+    }
+  }
+
+  bool linked = false;
+  bool stopped = false;
+  for (size_t index : indices) {
+    JobEntry &entry = entries[index];
+    const std::string &filename = entry.file.filename;
+    size_t position = listing.find(filename);
+    if (position == listing.size()) {
+      log_error("File " + filename + " not found in " + repo_id + " at " +
+                commit);
+      append_record(journal, "failed " + std::to_string(index));
+      continue;
+    }
+    FileMetadata metadata = listing.metadata(position);
+    std::string blob = blob_name_of(metadata);
+    if (!entry.size_known || entry.blob != blob) {
+      append_record(journal, "size " + std::to_string(index) + " " +
+                                 std::to_string(metadata.size) + " " + blob);
+    }
+
+    bool cached = stat_at(cache->blobs->fd, blob);
+    TrackedTransfer transfer(repo_id, filename);
+    bool done = fetch_blob(repo_id, filename, commit, cache_dir, *cache,
+                           metadata, false, transfer) &&
+                link_snapshot_file(*cache, cache->path + "blobs/" + blob,
+                                   commit + "/" + filename);
+    if (!done && deadline_missed()) {
+      // Left outstanding for the next run rather than failed
+      stopped = true;
+      break;
+    }
+    append_record(journal, (done ? "done " : "failed ") +
+                               std::to_string(index) +
+                               (done ? cached ? " 1" : " 0" : ""));
+    linked |= done;
+  }
+
+  if (linked && commit != first.revision) {
+    std::filesystem::path ref = cache->path + "refs/" + first.revision;
+    std::error_code error;
+    std::filesystem::create_directories(ref.parent_path(), error);
+    write_file_atomically(ref, commit);
+  }
+  forget_memory_cache_paths(repo_id);
+  return !stopped;
+}
+
+} // namespace
+
+std::string enqueue_downloads(const std::vector<QueuedFile> &files,
+                              const std::string &cache_dir) {
+  std::set<std::string> seen;
+  std::string queue;
+  for (const auto &file : files) {
+    std::string line =
+        file.repo_id + "\t" + file.revision + "\t" + file.filename;
+    if (std::count(line.begin(), line.end(), '\t') != 2 ||
+        line.find('\n') != std::string::npos) {
+      log_error("Cannot queue " + file.filename + " of " + file.repo_id);
+      return "";
+    }
+    if (seen.insert(line).second) {
+      queue += line + "\n";
+    }
+  }
+
+  time_t now = time(nullptr);
+  struct tm utc;
+  gmtime_r(&now, &utc);
+  char stamp[17];
+  strftime(stamp, sizeof(stamp), "%Y%m%dT%H%M%SZ", &utc);
+  std::string job_id = std::string(stamp) + "-" + std::to_string(getpid()) +
+                       "-" + std::to_string(job_counter++);
+
+  std::filesystem::path jobs = jobs_path(cache_dir);
+  std::error_code error;
+  std::filesystem::create_directories(jobs, error);
+  if (error || !write_file_atomically(jobs / (job_id + ".queue"), queue)) {
+    log_error("Failed to record download job " + job_id);
+    return "";
+  }
+  if (get_durability_config().mode == DurabilityMode::FULL) {
+    sync_directory(jobs.string());
+  }
+  return job_id;
+}
+
+JobProgress run_download_job(const std::string &job_id,
+                             const std::string &cache_dir,
+                             const Deadline &deadline) {
+  DeadlineScope deadline_scope(deadline);
+  std::vector<JobEntry> entries;
+  std::filesystem::path jobs = jobs_path(cache_dir);
+  int lock = open((jobs / (job_id + ".lock")).c_str(), O_RDWR | O_CREAT, 0644);
+  if (lock < 0 || flock(lock, LOCK_EX | LOCK_NB) != 0) {
+    log_info("Download job " + job_id + " is running in another process");
+    if (lock >= 0) {
+      close(lock);
+    }
+    return get_job_progress(job_id, cache_dir);
+  }
+  // Loaded under the lock, so the journal is no longer growing
+  if (!load_job(cache_dir, job_id, entries)) {
+    log_error("Download job " + job_id + " not found");
+    close(lock);
+    return JobProgress();
+  }
+
+  int journal = open((jobs / (job_id + ".journal")).c_str(),
+                     O_WRONLY | O_APPEND | O_CREAT, 0644);
+  if (journal >= 0) {
+    // Files of one repository and revision share a listing
+    std::map<std::pair<std::string, std::string>, std::vector<size_t>> groups;
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (entries[i].state != ENTRY_DONE) {
+        groups[{entries[i].file.repo_id, entries[i].file.revision}].push_back(
+            i);
+      }
+    }
+    log_info("Running download job " + job_id + ": " +
+             std::to_string(groups.size()) + " outstanding revisions");
+
+    // Files the deadline depends on, and the groups holding them, go first
+    std::vector<std::vector<size_t>> order;
+    for (auto &group : groups) {
+      order.push_back(std::move(group.second));
+    }
+    if (!deadline.priority.empty()) {
+      auto is_priority = [&](size_t i) {
+        return deadline.priority.matches(entries[i].file.filename);
+      };
+      for (auto &indices : order) {
+        std::stable_partition(indices.begin(), indices.end(), is_priority);
+      }
+      std::stable_partition(order.begin(), order.end(),
+                            [&](const std::vector<size_t> &indices) {
+                              return is_priority(indices[0]);
+                            });
+    }
+    for (const auto &indices : order) {
+      if (!run_group(cache_dir, entries, indices, journal)) {
+        break;
+      }
+    }
+    close(journal);
+  } else {
+    log_error("Failed to open the journal of download job " + job_id);
+  }
+  close(lock);
+  JobProgress progress = get_job_progress(job_id, cache_dir);
+  progress.deadline_missed = !progress.complete && deadline_missed();
+  return progress;
+}
+
+std::vector<JobProgress> resume_download_jobs(const std::string &cache_dir,
+                                              const Deadline &deadline) {
+  DeadlineScope deadline_scope(deadline);
+  std::vector<std::string> job_ids;
+  std::error_code error;
+  for (std::filesystem::directory_iterator it(jobs_path(cache_dir), error);
+       !error && it != std::filesystem::directory_iterator();
+       it.increment(error)) {
+    if (it->path().extension() == ".queue") {
+      job_ids.push_back(it->path().stem().string());
+    }
+  }
+  std::sort(job_ids.begin(), job_ids.end()); // Oldest first
+
+  std::vector<JobProgress> results;
+  for (const auto &job_id : job_ids) {
+    if (deadline_missed()) {
+      break;
+    }
+    if (!get_job_progress(job_id, cache_dir).complete) {
+      results.push_back(run_download_job(job_id, cache_dir, deadline));
+    }
+  }
+  return results;
+}
+
+JobProgress get_job_progress(const std::string &job_id,
+                             const std::string &cache_dir) {
+  std::vector<JobEntry> entries;
+  if (!load_job(cache_dir, job_id, entries)) {
+    return JobProgress();
+  }
+  return progress_of(cache_dir, job_id, entries);
+}
+
+} // namespace huggingface_hub
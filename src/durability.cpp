@@ -0,0 +1,149 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <mutex>
+#include <set>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+std::mutex durability_mutex;
+DurabilityConfig durability_config;
+
+// Directories whose sync is deferred to the end of the current batch
+thread_local int batch_depth = 0;
+thread_local std::set<std::string> batched_directories;
+
+bool fsync_path(const std::string &path, int flags) {
+  int fd = open(path.c_str(), flags | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  bool synced = fsync(fd) == 0;
+  close(fd);
+  if (!synced) {
+    log_error("Failed to sync " + path);
+  }
+  return synced;
+}
+
+} // namespace
+
+void set_durability_config(const DurabilityConfig &config) {
+  std::lock_guard<std::mutex> lock(durability_mutex);
+  durability_config = config;
+}
+
+DurabilityConfig get_durability_config() {
+  std::lock_guard<std::mutex> lock(durability_mutex);
+  return durability_config;
+}
+
+void open_write_behind(WriteBehind &write_behind, const std::string &path) {
+  DurabilityConfig config = get_durability_config();
+  if (config.mode == DurabilityMode::NONE) {
+    return;
+  }
+  write_behind.fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  write_behind.window = config.write_behind_bytes;
+  struct stat stat_buf;
+  if (write_behind.fd >= 0 && fstat(write_behind.fd, &stat_buf) == 0) {
+    write_behind.started = stat_buf.st_size;
+  }
+  write_behind.waited = write_behind.started;
+}
+
+bool should_write_behind(const WriteBehind &write_behind, uint64_t pending) {
+  return write_behind.fd >= 0 && write_behind.window > 0 &&
+         pending >= write_behind.window;
+}
+
+void write_behind(WriteBehind &write_behind) {
+  struct stat stat_buf;
+  if (write_behind.fd < 0 || fstat(write_behind.fd, &stat_buf) != 0) {
+    return;
+  }
+  uint64_t end = stat_buf.st_size;
+  if (end <= write_behind.started) {
+    return;
+  }
+
+  // Start writeback of the new window, then wait for the previous one so
+  // the dirty pages of a blob stay bounded by about two windows
+  sync_file_range(write_behind.fd, write_behind.started,
+                  end - write_behind.started, SYNC_FILE_RANGE_WRITE);
+  if (write_behind.started > write_behind.waited) {
+    sync_file_range(write_behind.fd, write_behind.waited,
+                    write_behind.started - write_behind.waited,
+                    SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                        SYNC_FILE_RANGE_WAIT_AFTER);
+  }
+  write_behind.waited = write_behind.started;
+  write_behind.started = end;
+}
+
+bool close_write_behind(WriteBehind &write_behind, bool sync) {
+  if (write_behind.fd < 0) {
+    return true;
+  }
+  bool synced = !sync || fsync(write_behind.fd) == 0;
+  close(write_behind.fd);
+  write_behind.fd = -1;
+  return synced;
+}
+
+bool sync_file(const std::string &path) {
+  return fsync_path(path, O_RDONLY);
+}
+
+void sync_directory(const std::string &path) {
+  if (batch_depth > 0) {
+    batched_directories.insert(path);
+  } else {
+    fsync_path(path, O_RDONLY | O_DIRECTORY);
+  }
+}
+
+void begin_directory_sync_batch() { ++batch_depth; }
+
+void end_directory_sync_batch() {
+  if (batch_depth == 0 || --batch_depth > 0) {
+    return;
+  }
+  for (const auto &path : batched_directories) {
+    fsync_path(path, O_RDONLY | O_DIRECTORY);
+  }
+  log_debug("Synced " + std::to_string(batched_directories.size()) +
+            " directories");
+  batched_directories.clear();
+}
+
+} // namespace huggingface_hub
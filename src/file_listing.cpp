@@ -0,0 +1,170 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <cstring>
+#include <regex>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+const size_t OID_SIZE = 20;
+const size_t SHA256_SIZE = 32;
+
+std::string next_page_path(const std::string &headers) {
+  std::smatch match;
+  if (!std::regex_search(headers, match,
+                         std::regex(R"re(<([^>]+)>;\s*rel="next")re",
+                                    std::regex::icase))) {
+    return "";
+  }
+  std::string url = match[1];
+  std::string endpoint = get_hf_endpoint();
+  return url.rfind(endpoint, 0) == 0 ? url.substr(endpoint.size()) : "";
+}
+
+} // namespace
+
+std::string_view FileListing::path(size_t index) const {
+  return std::string_view(path_arena)
+      .substr(path_offsets[index],
+              path_offsets[index + 1] - path_offsets[index]);
+}
+
+bool FileListing::is_lfs(size_t index) const {
+  const uint8_t *digest = &sha256s[index * SHA256_SIZE];
+  return std::any_of(digest, digest + SHA256_SIZE,
+                     [](uint8_t byte) { return byte != 0; });
+}
+
+FileMetadata FileListing::metadata(size_t index) const {
+  FileMetadata metadata;
+  metadata.type = "file";
+  metadata.size = sizes[index];
+  metadata.oid = to_hex(&oids[index * OID_SIZE], OID_SIZE);
+  const uint8_t *commit = &commits[commit_ids[index] * OID_SIZE];
+  if (std::any_of(commit, commit + OID_SIZE,
+                  [](uint8_t byte) { return byte != 0; })) {
+    metadata.commit = to_hex(commit, OID_SIZE);
+  }
+  if (is_lfs(index)) {
+    metadata.sha256 = to_hex(&sha256s[index * SHA256_SIZE], SHA256_SIZE);
+  }
+  return metadata;
+}
+
+size_t FileListing::find(std::string_view file) const {
+  for (size_t i = 0; i < size(); ++i) {
+    if (path(i) == file) {
+      return i;
+    }
+  }
+  return size();
+}
+
+void FileListing::add(std::string_view file, const FileMetadata &metadata) {
+  if (path_offsets.empty()) {
+    path_offsets.push_back(0);
+  }
+  path_arena.append(file.data(), file.size());
+  path_offsets.push_back(path_arena.size());
+  sizes.push_back(metadata.size);
+
+  oids.resize(oids.size() + OID_SIZE);
+  if (!from_hex(metadata.oid, &oids[oids.size() - OID_SIZE], OID_SIZE)) {
+    memset(&oids[oids.size() - OID_SIZE], 0, OID_SIZE);
+  }
+  sha256s.resize(sha256s.size() + SHA256_SIZE);
+  if (!from_hex(metadata.sha256, &sha256s[sha256s.size() - SHA256_SIZE],
+                SHA256_SIZE)) {
+    memset(&sha256s[sha256s.size() - SHA256_SIZE], 0, SHA256_SIZE);
+  }
+
+  uint8_t commit[OID_SIZE] = {0};
+  from_hex(metadata.commit, commit, OID_SIZE);
+  auto inserted = commit_lookup.emplace(
+      std::string(reinterpret_cast<char *>(commit), OID_SIZE),
+      static_cast<uint32_t>(commit_lookup.size()));
+  if (inserted.second) {
+    commits.insert(commits.end(), commit, commit + OID_SIZE);
+  }
+  commit_ids.push_back(inserted.first->second);
+}
+
+std::variant<FileListing, std::string>
+list_repo_files(const std::string &repo_id, const std::string &repo_type,
+                const std::string &revision, const PatternSet &filter,
+                bool with_commits) {
+  FileListing listing;
+  std::string tree_path =
+      "/api/" + repo_type + "s/" + repo_id + "/tree/" + uri_encode(revision);
+  // Expanding each entry with its last commit makes the pages much slower
+  std::string query = filter.empty() ? "?recursive=true" : "";
+  if (with_commits) {
+    query += query.empty() ? "?expand=true" : "&expand=true";
+  }
+
+  // Without a filter one recursive walk lists everything; with one, each
+  // directory is listed only if some path below it can still match
+  std::vector<std::string> directories = {""};
+  size_t pruned = 0;
+  while (!directories.empty()) {
+    std::string directory = directories.back();
+    directories.pop_back();
+    std::string path = tree_path + (directory.empty() ? "" : "/") +
+                       uri_encode(directory, true) + query;
+
+    while (!path.empty()) {
+      std::string response, headers;
+      CURLcode res = api_get(path, response, headers);
+      if (res != CURLE_OK) {
+        return "CURL request failed: " + std::string(curl_easy_strerror(res));
+      }
+
+      for (const auto &object : split_json_objects(response)) {
+        std::string type = json_string_of(object, "type");
+        std::string file = json_string_of(object, "path");
+        if (type == "directory" && !filter.empty()) {
+          if (filter.may_match_under(file)) {
+            directories.push_back(file);
+          } else {
+            ++pruned;
+          }
+        } else if (type == "file" && filter.matches(file)) {
+          listing.add(file, extract_metadata(object));
+        }
+      }
+      path = next_page_path(headers);
+    }
+  }
+
+  log_debug("Listed " + std::to_string(listing.size()) + " files of " +
+            repo_id + ", skipped " + std::to_string(pruned) + " directories");
+  return listing;
+}
+
+} // namespace huggingface_hub
@@ -0,0 +1,293 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <cstring>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+// Headers are fetched in ranges of this size, tokenizer vocabularies in
+// the header can take several megabytes
+const uint64_t HEADER_RANGE = 4 * 1024 * 1024;
+const uint64_t MAX_HEADER_SIZE = 256 * 1024 * 1024;
+
+enum GgufType : uint32_t {
+  GGUF_TYPE_UINT8 = 0,
+  GGUF_TYPE_INT8 = 1,
+  GGUF_TYPE_UINT16 = 2,
+  GGUF_TYPE_INT16 = 3,
+  GGUF_TYPE_UINT32 = 4,
+  GGUF_TYPE_INT32 = 5,
+  GGUF_TYPE_FLOAT32 = 6,
+  GGUF_TYPE_BOOL = 7,
+  GGUF_TYPE_STRING = 8,
+  GGUF_TYPE_ARRAY = 9,
+  GGUF_TYPE_UINT64 = 10,
+  GGUF_TYPE_INT64 = 11,
+  GGUF_TYPE_FLOAT64 = 12,
+};
+
+// Size of a value of a fixed-size type, 0 for strings and arrays
+uint64_t type_size(uint32_t type) {
+  static const uint64_t sizes[] = {1, 1, 2, 2, 4, 4, 4, 1, 0, 0, 8, 8, 8};
+  return type < sizeof(sizes) / sizeof(sizes[0]) ? sizes[type] : 0;
+}
+
+// Body sink keeping at most `wanted` bytes, for servers ignoring the range
+struct RangeBuffer {
+  std::string data;
+  uint64_t wanted = 0;
+};
+
+size_t write_range_data(void *ptr, size_t size, size_t nmemb, void *stream) {
+  RangeBuffer *range = static_cast<RangeBuffer *>(stream);
+  size_t take = std::min<uint64_t>(size * nmemb, range->wanted -
+                                                     range->data.size());
+  range->data.append(static_cast<char *>(ptr), take);
+  return range->data.size() < range->wanted ? size * nmemb : 0;
+}
+
+// Sequential reader over a remote file, fetching ranges on demand
+class RemoteReader {
+public:
+  explicit RemoteReader(const std::string &url) : url_(url) {}
+
+  bool read(void *out, uint64_t size) {
+    if (!ensure(size)) {
+      return false;
+    }
+    memcpy(out, buffer_.data() + position_, size);
+    position_ += size;
+    return true;
+  }
+
+  template <typename T> bool read_integer(T &value) {
+    uint8_t bytes[sizeof(T)];
+    if (!read(bytes, sizeof(T))) {
+      return false;
+    }
+    uint64_t raw = 0;
+    for (size_t i = 0; i < sizeof(T); ++i) {
+      raw |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+    }
+    value = static_cast<T>(raw);
+    return true;
+  }
+
+  bool read_string(std::string &value) {
+    uint64_t length;
+    if (!read_integer(length) || length > MAX_HEADER_SIZE) {
+      return false;
+    }
+    value.resize(length);
+    return read(&value[0], length);
+  }
+
+  // Skip bytes without fetching them when they are not buffered yet
+  bool skip(uint64_t size) {
+    if (offset() + size > MAX_HEADER_SIZE) {
+      return false;
+    }
+    if (position_ + size <= buffer_.size()) {
+      position_ += size;
+    } else {
+      start_ = offset() + size;
+      buffer_.clear();
+      position_ = 0;
+    }
+    return true;
+  }
+
+  uint64_t offset() const { return start_ + position_; }
+
+private:
+  bool ensure(uint64_t size) {
+    if (position_ + size <= buffer_.size()) {
+      return true;
+    }
+    if (offset() + size > MAX_HEADER_SIZE || end_of_file_) {
+      return false;
+    }
+    buffer_.erase(0, position_);
+    start_ += position_;
+    position_ = 0;
+
+    RangeBuffer range;
+    range.wanted = std::max(HEADER_RANGE, size - buffer_.size());
+    uint64_t first = start_ + buffer_.size();
+    if (!fetch(first, range)) {
+      return false;
+    }
+    end_of_file_ = range.data.size() < range.wanted;
+    buffer_ += range.data;
+    return position_ + size <= buffer_.size();
+  }
+
+  bool fetch(uint64_t first, RangeBuffer &range) {
+    CURL *curl = create_curl_handle(false);
+    if (!curl) {
+      return false;
+    }
+    struct curl_slist *headers = append_auth_header(nullptr);
+    std::string bytes = std::to_string(first) + "-" +
+                        std::to_string(first + range.wanted - 1);
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_RANGE, bytes.c_str());
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+
+    HttpTransfer transfer;
+    transfer.url = url_;
+    transfer.write_function = write_range_data;
+    transfer.write_data = &range;
+    long status = 0;
+    transfer.status = &status;
+    CURLcode res = http_perform(curl, transfer);
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+
+    // A full response cut short once the range is read is fine, as long
+    // as it started at the first byte
+    bool cut_short =
+        res == CURLE_WRITE_ERROR && range.data.size() == range.wanted;
+    if ((res != CURLE_OK && !cut_short) || (status != 206 && first > 0)) {
+      log_error("Failed to fetch bytes " + bytes + " of " + url_ + ": " +
+                curl_easy_strerror(res));
+      return false;
+    }
+    return true;
+  }
+
+  std::string url_;
+  std::string buffer_;
+  uint64_t start_ = 0;    // File offset of buffer_[0]
+  uint64_t position_ = 0; // Read position in buffer_
+  bool end_of_file_ = false;
+};
+
+bool skip_value(RemoteReader &reader, uint32_t type, int depth = 0) {
+  if (type == GGUF_TYPE_STRING) {
+    uint64_t length;
+    return reader.read_integer(length) && reader.skip(length);
+  }
+  if (type == GGUF_TYPE_ARRAY) {
+    uint32_t element_type;
+    uint64_t count;
+    if (depth > 4 || !reader.read_integer(element_type) ||
+        !reader.read_integer(count)) {
+      return false;
+    }
+    uint64_t size = type_size(element_type);
+    if (size > 0) {
+      return count <= MAX_HEADER_SIZE / size && reader.skip(count * size);
+    }
+    for (uint64_t i = 0; i < count; ++i) {
+      if (!skip_value(reader, element_type, depth + 1)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  return type_size(type) > 0 && reader.skip(type_size(type));
+}
+
+// Read a small non-negative integer of any integer type
+bool read_integer_value(RemoteReader &reader, uint32_t type, int &value) {
+  uint64_t size = type_size(type);
+  if (size == 0 || type == GGUF_TYPE_FLOAT32 || type == GGUF_TYPE_FLOAT64 ||
+      type == GGUF_TYPE_BOOL) {
+    return false;
+  }
+  uint8_t bytes[8];
+  if (!reader.read(bytes, size)) {
+    return false;
+  }
+  uint64_t raw = 0;
+  for (uint64_t i = 0; i < size; ++i) {
+    raw |= static_cast<uint64_t>(bytes[i]) << (8 * i);
+  }
+  bool is_signed = type == GGUF_TYPE_INT8 || type == GGUF_TYPE_INT16 ||
+                   type == GGUF_TYPE_INT32 || type == GGUF_TYPE_INT64;
+  if ((is_signed && (bytes[size - 1] & 0x80)) || raw > 65535) {
+    return false;
+  }
+  value = static_cast<int>(raw);
+  return true;
+}
+
+} // namespace
+
+bool read_gguf_split(const std::string &url, GgufSplit &split) {
+  RemoteReader reader(url);
+  char magic[4];
+  uint32_t version;
+  uint64_t tensor_count, kv_count;
+  if (!reader.read(magic, sizeof(magic)) ||
+      memcmp(magic, "GGUF", sizeof(magic)) != 0 ||
+      !reader.read_integer(version) || version < 2 ||
+      !reader.read_integer(tensor_count) || !reader.read_integer(kv_count)) {
+    log_error(url + " is not a GGUF v2 or later file");
+    return false;
+  }
+
+  split = GgufSplit();
+  bool have_count = false, have_number = false;
+  for (uint64_t i = 0; i < kv_count && !(have_count && have_number); ++i) {
+    std::string key;
+    uint32_t type;
+    if (!reader.read_string(key) || !reader.read_integer(type)) {
+      log_error("Truncated GGUF header in " + url);
+      return false;
+    }
+    bool valid;
+    if (key == "split.count") {
+      valid = read_integer_value(reader, type, split.count);
+      have_count = true;
+    } else if (key == "split.no") {
+      valid = read_integer_value(reader, type, split.number);
+      have_number = true;
+    } else {
+      valid = skip_value(reader, type);
+    }
+    if (!valid) {
+      log_error("Invalid GGUF metadata " + key + " in " + url);
+      return false;
+    }
+  }
+
+  log_debug("GGUF header of " + url + " read up to byte " +
+            std::to_string(reader.offset()));
+  if (split.count < 1 || split.number < 0 || split.number >= split.count) {
+    log_error("Invalid GGUF split " + std::to_string(split.number) + " of " +
+              std::to_string(split.count) + " in " + url);
+    return false;
+  }
+  return true;
+}
+
+} // namespace huggingface_hub
@@ -22,21 +22,32 @@
 // SOFTWARE.
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cctype>
+#include <cstring>
 #include <csignal>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <regex>
+#include <set>
 #include <sstream>
+#include <thread>
 
 #include <curl/curl.h>
+#include <fcntl.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
 #include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
 
 namespace huggingface_hub {
 
@@ -89,27 +100,7 @@ std::filesystem::path expand_user_home(const std::string &path) {
 
 std::string create_cache_system(const std::string &cache_dir,
                                 const std::string &repo_id) {
-  std::string model_folder = std::string("models/" + repo_id);
-
-  size_t pos = 0;
-  while ((pos = model_folder.find("/", pos)) != std::string::npos) {
-    model_folder.replace(pos, 1, "--");
-    pos += 2;
-  }
-
-  std::string expanded_cache_dir = expand_user_home(cache_dir);
-
-  std::string model_cache_path = expanded_cache_dir + "/" + model_folder + "/";
-
-  std::string refs_path = model_cache_path + std::string("refs");
-  std::string blobs_path = model_cache_path + std::string("blobs");
-  std::string snapshots_path = model_cache_path + std::string("snapshots");
-
-  std::filesystem::create_directories(refs_path);
-  std::filesystem::create_directories(blobs_path);
-  std::filesystem::create_directories(snapshots_path);
-
-  return model_cache_path;
+  return open_repo_cache(cache_dir, repo_id)->path;
 }
 
 size_t write_string_data(void *ptr, size_t size, size_t nmemb, void *stream) {
@@ -136,6 +127,51 @@ size_t write_file_data(void *ptr, size_t size, size_t nmemb, void *stream) {
   return size * nmemb;
 }
 
+// A blob being downloaded and the writeback of its data
+struct BlobFile {
+  std::ofstream stream;
+  WriteBehind write_behind;
+  uint64_t pending = 0;
+  bool encoded = false; /**< Body is byte-plane encoded */
+  ByteplaneDecoder decoder;
+};
+
+bool store_blob_data(BlobFile *blob, const char *data, size_t size) {
+  blob->stream.write(data, size);
+  blob->pending += size;
+  if (should_write_behind(blob->write_behind, blob->pending)) {
+    blob->stream.flush();
+    write_behind(blob->write_behind);
+    blob->pending = 0;
+  }
+  return static_cast<bool>(blob->stream);
+}
+
+size_t write_blob_data(void *ptr, size_t size, size_t nmemb, void *stream) {
+  BlobFile *blob = static_cast<BlobFile *>(stream);
+  if (!blob->stream.is_open()) {
+    log_error("Error: output file stream is not open!");
+    return 0;
+  }
+  const char *data = static_cast<const char *>(ptr);
+  bool stored = blob->encoded ? blob->decoder.feed(data, size * nmemb)
+                              : store_blob_data(blob, data, size * nmemb);
+  return stored ? size * nmemb : 0;
+}
+
+// Notice when the server answers with the byte-plane encoding
+size_t read_blob_header(void *ptr, size_t size, size_t nmemb, void *stream) {
+  BlobFile *blob = static_cast<BlobFile *>(stream);
+  std::string line(static_cast<char *>(ptr), size * nmemb);
+  std::transform(line.begin(), line.end(), line.begin(), ::tolower);
+  if (line.rfind("http/", 0) == 0) {
+    blob->encoded = false; // A new response, e.g. after a redirect
+  } else if (line.rfind("x-byteplane-encoding:", 0) == 0) {
+    blob->encoded = line.find("zstd") != std::string::npos;
+  }
+  return size * nmemb;
+}
+
 // Extract metadata from JSON response
 FileMetadata extract_metadata(const std::string &json) {
   FileMetadata metadata;
@@ -173,41 +209,225 @@ FileMetadata extract_metadata(const std::string &json) {
   return metadata;
 }
 
-std::variant<struct FileMetadata, std::string>
-get_model_metadata_from_hf(const std::string &repo, const std::string &file) {
-  CURL *curl = curl_easy_init();
-  if (!curl) {
-    return "Failed to initialize CURL";
+std::string json_escape(const std::string &value) {
+  std::string escaped;
+  for (char c : value) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
   }
+  return escaped;
+}
 
-  std::string response, headers;
+// Percent-encode everything but unreserved characters, and slashes when
+// encoding a path
+std::string uri_encode(const std::string &value, bool keep_slashes) {
+  static const char digits[] = "0123456789ABCDEF";
+  std::string encoded;
+  for (unsigned char c : value) {
+    if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' ||
+        (c == '/' && keep_slashes)) {
+      encoded += static_cast<char>(c);
+    } else {
+      encoded += '%';
+      encoded += digits[c >> 4];
+      encoded += digits[c & 0xf];
+    }
+  }
+  return encoded;
+}
 
-  std::string url =
-      "https://huggingface.co/api/models/" + repo + "/paths-info/main";
-  const std::string body = "{\"paths\": [\"" + file + "\"], \"expand\": true}";
-
-  struct curl_slist *http_headers = NULL;
-  http_headers =
-      curl_slist_append(http_headers, "Content-Type: application/json");
-
-  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, http_headers);
-  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_string_data);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
-  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &headers);
-
-  CURLcode res = curl_easy_perform(curl);
-  curl_slist_free_all(http_headers);
-  curl_easy_cleanup(curl);
+std::string json_unescape(const std::string &value) {
+  std::string unescaped;
+  for (size_t i = 0; i < value.size(); ++i) {
+    if (value[i] != '\\' || i + 1 == value.size()) {
+      unescaped += value[i];
+      continue;
+    }
+    char c = value[++i];
+    if (c == 'n') {
+      unescaped += '\n';
+    } else if (c == 't') {
+      unescaped += '\t';
+    } else if (c == 'u' && i + 4 < value.size()) {
+      // Only the ASCII range is ever escaped in Hub answers
+      unescaped += static_cast<char>(std::stoi(value.substr(i + 1, 4), 0, 16));
+      i += 4;
+    } else {
+      unescaped += c;
+    }
+  }
+  return unescaped;
+}
+
+// Find the end of the JSON object or array starting at position start
+size_t json_match_bracket(const std::string &json, size_t start) {
+  int depth = 0;
+  bool in_string = false;
+  for (size_t i = start; i < json.size(); ++i) {
+    char c = json[i];
+    if (in_string) {
+      if (c == '\\') {
+        ++i;
+      } else if (c == '"') {
+        in_string = false;
+      }
+    } else if (c == '"') {
+      in_string = true;
+    } else if (c == '{' || c == '[') {
+      ++depth;
+    } else if ((c == '}' || c == ']') && --depth == 0) {
+      return i;
+    }
+  }
+  return std::string::npos;
+}
+
+std::vector<std::string> split_json_objects(const std::string &json) {
+  std::vector<std::string> objects;
+  size_t i = json.find('[');
+  if (i == std::string::npos) {
+    return objects;
+  }
+  for (++i; i < json.size(); ++i) {
+    if (json[i] == ']') {
+      break;
+    } else if (json[i] == '{') {
+      size_t end = json_match_bracket(json, i);
+      if (end == std::string::npos) {
+        break;
+      }
+      objects.push_back(json.substr(i, end - i + 1));
+      i = end;
+    }
+  }
+  return objects;
+}
+
+std::string json_value_of(const std::string &json, const std::string &key) {
+  std::smatch match;
+  if (!std::regex_search(json, match,
+                         std::regex("\"" + key + R"("\s*:\s*[\{\[])"))) {
+    return "";
+  }
+  size_t start = match.position(0) + match.length(0) - 1;
+  size_t end = json_match_bracket(json, start);
+  if (end == std::string::npos) {
+    return "";
+  }
+  return json.substr(start, end - start + 1);
+}
 
+std::string json_string_of(const std::string &json, const std::string &key) {
+  std::smatch match;
+  if (!std::regex_search(
+          json, match,
+          std::regex("\"" + key + R"re("\s*:\s*"((?:[^"\\]|\\.)*)")re"))) {
+    return "";
+  }
+  return json_unescape(match[1]);
+}
+
+typedef std::variant<struct FileMetadata, std::string> MetadataResult;
+
+// Fetch the metadata of several files of a repository in one request
+std::map<std::string, MetadataResult>
+fetch_paths_info(const std::string &repo,
+                 const std::vector<std::string> &files) {
+  std::map<std::string, MetadataResult> results;
+
+  std::string response;
+  std::string path = "/api/models/" + repo + "/paths-info/main";
+  std::string body = "{\"paths\": [";
+  for (size_t i = 0; i < files.size(); ++i) {
+    body += (i > 0 ? ", \"" : "\"") + json_escape(files[i]) + "\"";
+  }
+  body += "], \"expand\": true}";
+
+  CURLcode res = api_post(path, body, response);
+
+  for (const auto &file : files) {
+    if (res != CURLE_OK) {
+      results[file] =
+          "CURL request failed: " + std::string(curl_easy_strerror(res));
+    } else {
+      results[file] = "File " + file + " not found in " + repo;
+    }
+  }
   if (res != CURLE_OK) {
-    return "CURL request failed: " + std::string(curl_easy_strerror(res));
+    return results;
+  }
+
+  for (const auto &object : split_json_objects(response)) {
+    auto it = results.find(json_string_of(object, "path"));
+    if (it != results.end()) {
+      it->second = extract_metadata(object);
+    }
+  }
+  return results;
+}
+
+struct MetadataBatch {
+  std::vector<std::string> files;
+  bool done = false;
+  std::map<std::string, MetadataResult> results;
+};
+
+std::mutex coalescing_mutex;
+std::condition_variable coalescing_cv;
+MetadataCoalescingConfig coalescing_config;
+std::map<std::string, std::shared_ptr<MetadataBatch>> open_batches;
+
+void set_metadata_coalescing_config(const MetadataCoalescingConfig &config) {
+  std::lock_guard<std::mutex> lock(coalescing_mutex);
+  coalescing_config = config;
+}
+
+std::variant<struct FileMetadata, std::string>
+get_model_metadata_from_hf(const std::string &repo, const std::string &file) {
+  std::unique_lock<std::mutex> lock(coalescing_mutex);
+  MetadataCoalescingConfig config = coalescing_config;
+  std::string key = repo + "@main";
+
+  // Join a batch that is still collecting paths for this repository
+  auto it = open_batches.find(key);
+  if (config.window_ms > 0 && it != open_batches.end() &&
+      it->second->files.size() < config.max_paths) {
+    std::shared_ptr<MetadataBatch> batch = it->second;
+    if (std::find(batch->files.begin(), batch->files.end(), file) ==
+        batch->files.end()) {
+      batch->files.push_back(file);
+    }
+    count_coalesced_paths(1);
+    coalescing_cv.wait(lock, [&batch]() { return batch->done; });
+    return batch->results[file];
+  }
+
+  auto batch = std::make_shared<MetadataBatch>();
+  batch->files.push_back(file);
+  if (config.window_ms > 0) {
+    open_batches[key] = batch;
+    lock.unlock();
+    std::this_thread::sleep_for(std::chrono::milliseconds(config.window_ms));
+    lock.lock();
+    // A newer batch may have taken the key since
+    it = open_batches.find(key);
+    if (it != open_batches.end() && it->second == batch) {
+      open_batches.erase(it);
+    }
   }
+  std::vector<std::string> files = batch->files;
+  lock.unlock();
 
-  return extract_metadata(response);
+  std::map<std::string, MetadataResult> results =
+      fetch_paths_info(repo, files);
+
+  lock.lock();
+  batch->results = std::move(results);
+  batch->done = true;
+  coalescing_cv.notify_all();
+  return batch->results[file];
 }
 
 int get_terminal_width() {
@@ -222,12 +442,24 @@ int get_terminal_width() {
 std::chrono::steady_clock::time_point last_print_time =
     std::chrono::steady_clock::now();
 
+// What the progress callback of a blob download reports to
+struct DownloadProgress {
+  FileMetadata metadata;
+  uint64_t resume_from = 0;
+  TrackedTransfer *transfer = nullptr;
+};
+
 // Progress bar function
 int progress_callback(void *userdata, curl_off_t total, curl_off_t now,
                       curl_off_t, curl_off_t) {
   static auto start_time = std::chrono::steady_clock::now();
-  struct FileMetadata *metadata = static_cast<struct FileMetadata *>(userdata);
+  DownloadProgress *download = static_cast<DownloadProgress *>(userdata);
+  struct FileMetadata *metadata = &download->metadata;
   uint64_t size = metadata->size;
+  if (download->transfer && now > 0) {
+    download->transfer->set_state(TransferState::DOWNLOADING);
+    download->transfer->set_progress(download->resume_from + now, size);
+  }
   uint64_t byte_offset = total - size;
   uint64_t downloaded = now - byte_offset;
   int terminal_width = get_terminal_width();
@@ -270,7 +502,7 @@ int progress_callback(void *userdata, curl_off_t total, curl_off_t now,
              << "s";
     log_info_with_carriage_return(progress.str());
   }
-  if (stop_download) {
+  if (stop_download || !deadline_on_track(now)) {
     return 1; // Non-zero return value cancels the transfer
   }
 
@@ -279,67 +511,302 @@ int progress_callback(void *userdata, curl_off_t total, curl_off_t now,
 
 CURLcode perform_download(std::string url,
                           std::string blob_incomplete_file_path,
-                          bool force_download, struct FileMetadata metadata) {
-  CURL *curl = curl_easy_init();
+                          bool force_download, struct FileMetadata metadata,
+                          TrackedTransfer *tracked = nullptr) {
+  CURL *curl = create_curl_handle(false);
   if (!curl) {
     return CURLE_FAILED_INIT;
   }
 
-  std::ofstream file(blob_incomplete_file_path,
-                     std::ios::binary | std::ios::app);
+  BlobFile file;
+  file.stream.open(blob_incomplete_file_path,
+                   std::ios::binary | std::ios::app);
 
-  if (!file.is_open()) {
+  if (!file.stream.is_open()) {
     log_error("Error: failed to open file stream!");
     return CURLE_FAILED_INIT;
   }
 
-  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());   // Set URL
   curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L); // Follow redirects
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION,
-                   write_file_data);                // Write data to file
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &file); // File stream
-  curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);   // Enable progress callback
-  curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION,
-                   progress_callback); // Progress callback
-  curl_easy_setopt(curl, CURLOPT_PROGRESSDATA, &metadata);
+  file.decoder.sink = [&file](const char *data, size_t size) {
+    return store_blob_data(&file, data, size);
+  };
+
+  HttpTransfer transfer;
+  transfer.url = url;
+  transfer.write_function = write_blob_data;      // Write data to file
+  transfer.write_data = &file;                    // File stream
+  transfer.header_function = read_blob_header;
+  transfer.header_data = &file;
+  transfer.progress_function = progress_callback; // Progress callback
+  DownloadProgress progress;
+  progress.metadata = metadata;
+  progress.transfer = tracked;
+  transfer.progress_data = &progress;
 
   // Resume download if file exists
   long existing_size = get_file_size(blob_incomplete_file_path);
   if (existing_size > 0 && !force_download) {
-    curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE,
-                     (curl_off_t)existing_size);
+    transfer.resume_from = (curl_off_t)existing_size;
+    progress.resume_from = existing_size;
     log_info("Resuming download from " + std::to_string(existing_size) +
              " bytes...");
   }
 
+  // Encoded bodies cannot be resumed at a byte offset of the blob
+  struct curl_slist *headers = nullptr;
+  if (byteplane_enabled() && transfer.resume_from == 0) {
+    headers = curl_slist_append(headers, "X-Byteplane-Accept: zstd");
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  }
+
+  open_write_behind(file.write_behind, blob_incomplete_file_path);
+  if (tracked) {
+    tracked->set_state(TransferState::CONNECTING);
+    tracked->set_connections(1);
+  }
   fprintf(stderr, "\n"); // New line after progress bar
-  CURLcode res = curl_easy_perform(curl);
+  CURLcode res = http_perform(curl, transfer);
   fprintf(stderr, "\n"); // New line after progress bar
   curl_easy_cleanup(curl);
-  file.close();
+  curl_slist_free_all(headers);
+  file.stream.close();
+  if (file.encoded && res == CURLE_OK &&
+      !file.decoder.finish(metadata.sha256)) {
+    res = CURLE_WRITE_ERROR;
+  }
+  if (file.encoded && res == CURLE_WRITE_ERROR) {
+    // What was decoded cannot be trusted to resume from
+    log_error("Failed to decode " + url);
+    std::filesystem::remove(blob_incomplete_file_path);
+  }
+  if (tracked) {
+    tracked->set_connections(0);
+    tracked->set_state(TransferState::VERIFYING);
+  }
+
+  // The blob must be on disk before it is renamed under its final name
+  if (!close_write_behind(file.write_behind, res == CURLE_OK)) {
+    log_error("Failed to sync " + blob_incomplete_file_path);
+    res = CURLE_WRITE_ERROR;
+  }
   return res;
 }
 
+std::string blob_name_of(const FileMetadata &metadata) {
+  return metadata.sha256.empty() ? metadata.oid : metadata.sha256;
+}
+
+uint64_t blob_bytes_missing(RepoCache &cache, const FileMetadata &metadata) {
+  std::string blob_name = blob_name_of(metadata);
+  uint64_t partial_size = 0;
+  if (stat_at(cache.blobs->fd, blob_name)) {
+    return 0;
+  }
+  stat_at(cache.blobs->fd, blob_name + ".incomplete", &partial_size);
+  return metadata.size > partial_size ? metadata.size - partial_size : 0;
+}
+
+// Sync every directory from a path up to the snapshots/ folder
+void sync_snapshot_parents(const std::filesystem::path &path,
+                           const std::filesystem::path &snapshots_path) {
+  for (auto parent = path.parent_path();
+       parent.string().rfind(snapshots_path.string(), 0) == 0;
+       parent = parent.parent_path()) {
+    sync_directory(parent);
+  }
+}
+
+// Replace a file through a rename, so readers see the old or new content.
+// The temporary file is created exclusively with the final permissions, so
+// private content is never readable by others.
+bool write_file_atomically(const std::filesystem::path &path,
+                           const std::string &content, mode_t permissions) {
+  static std::atomic<uint64_t> temporary_counter(0);
+  std::filesystem::path temporary_path =
+      path.string() + ".tmp-" + std::to_string(getpid()) + "-" +
+      std::to_string(temporary_counter++);
+  int fd = open(temporary_path.c_str(),
+                O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, permissions);
+  bool written = fd >= 0;
+  for (size_t offset = 0; written && offset < content.size();) {
+    ssize_t count =
+        write(fd, content.data() + offset, content.size() - offset);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    written = count > 0;
+    offset += written ? count : 0;
+  }
+  bool full_durability = get_durability_config().mode == DurabilityMode::FULL;
+  if (written && full_durability && fsync(fd) != 0) {
+    written = false;
+  }
+  if (fd >= 0 && close(fd) != 0) {
+    written = false;
+  }
+  std::error_code error;
+  if (!written) {
+    log_error("Failed to write " + temporary_path.string());
+    if (fd >= 0) {
+      std::filesystem::remove(temporary_path, error);
+    }
+    return false;
+  }
+  std::filesystem::rename(temporary_path, path, error);
+  if (error) {
+    log_error("Failed to replace " + path.string() + ": " + error.message());
+    std::filesystem::remove(temporary_path, error);
+    return false;
+  }
+  if (full_durability) {
+    sync_directory(path.parent_path());
+  }
+  return true;
+}
+
+// Point a snapshot link at a blob; an existing link is replaced atomically.
+// The link is given relative to snapshots/, e.g. "<commit>/a/b.bin".
+bool link_snapshot_file(RepoCache &cache, const std::string &blob_file_path,
+                        const std::string &link) {
+  size_t slash = link.rfind('/');
+  DirectoryRef directory = snapshot_directory(cache, link.substr(0, slash));
+  if (!directory) {
+    return false;
+  }
+  std::string name = link.substr(slash + 1);
+  std::string temporary_name = name + ".tmp-" + std::to_string(getpid());
+  unlinkat(directory->fd, temporary_name.c_str(), 0);
+  if (symlinkat(blob_file_path.c_str(), directory->fd,
+                temporary_name.c_str()) != 0 ||
+      renameat(directory->fd, temporary_name.c_str(), directory->fd,
+               name.c_str()) != 0) {
+    log_error("Failed to link " + cache.path + "snapshots/" + link + ": " +
+              strerror(errno));
+    return false;
+  }
+  if (get_durability_config().mode == DurabilityMode::FULL) {
+    sync_snapshot_parents(cache.path + "snapshots/" + link,
+                          cache.path + "snapshots");
+  }
+  return true;
+}
+
+// Download a blob into blobs/ unless it is already there
+bool fetch_blob(const std::string &repo_id, const std::string &filename,
+                const std::string &revision, const std::string &cache_dir,
+                RepoCache &cache, const FileMetadata &metadata,
+                bool force_download, TrackedTransfer &transfer) {
+  std::string blob_name = blob_name_of(metadata);
+  std::string blob_incomplete_name = blob_name + ".incomplete";
+  if (stat_at(cache.blobs->fd, blob_name) && !force_download) {
+    return true;
+  }
+  if (!deadline_on_track()) {
+    return false;
+  }
+  std::string blob_incomplete_file_path =
+      cache.path + "blobs/" + blob_incomplete_name;
+
+  // Hold room for the bytes still to be written until the blob is done
+  uint64_t existing_size = 0;
+  stat_at(cache.blobs->fd, blob_incomplete_name, &existing_size);
+  transfer.set_progress(existing_size, metadata.size);
+  DiskSpaceReservation reservation;
+  if (!reserve_disk_space(
+          expand_user_home(cache_dir).string(),
+          metadata.size > existing_size ? metadata.size - existing_size : 0,
+          blob_incomplete_file_path, reservation.id)) {
+    return false;
+  }
+
+  // Another node may have downloaded the blob into the shared storage, or
+  // hold chunks of it in the swarm
+  std::string url = get_hf_endpoint() + "/" + repo_id + "/resolve/" +
+                    revision + "/" + filename;
+  DurabilityMode durability = get_durability_config().mode;
+  bool full_durability = durability == DurabilityMode::FULL;
+  bool shared = !force_download &&
+                fetch_shared_blob(repo_id, metadata, blob_incomplete_file_path);
+  bool swarmed = !shared && !force_download && swarm_enabled() &&
+                 swarm_download(url, metadata, blob_incomplete_file_path,
+                                transfer);
+  if (shared || swarmed) {
+    note_deadline_bytes(metadata.size - std::min(metadata.size, existing_size));
+  }
+  if (shared || swarmed) {
+    // Like a downloaded blob, it must be on disk before the rename
+    if (durability != DurabilityMode::NONE) {
+      sync_file(blob_incomplete_file_path);
+    }
+  } else {
+    // Within a deadline, a dropped transfer is resumed while time is left
+    CURLcode res;
+    for (int attempt = 0;; ++attempt) {
+      uint64_t before = get_file_size(blob_incomplete_file_path);
+      res = perform_download(url, blob_incomplete_file_path,
+                             force_download && attempt == 0, metadata,
+                             &transfer);
+      uint64_t after = get_file_size(blob_incomplete_file_path);
+      note_deadline_bytes(after > before ? after - before : 0);
+      if (res == CURLE_OK || stop_download ||
+          !deadline_allows_retry(res, attempt)) {
+        break;
+      }
+      transfer.add_retry();
+      log_info("Resuming " + filename + " within its deadline...");
+    }
+    if (stop_download) {
+      log_info("Download interrupted. Exiting...");
+      return false;
+    } else if (res != CURLE_OK) {
+      log_error("CURL request failed: " +
+                std::string(curl_easy_strerror(res)));
+      return false;
+    }
+  }
+
+  transfer.set_state(TransferState::PUBLISHING);
+  if (renameat(cache.blobs->fd, blob_incomplete_name.c_str(), cache.blobs->fd,
+               blob_name.c_str()) != 0) {
+    log_error("Failed to rename " + blob_incomplete_file_path + ": " +
+              strerror(errno));
+    return false;
+  }
+  if (full_durability) {
+    sync_directory(cache.path + "blobs");
+  }
+  if (!shared) {
+    publish_shared_blob(repo_id, blob_name, cache.path + "blobs/" + blob_name);
+  }
+  return true;
+}
+
 struct DownloadResult hf_hub_download(const std::string &repo_id,
                                       const std::string &filename,
                                       const std::string &cache_dir,
-                                      bool force_download, bool verbose) {
+                                      bool force_download, bool verbose,
+                                      const Deadline &deadline) {
   signal(SIGINT, handle_sigint);
   log_verbose = verbose;
+  DeadlineScope deadline_scope(deadline);
 
   struct DownloadResult result;
   result.success = true;
+  TrackedTransfer transfer(repo_id, filename);
 
   // 1. Check that model exists on Hugging Face
   auto metadata_result = get_model_metadata_from_hf(repo_id, filename);
   if (std::holds_alternative<std::string>(metadata_result)) {
     log_error(std::get<std::string>(metadata_result));
     result.success = false;
+    result.deadline_missed = deadline_missed();
     return result;
   }
 
   // 2. Create Cache Dir Struct
-  std::string cache_model_dir = create_cache_system(cache_dir, repo_id);
+  std::shared_ptr<RepoCache> cache = open_repo_cache(cache_dir, repo_id);
+  std::string cache_model_dir = cache->path;
   log_debug("Cache directory: " + cache_model_dir);
   log_info("Downloading " + filename + " from " + repo_id);
 
@@ -349,79 +816,55 @@ struct DownloadResult hf_hub_download(const std::string &repo_id,
   log_debug("Size: " + std::to_string(metadata.size) + " bytes");
   log_debug("SHA256: " + metadata.sha256);
 
-  std::filesystem::path blob_file_path;
-  std::filesystem::path blob_incomplete_file_path;
-
-  if (metadata.sha256.empty()) {
-    blob_file_path = cache_model_dir + "blobs/" + metadata.oid;
-    blob_incomplete_file_path =
-        cache_model_dir + "blobs/" + metadata.oid + ".incomplete";
-  } else {
-    blob_file_path = cache_model_dir + "blobs/" + metadata.sha256;
-    blob_incomplete_file_path =
-        cache_model_dir + "blobs/" + metadata.sha256 + ".incomplete";
-  }
-
-  std::filesystem::path snapshot_file_path(cache_model_dir + "snapshots/" +
-                                           metadata.commit + "/" + filename);
-  std::filesystem::path refs_file_path(cache_model_dir + "refs/main");
+  std::string blob_name = blob_name_of(metadata);
+  std::string link = metadata.commit + "/" + filename;
+  std::string snapshot_file_path = cache_model_dir + "snapshots/" + link;
 
   result.path = snapshot_file_path;
 
-  if (std::filesystem::exists(snapshot_file_path) &&
-      std::filesystem::exists(blob_file_path) && !force_download) {
+  if (stat_at(cache->snapshots->fd, link) &&
+      stat_at(cache->blobs->fd, blob_name) && !force_download) {
     log_info("Snapshot file exists. Skipping download...");
     return result;
   }
 
-  if (std::filesystem::exists(refs_file_path)) {
-    std::ifstream refs_file(refs_file_path);
-    std::string commit;
-    refs_file >> commit;
-    refs_file.close();
-  } else {
-    std::ofstream refs_file(refs_file_path);
-    refs_file << metadata.commit;
-    refs_file.close();
+  if (!stat_at(cache->refs->fd, "main")) {
+    write_file_atomically(cache_model_dir + "refs/main", metadata.commit);
   }
 
   // 3. Download the file
-  std::string url =
-      "https://huggingface.co/" + repo_id + "/resolve/main/" + filename;
-  std::filesystem::create_directories(snapshot_file_path.parent_path());
-
-  if (!std::filesystem::exists(blob_file_path) || force_download) {
-    CURLcode res = perform_download(url, blob_incomplete_file_path,
-                                    force_download, metadata);
-    result.success = res == CURLE_OK;
-
-    if (stop_download) {
-      log_info("Download interrupted. Exiting...");
-      return result;
-    } else if (!result.success) {
-      log_error("CURL request failed: " + std::string(curl_easy_strerror(res)));
-      return result;
-    } else {
-      std::filesystem::rename(blob_incomplete_file_path, blob_file_path);
-    }
+  plan_deadline_bytes(force_download ? metadata.size
+                                     : blob_bytes_missing(*cache, metadata));
+  if (!fetch_blob(repo_id, filename, "main", cache_dir, *cache, metadata,
+                  force_download, transfer)) {
+    result.success = false;
+    result.deadline_missed = deadline_missed();
+    return result;
   }
-
-  if (std::filesystem::exists(snapshot_file_path)) {
-    log_debug("Snapshot file exists. Deleting...");
-    std::filesystem::remove(snapshot_file_path);
+  transfer.set_state(TransferState::PUBLISHING);
+  if (!link_snapshot_file(*cache, cache_model_dir + "blobs/" + blob_name,
+                          link)) {
+    result.success = false;
+    return result;
   }
-  std::filesystem::create_symlink(blob_file_path, snapshot_file_path);
+  forget_memory_cache_paths(repo_id);
 
-  log_info("Downloaded to: " + snapshot_file_path.string());
+  log_info("Downloaded to: " + snapshot_file_path);
 
   result.success = true;
   return result;
 }
 
+// Shards of one file downloaded at the same time
+const int PARALLEL_SHARDS = 4;
+
 struct DownloadResult hf_hub_download_with_shards(const std::string &repo_id,
                                                   const std::string &filename,
                                                   const std::string &cache_dir,
-                                                  bool force_download) {
+                                                  bool force_download,
+                                                  const Deadline &deadline) {
+  // Shards share one budget
+  DeadlineScope deadline_scope(deadline);
 
   std::regex pattern(R"(-([0-9]+)-of-([0-9]+)\.(\w+))");
   std::smatch match;
@@ -430,28 +873,255 @@ struct DownloadResult hf_hub_download_with_shards(const std::string &repo_id,
     int total_shards = std::stoi(match[2]);
     std::string base_name = filename.substr(0, match.position(0));
     std::string extension = match[3];
-
-    // Download shards
-    for (int i = 1; i <= total_shards; ++i) {
+    auto shard_name = [&](int number) {
       char shard_file[512];
       snprintf(shard_file, sizeof(shard_file), "%s-%05d-of-%05d.%s",
-               base_name.c_str(), i, total_shards, extension.c_str());
-      auto aux_res =
-          hf_hub_download(repo_id, shard_file, cache_dir, force_download);
-
-      if (!aux_res.success) {
-        return aux_res;
+               base_name.c_str(), number, total_shards, extension.c_str());
+      return std::string(shard_file);
+    };
+
+    // A split GGUF records its place in the split in every shard; each
+    // header is checked against the names before the shard is downloaded
+    bool gguf = extension == "gguf";
+    auto check_split = [&](int index) {
+      std::string shard = shard_name(index + 1);
+      GgufSplit split;
+      if (!read_gguf_split(get_hf_endpoint() + "/" + repo_id +
+                               "/resolve/main/" + shard,
+                           split)) {
+        return false;
+      }
+      if (split.number != index || split.count != total_shards) {
+        log_error(shard + " is split " + std::to_string(split.number + 1) +
+                  " of " + std::to_string(split.count) + ", expected " +
+                  std::to_string(index + 1) + " of " +
+                  std::to_string(total_shards));
+        return false;
       }
+      return true;
+    };
+
+    struct DownloadResult failure;
+    failure.success = false;
+    if (gguf && !check_split(0)) {
+      failure.deadline_missed = deadline_missed();
+      return failure;
+    }
+
+    // Download shards, a few at a time
+    struct DownloadResult first;
+    std::mutex result_mutex;
+    std::atomic<int> next(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> threads;
+    int workers = std::max(1, std::min(PARALLEL_SHARDS, total_shards));
+    for (int worker = 0; worker < workers; ++worker) {
+      threads.emplace_back([&]() {
+        DeadlineScope scope(deadline, false);
+        int index;
+        while (!failed && (index = next++) < total_shards) {
+          struct DownloadResult result;
+          result.success = false;
+          if (!gguf || index == 0 || check_split(index)) {
+            result = hf_hub_download(repo_id, shard_name(index + 1),
+                                     cache_dir, force_download, false,
+                                     deadline);
+          }
+          result.deadline_missed = result.deadline_missed || deadline_missed();
+          std::lock_guard<std::mutex> lock(result_mutex);
+          if (!result.success && !failed.exchange(true)) {
+            failure = result;
+          } else if (index == 0) {
+            first = result;
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
     }
 
     // Return first shard
-    char first_shard[512];
-    snprintf(first_shard, sizeof(first_shard), "%s-00001-of-%05d.%s",
-             base_name.c_str(), total_shards, extension.c_str());
-    return hf_hub_download(repo_id, first_shard, cache_dir, false);
+    return failed ? failure : first;
+  }
+
+  return hf_hub_download(repo_id, filename, cache_dir, force_download, false,
+                         deadline);
+}
+
+// Move a staged snapshot tree into place. A missing snapshot appears with a
+// single rename; an existing one gains each link with its own rename.
+bool publish_snapshot(RepoCache &cache, const std::string &staging,
+                      const std::string &commit,
+                      const std::vector<std::string> &files) {
+  int snapshots = cache.snapshots->fd;
+  bool published = renameat2(snapshots, staging.c_str(), snapshots,
+                             commit.c_str(), RENAME_NOREPLACE) == 0;
+  if (!published && errno != EEXIST && errno != ENOTEMPTY) {
+    log_error("Failed to publish " + cache.path + "snapshots/" + commit +
+              ": " + strerror(errno));
+    return false;
+  }
+  bool full_durability = get_durability_config().mode == DurabilityMode::FULL;
+  if (published) {
+    // Syncs batched under the staging name would miss the renamed tree
+    forget_snapshot_directories(cache, staging, full_durability);
+    if (full_durability) {
+      sync_directory(cache.path + "snapshots");
+    }
+    return true;
+  }
+
+  for (const auto &file : files) {
+    size_t slash = file.rfind('/');
+    std::string folder =
+        slash == std::string::npos ? "" : "/" + file.substr(0, slash);
+    std::string name = file.substr(slash == std::string::npos ? 0 : slash + 1);
+    DirectoryRef from = snapshot_directory(cache, staging + folder);
+    DirectoryRef to = snapshot_directory(cache, commit + folder);
+    if (!from || !to ||
+        renameat(from->fd, name.c_str(), to->fd, name.c_str()) != 0) {
+      log_error("Failed to publish " + cache.path + "snapshots/" + commit +
+                "/" + file);
+      return false;
+    }
+    if (full_durability) {
+      sync_snapshot_parents(cache.path + "snapshots/" + commit + "/" + file,
+                            cache.path + "snapshots");
+    }
+  }
+  forget_snapshot_directories(cache, staging);
+  std::error_code error;
+  std::filesystem::remove_all(cache.path + "snapshots/" + staging, error);
+  return true;
+}
+
+std::set<std::string> read_snapshot_marker(const std::string &snapshot_path) {
+  std::set<std::string> files;
+  std::ifstream marker(snapshot_path + ".complete");
+  std::string file;
+  while (std::getline(marker, file)) {
+    if (!file.empty()) {
+      files.insert(file);
+    }
+  }
+  return files;
+}
+
+struct DownloadResult snapshot_download(const std::string &repo_id,
+                                        const PatternSet &filter,
+                                        const std::string &cache_dir,
+                                        bool force_download,
+                                        const Deadline &deadline) {
+  signal(SIGINT, handle_sigint);
+  DeadlineScope deadline_scope(deadline);
+  struct DownloadResult result;
+  result.success = false;
+
+  // 1. Resolve the revision, so every file lands in the same snapshot
+  std::string response, headers;
+  CURLcode res =
+      api_get("/api/models/" + repo_id + "/revision/main", response, headers);
+  std::string commit = json_string_of(response, "sha");
+  if (res != CURLE_OK || commit.empty()) {
+    log_error("Failed to resolve the revision of " + repo_id + ": " +
+              curl_easy_strerror(res));
+    result.deadline_missed = deadline_missed();
+    return result;
   }
 
-  return hf_hub_download(repo_id, filename, cache_dir, force_download);
+  auto listing_result = list_repo_files(repo_id, "model", commit, filter);
+  if (std::holds_alternative<std::string>(listing_result)) {
+    log_error(std::get<std::string>(listing_result));
+    result.deadline_missed = deadline_missed();
+    return result;
+  }
+  const FileListing &listing = std::get<FileListing>(listing_result);
+  log_info("Downloading " + std::to_string(listing.size()) + " files from " +
+           repo_id + " at " + commit);
+
+  // 2. Fetch the blobs and stage the links away from readers
+  std::shared_ptr<RepoCache> cache = open_repo_cache(cache_dir, repo_id);
+  std::string cache_model_dir = cache->path;
+  std::string snapshot_path = cache_model_dir + "snapshots/" + commit;
+  std::string staging = ".staging-" + commit + "-" + std::to_string(getpid());
+  std::error_code error;
+  std::filesystem::remove_all(cache_model_dir + "snapshots/" + staging, error);
+  forget_snapshot_directories(*cache, staging);
+  if (!snapshot_directory(*cache, staging)) {
+    return result;
+  }
+
+  // Files the deadline depends on go first, and the budget covers the bytes
+  // missing from the cache
+  std::vector<size_t> order(listing.size());
+  for (size_t i = 0; i < listing.size(); ++i) {
+    order[i] = i;
+    plan_deadline_bytes(force_download
+                            ? listing.sizes[i]
+                            : blob_bytes_missing(*cache, listing.metadata(i)));
+  }
+  if (!deadline.priority.empty()) {
+    std::stable_partition(order.begin(), order.end(), [&](size_t i) {
+      return deadline.priority.matches(listing.path(i));
+    });
+  }
+
+  // Directories shared by the files are synced once at the end
+  begin_directory_sync_batch();
+  std::set<std::string> files = read_snapshot_marker(snapshot_path);
+  std::vector<std::string> staged;
+  SnapshotManifest manifest;
+  for (size_t i : order) {
+    std::string filename(listing.path(i));
+    FileMetadata metadata = listing.metadata(i);
+    TrackedTransfer transfer(repo_id, filename);
+    if (!fetch_blob(repo_id, filename, commit, cache_dir, *cache, metadata,
+                    force_download, transfer) ||
+        !link_snapshot_file(*cache,
+                            cache_model_dir + "blobs/" + blob_name_of(metadata),
+                            staging + "/" + filename)) {
+      end_directory_sync_batch();
+      forget_snapshot_directories(*cache, staging);
+      std::filesystem::remove_all(cache_model_dir + "snapshots/" + staging,
+                                  error);
+      result.deadline_missed = deadline_missed();
+      return result;
+    }
+    staged.push_back(filename);
+    files.insert(filename);
+    manifest[filename] = blob_name_of(metadata);
+  }
+
+  // 3. Publish the tree, then the marker listing it, then the ref
+  std::string marker;
+  for (const auto &file : files) {
+    marker += file + "\n";
+  }
+  result.success =
+      publish_snapshot(*cache, staging, commit, staged) &&
+      write_file_atomically(snapshot_path + ".complete", marker) &&
+      write_file_atomically(cache_model_dir + "refs/main", commit);
+  end_directory_sync_batch();
+  forget_memory_cache_paths(repo_id);
+  if (result.success) {
+    publish_shared_snapshot(repo_id, "main", commit, manifest);
+  }
+
+  result.path = snapshot_path;
+  return result;
+}
+
+bool is_snapshot_complete(const std::string &snapshot_path,
+                          const std::vector<std::string> &files) {
+  std::set<std::string> published = read_snapshot_marker(snapshot_path);
+  if (published.empty()) {
+    return std::filesystem::exists(snapshot_path + ".complete") &&
+           files.empty();
+  }
+  return std::all_of(files.begin(), files.end(), [&](const std::string &file) {
+    return published.count(file) > 0;
+  });
 }
 
 } // namespace huggingface_hub
\ No newline at end of file
@@ -0,0 +1,754 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+/**
+ * @file huggingface_hub_internal.h
+ * @brief Internal helpers shared between the library translation units.
+ *
+ * Nothing in this header is installed or part of the public API.
+ */
+
+#ifndef HUGGINGFACE_HUB_INTERNAL_H
+#define HUGGINGFACE_HUB_INTERNAL_H
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+#include <sys/types.h>
+#ifdef HFHUB_HAVE_OPENSSL
+#include <openssl/ssl.h>
+#endif
+
+namespace huggingface_hub {
+
+struct FileMetadata;
+struct Deadline;
+
+void log_debug(const std::string &message);
+void log_info(const std::string &message);
+void log_error(const std::string &message);
+
+std::filesystem::path expand_user_home(const std::string &path);
+std::string create_cache_system(const std::string &cache_dir,
+                                const std::string &repo_id);
+
+long get_file_size(const std::string &filename);
+size_t write_string_data(void *ptr, size_t size, size_t nmemb, void *stream);
+
+/**
+ * @brief Reserve disk space in a cache root before a download.
+ *
+ * Waits for room according to the DiskSpaceConfig, running the configured
+ * cleanups once if space is short.
+ *
+ * @param root The cache root.
+ * @param bytes The bytes the download still has to write.
+ * @param partial_path The file the download writes to, whose growth counts
+ * against the reservation.
+ * @param id The reservation to release, 0 when admission control is off.
+ * @return False if the download does not fit.
+ */
+bool reserve_disk_space(const std::string &root, uint64_t bytes,
+                        const std::string &partial_path, uint64_t &id);
+
+/**
+ * @brief Release a reservation made by reserve_disk_space().
+ */
+void release_disk_space(uint64_t id);
+
+/**
+ * @struct WriteBehind
+ * @brief Progress of the writeback of a file being downloaded.
+ */
+struct WriteBehind {
+  int fd = -1;          /**< Read-only descriptor of the file, -1 if off */
+  uint64_t window = 0;  /**< Bytes handed to writeback at once */
+  uint64_t started = 0; /**< End of the range whose writeback was started */
+  uint64_t waited = 0;  /**< End of the range known to be on disk */
+};
+
+/**
+ * @brief Start tracking a partial file, unless durability is off.
+ */
+void open_write_behind(WriteBehind &write_behind, const std::string &path);
+
+/**
+ * @brief Check whether enough data is pending to start a writeback.
+ */
+bool should_write_behind(const WriteBehind &write_behind, uint64_t pending);
+
+/**
+ * @brief Start the writeback of the data written since the last call.
+ *
+ * Buffered data must be flushed to the file first.
+ */
+void write_behind(WriteBehind &write_behind);
+
+/**
+ * @brief Stop tracking a file.
+ *
+ * @param sync True to fsync the file first.
+ * @return False if the fsync failed.
+ */
+bool close_write_behind(WriteBehind &write_behind, bool sync);
+
+/**
+ * @brief Fsync a file by path.
+ */
+bool sync_file(const std::string &path);
+
+/**
+ * @brief Fsync a directory, or defer it to the end of the open batch.
+ */
+void sync_directory(const std::string &path);
+
+/**
+ * @brief Defer the directory syncs of this thread until the matching
+ * end_directory_sync_batch(); batches nest.
+ */
+void begin_directory_sync_batch();
+void end_directory_sync_batch();
+
+/**
+ * @struct DiskSpaceReservation
+ * @brief Releases a disk space reservation when it goes out of scope.
+ */
+struct DiskSpaceReservation {
+  uint64_t id = 0;
+  ~DiskSpaceReservation() { release_disk_space(id); }
+};
+
+enum class TransferState;
+struct TransferRecord;
+
+/**
+ * @struct TrackedTransfer
+ * @brief Lists a download in get_active_transfers() while it is in scope.
+ */
+struct TrackedTransfer {
+  std::shared_ptr<TransferRecord> record;
+
+  TrackedTransfer(const std::string &repo_id, const std::string &filename);
+  ~TrackedTransfer();
+
+  void set_state(TransferState state);
+  void set_progress(uint64_t done, uint64_t total);
+  void set_connections(int connections);
+  void add_retry();
+};
+
+/**
+ * @brief Drop the paths of a repository from the in-process file cache,
+ * after its refs changed.
+ */
+void forget_memory_cache_paths(const std::string &repo_id);
+
+/**
+ * @struct DirectoryHandle
+ * @brief An open directory descriptor, closed with its last reference.
+ */
+struct DirectoryHandle {
+  int fd = -1;
+  ~DirectoryHandle();
+};
+typedef std::shared_ptr<DirectoryHandle> DirectoryRef;
+
+/**
+ * @struct RepoCache
+ * @brief Open folders of a repository in the cache.
+ *
+ * Per-file operations resolve names relative to these descriptors instead
+ * of walking the whole cache path again.
+ */
+struct RepoCache {
+  std::string path; /**< Model folder, with a trailing "/" */
+  DirectoryRef refs;
+  DirectoryRef blobs;
+  DirectoryRef snapshots;
+
+  std::mutex mutex;
+  std::map<std::string, DirectoryRef> directories; /**< Created folders
+                                                        under snapshots/ */
+};
+
+/**
+ * @brief Name of the cache folder of a repository, "models--org--name".
+ */
+std::string repo_folder_name(const std::string &repo_id);
+
+/**
+ * @brief Open the folders of a repository in the cache, creating them.
+ *
+ * Folders are opened once per process, and again only if they were deleted.
+ */
+std::shared_ptr<RepoCache> open_repo_cache(const std::string &cache_dir,
+                                           const std::string &repo_id);
+
+/**
+ * @brief Open a folder under snapshots/, creating it and its parents once.
+ *
+ * @param relative Path relative to snapshots/, e.g. "<commit>/a/b".
+ * @return The folder, or nullptr if it could not be created.
+ */
+DirectoryRef snapshot_directory(RepoCache &cache, const std::string &relative);
+
+/**
+ * @brief Forget the open folders of a snapshot tree that was moved or removed.
+ *
+ * @param sync True to fsync the folders first, which reach them even after
+ * the tree was renamed.
+ */
+void forget_snapshot_directories(RepoCache &cache, const std::string &root,
+                                 bool sync = false);
+
+/**
+ * @brief statx() a name relative to a directory, following links.
+ *
+ * @return True if the name exists, with its size in size when not null.
+ */
+bool stat_at(int directory, const std::string &name,
+             uint64_t *size = nullptr);
+
+/**
+ * @brief Replace a file through a rename, so readers see the old or the new
+ * content.
+ *
+ * @param permissions Mode of the new file, before the umask.
+ */
+bool write_file_atomically(const std::filesystem::path &path,
+                           const std::string &content,
+                           mode_t permissions = 0644);
+
+/**
+ * @brief Point a snapshot link at a blob, replacing an existing link.
+ *
+ * @param link Path relative to snapshots/, e.g. "<commit>/a/b.bin".
+ */
+bool link_snapshot_file(RepoCache &cache, const std::string &blob_file_path,
+                        const std::string &link);
+
+/**
+ * @brief Name of the blob of a file in the cache.
+ */
+std::string blob_name_of(const FileMetadata &metadata);
+
+/**
+ * @brief Bytes a blob still needs, 0 if it is cached, less its partial
+ * file otherwise.
+ */
+uint64_t blob_bytes_missing(RepoCache &cache, const FileMetadata &metadata);
+
+/**
+ * @brief Download a blob into blobs/ unless it is already there.
+ */
+bool fetch_blob(const std::string &repo_id, const std::string &filename,
+                const std::string &revision, const std::string &cache_dir,
+                RepoCache &cache, const FileMetadata &metadata,
+                bool force_download, TrackedTransfer &transfer);
+
+/**
+ * @brief Copy a blob from the shared storage, if it holds it.
+ *
+ * Blobs named by SHA-256 are checked before they are accepted.
+ *
+ * @param local_path The file receiving the blob.
+ * @return False if there is no shared storage, it does not hold the blob or
+ * the copy failed.
+ */
+bool fetch_shared_blob(const std::string &repo_id,
+                       const FileMetadata &metadata,
+                       const std::string &local_path);
+
+/**
+ * @brief Copy a downloaded blob to the shared storage, if there is one.
+ */
+void publish_shared_blob(const std::string &repo_id, const std::string &blob,
+                         const std::string &local_path);
+
+/**
+ * @brief Record a downloaded snapshot and point the ref at it in the shared
+ * storage, if there is one.
+ */
+void publish_shared_snapshot(
+    const std::string &repo_id, const std::string &ref,
+    const std::string &commit,
+    const std::map<std::string, std::string> &manifest);
+
+/**
+ * @brief Compute the AWS Signature Version 4 authorization of an S3 request.
+ *
+ * @param path The URI-encoded request path.
+ * @param query The canonical query string, with sorted keys.
+ * @param headers The signed headers, lowercase names including host.
+ * @param payload_hash Hex SHA-256 of the body, or "UNSIGNED-PAYLOAD".
+ * @param amz_date The request time, as in the x-amz-date header.
+ * @return The Authorization header value.
+ */
+std::string sign_request(const std::string &method, const std::string &path,
+                         const std::string &query,
+                         const std::map<std::string, std::string> &headers,
+                         const std::string &payload_hash,
+                         const std::string &amz_date,
+                         const std::string &region,
+                         const std::string &access_key,
+                         const std::string &secret_key);
+
+std::string json_escape(const std::string &value);
+std::string json_unescape(const std::string &value);
+
+/**
+ * @brief Percent-encode a value for use in a URL path.
+ *
+ * @param value The value to encode.
+ * @param keep_slashes Leave '/' as is, for values holding several segments.
+ * @return The value with every byte outside the unreserved set encoded.
+ */
+std::string uri_encode(const std::string &value, bool keep_slashes = false);
+FileMetadata extract_metadata(const std::string &json);
+
+/**
+ * @brief Split a JSON array into its top-level objects.
+ *
+ * Parsing stops at the end of the array, so the input may continue with the
+ * rest of an enclosing document.
+ *
+ * @param json JSON text starting at (or before) the opening bracket.
+ * @return The text of each object of the array.
+ */
+std::vector<std::string> split_json_objects(const std::string &json);
+
+/**
+ * @brief Get the value of a key holding a JSON object or array.
+ *
+ * @param json The JSON text to search.
+ * @param key The key name.
+ * @return The text of the first matching value, empty if not found.
+ */
+std::string json_value_of(const std::string &json, const std::string &key);
+
+/**
+ * @brief Get the unescaped value of a key holding a JSON string.
+ *
+ * @param json The JSON text to search.
+ * @param key The key name.
+ * @return The first matching string, empty if not found.
+ */
+std::string json_string_of(const std::string &json, const std::string &key);
+
+/**
+ * @class Sha256
+ * @brief Incremental SHA-256 hash.
+ */
+class Sha256 {
+public:
+  Sha256();
+
+  void update(const void *data, size_t size);
+
+  /**
+   * @brief Write the 32-byte digest and reset the hash.
+   */
+  void digest(uint8_t out[32]);
+
+  /**
+   * @brief Get the hex digest and reset the hash.
+   */
+  std::string hex_digest();
+
+private:
+  void reset();
+  void transform(const uint8_t *block);
+
+  uint32_t state_[8];
+  uint64_t length_;
+  uint8_t buffer_[64];
+  size_t buffered_;
+};
+
+/**
+ * @brief True if blobs may be asked for with the byte-plane encoding.
+ */
+bool byteplane_enabled();
+
+/**
+ * @struct ByteplaneDecoder
+ * @brief Decodes a byte-plane encoded body as it arrives.
+ */
+struct ByteplaneDecoder {
+  /** Receives the decoded bytes in order, returns false to abort */
+  std::function<bool(const char *, size_t)> sink;
+
+  /**
+   * @brief Decode the complete frames of the received bytes.
+   *
+   * @return False if the stream is malformed or the sink failed.
+   */
+  bool feed(const char *data, size_t size);
+
+  /**
+   * @brief Check that the stream ended on a frame boundary and that the
+   * decoded bytes hash to expected_sha256, when it is not empty.
+   */
+  bool finish(const std::string &expected_sha256);
+
+  std::string buffer; /**< Received bytes of the incomplete frame */
+  bool started = false;
+  Sha256 hash;
+  uint64_t wire_bytes = 0;
+  uint64_t decoded_bytes = 0;
+};
+
+std::string to_hex(const uint8_t *data, size_t size);
+
+/**
+ * @brief Decode a hex string of exactly 2 * size digits.
+ *
+ * @return False if the string has another length or a non-hex digit.
+ */
+bool from_hex(const std::string &hex, uint8_t *out, size_t size);
+
+/**
+ * @brief Hash a file with SHA-256, reading it through mmap.
+ *
+ * @param path The file path.
+ * @return The hex digest, empty if the file cannot be read.
+ */
+std::string sha256_file(const std::string &path);
+
+/**
+ * @brief Get the Hub endpoint, honouring the HF_ENDPOINT variable.
+ *
+ * @return The endpoint URL without a trailing slash.
+ */
+std::string get_hf_endpoint();
+
+/**
+ * @brief Send a JSON POST request to the Hub API.
+ *
+ * The request is hedged according to the HedgingConfig when the session is
+ * live.
+ *
+ * @param path The API path, starting with a slash.
+ * @param body The JSON request body.
+ * @param response The response body.
+ * @return The CURL result code.
+ */
+CURLcode api_post(const std::string &path, const std::string &body,
+                  std::string &response);
+
+/**
+ * @brief Send a GET request to the Hub API.
+ *
+ * @param path The API path and query, starting with a slash.
+ * @param response The response body.
+ * @param headers The response headers.
+ * @return The CURL result code.
+ */
+CURLcode api_get(const std::string &path, std::string &response,
+                 std::string &headers);
+
+/**
+ * @brief Add the Hub authorization header, if a token is configured.
+ *
+ * The token is read from HF_TOKEN, or from the token file written by
+ * `huggingface-cli login`.
+ *
+ * @param headers The header list to extend.
+ * @return The extended header list.
+ */
+struct curl_slist *append_auth_header(struct curl_slist *headers);
+
+/**
+ * @brief Count paths whose metadata request was merged into another one.
+ *
+ * @param paths Number of merged paths.
+ */
+void count_coalesced_paths(size_t paths);
+
+/**
+ * @brief Apply the current TransportConfig to an easy handle.
+ *
+ * @param curl The easy handle.
+ * @param api_request True for API requests, which use the API timeout
+ * instead of the blob transfer timeout.
+ */
+void apply_transport_config(CURL *curl, bool api_request);
+
+/**
+ * @brief Create an easy handle configured with the current TransportConfig.
+ *
+ * @param api_request True for API requests, false for blob transfers.
+ * @return The new handle, or nullptr on failure.
+ */
+CURL *create_curl_handle(bool api_request);
+
+/**
+ * @brief Credit pre-warmed connections reused by a finished transfer.
+ *
+ * @param curl The easy handle after curl_easy_perform returned.
+ * @param url The requested URL.
+ */
+void note_connection_reuse(CURL *curl, const std::string &url);
+
+/**
+ * @brief Hand the persisted addresses and TLS sessions to a new handle.
+ *
+ * @param curl The easy handle.
+ */
+void apply_connection_cache(CURL *curl);
+
+/**
+ * @brief Save the address used by a finished transfer for later processes.
+ *
+ * @param curl The easy handle after curl_easy_perform returned.
+ * @param url The requested URL.
+ */
+void note_connection(CURL *curl, const std::string &url);
+
+/**
+ * @brief Let an idempotent request be sent as TLS 1.3 early data.
+ *
+ * @param curl The easy handle.
+ */
+void allow_early_data(CURL *curl);
+
+/**
+ * @brief Install the TLS hooks of the library on a new handle.
+ *
+ * Only has an effect when curl and the library both use OpenSSL.
+ *
+ * @param curl The easy handle.
+ */
+void apply_tls_hooks(CURL *curl);
+
+#ifdef HFHUB_HAVE_OPENSSL
+/**
+ * @brief Chain the session callback of curl to save new TLS sessions.
+ *
+ * @param ssl_context The context curl is about to connect with.
+ */
+void prepare_session_cache(SSL_CTX *ssl_context);
+
+/**
+ * @brief Offer a saved session when a handshake starts, and count
+ * resumptions when it is done.
+ *
+ * @param ssl The connection.
+ * @param where The SSL_CB_* state of the info callback.
+ */
+void note_session_handshake(SSL *ssl, int where);
+#endif
+
+/**
+ * @brief Signature of the body and header sinks of the transfer layer.
+ */
+typedef size_t (*write_callback)(void *ptr, size_t size, size_t nmemb,
+                                 void *stream);
+
+/**
+ * @struct HttpTransfer
+ * @brief Description of a single HTTP exchange going through the transfer
+ * layer.
+ *
+ * The transfer layer owns the URL, request body and callback options of the
+ * handle so that it can record or replay the exchange. Any other option
+ * (headers, redirects, ...) is set by the caller on the handle beforehand.
+ */
+struct HttpTransfer {
+  std::string method = "GET"; /**< HTTP method, used to match cassettes */
+  std::string url;            /**< Request URL */
+  std::string request_body;   /**< POST body, empty for GET requests */
+  curl_off_t resume_from = 0; /**< Byte offset to resume the response from */
+  write_callback write_function = nullptr;  /**< Body sink */
+  void *write_data = nullptr;               /**< Body sink user data */
+  write_callback header_function = nullptr; /**< Header sink */
+  void *header_data = nullptr;              /**< Header sink user data */
+  curl_xferinfo_callback progress_function = nullptr; /**< Progress sink */
+  void *progress_data = nullptr; /**< Progress sink user data */
+  curl_read_callback read_function = nullptr; /**< Streamed request body */
+  void *read_data = nullptr;     /**< Streamed request body user data */
+  curl_off_t upload_size = -1;   /**< Streamed body size, -1 if unknown */
+  long *status = nullptr;        /**< Receives the HTTP status, if set */
+};
+
+/**
+ * @struct MemoryReader
+ * @brief Request body source reading from a memory region.
+ */
+struct MemoryReader {
+  const char *data = nullptr; /**< Start of the region */
+  size_t size = 0;            /**< Size of the region */
+  size_t position = 0;        /**< Bytes already sent */
+};
+
+size_t read_memory_data(char *buffer, size_t size, size_t nitems,
+                        void *userdata);
+
+/**
+ * @brief Perform an HTTP exchange through the transfer layer.
+ *
+ * Depending on the session mode the exchange is sent over the network,
+ * sent and recorded to the active cassette, or served from a replayed
+ * cassette without touching the network.
+ *
+ * @param curl The easy handle, already configured with caller options.
+ * @param transfer The exchange description. Its status, if set, receives
+ * the HTTP status of the response, the recorded one when replaying.
+ * @return The CURL result code (recorded one when replaying).
+ */
+CURLcode http_perform(CURL *curl, const HttpTransfer &transfer);
+
+/**
+ * @brief Check whether requests go to the network without being recorded.
+ *
+ * @return False while recording or replaying a session.
+ */
+bool session_is_live();
+
+/**
+ * @struct GgufSplit
+ * @brief Split metadata of a GGUF file, as written by llama.cpp.
+ */
+struct GgufSplit {
+  int count = 1;  /**< Value of split.count, 1 if the file is not split */
+  int number = 0; /**< Value of split.no, 0 for the first shard */
+};
+
+/**
+ * @brief Read the split metadata from the header of a remote GGUF file.
+ *
+ * Only the key-value header is fetched, with range requests, and reading
+ * stops once both split keys are found.
+ *
+ * @param url The file URL.
+ * @param split The split metadata.
+ * @return False if the header cannot be fetched or is not a valid GGUF.
+ */
+bool read_gguf_split(const std::string &url, GgufSplit &split);
+
+/**
+ * @brief True if LFS blobs are downloaded through the swarm.
+ */
+bool swarm_enabled();
+
+/**
+ * @brief Download an LFS blob in chunks from peers and the origin.
+ *
+ * Chunks are written in place into path and served to peers as soon as
+ * they are complete. The blob is checked against metadata.sha256 at the
+ * end.
+ *
+ * @param url The origin URL of the blob.
+ * @param path The file receiving the blob, replaced.
+ * @return False if a chunk could not be fetched from the origin or the
+ * blob does not match its SHA-256.
+ */
+bool swarm_download(const std::string &url, const FileMetadata &metadata,
+                    const std::string &path, TrackedTransfer &transfer);
+
+/**
+ * @class DeadlineScope
+ * @brief Gives the download calls of this thread a deadline while in scope.
+ *
+ * A scope opened while another is active only tightens its deadline, so
+ * nested calls share the budget and the byte accounting of the outer one.
+ * Worker threads of a call open uncounted scopes to inherit its timeouts.
+ */
+class DeadlineScope {
+public:
+  explicit DeadlineScope(const Deadline &deadline, bool counted = true);
+  ~DeadlineScope();
+
+private:
+  bool owner_ = false;
+  std::chrono::steady_clock::time_point previous_;
+};
+
+/**
+ * @brief The deadline of this thread, unset outside a DeadlineScope.
+ */
+Deadline current_deadline();
+
+/**
+ * @brief Milliseconds left before the deadline of this thread, at least 1,
+ * or -1 without a deadline.
+ */
+long deadline_remaining_ms();
+
+/**
+ * @brief Add bytes the call still has to transfer.
+ */
+void plan_deadline_bytes(uint64_t bytes);
+
+/**
+ * @brief Account bytes of a finished transfer attempt.
+ */
+void note_deadline_bytes(uint64_t bytes);
+
+/**
+ * @brief Check that the deadline can still be met.
+ *
+ * @param in_flight Bytes received by the transfer in progress.
+ * @return False once the deadline passed, or the planned bytes cannot
+ * arrive in time at the measured throughput; the call is then given up.
+ */
+bool deadline_on_track(uint64_t in_flight = 0);
+
+/**
+ * @brief True if the call was given up because of its deadline, or the
+ * deadline passed.
+ */
+bool deadline_missed();
+
+/**
+ * @brief Decide whether a failed transfer is resumed within the deadline.
+ *
+ * Without a deadline transfers are not retried.
+ */
+bool deadline_allows_retry(CURLcode res, int attempt);
+
+/**
+ * @brief Check whether a wait fits in the deadline of this thread.
+ */
+bool deadline_allows_wait(long seconds);
+
+/**
+ * @brief Shorten the timeouts of a request to the deadline of this thread.
+ *
+ * The stall time is capped to a share of the time left, so a stalled
+ * transfer still leaves room to resume it.
+ */
+void apply_deadline_timeouts(long &connect_timeout_ms, long &timeout_ms,
+                             long &low_speed_time);
+
+} // namespace huggingface_hub
+
+#endif // HUGGINGFACE_HUB_INTERNAL_H
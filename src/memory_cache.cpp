@@ -0,0 +1,201 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+struct CachedBlob {
+  std::shared_ptr<const std::string> contents;
+  std::list<std::string>::iterator position; // In the recency list
+};
+
+struct IndexedPath {
+  std::string repo_id;
+  std::string blob; // Blob hash the path resolved to
+};
+
+std::mutex memory_mutex;
+MemoryCacheConfig memory_config;
+MemoryCacheStats memory_stats;
+std::list<std::string> recency; // Blob hashes, most recently used first
+std::unordered_map<std::string, CachedBlob> blobs;
+std::unordered_map<std::string, IndexedPath> paths;
+
+std::string path_key(const std::string &cache_dir, const std::string &repo_id,
+                     const std::string &revision,
+                     const std::string &filename) {
+  return cache_dir + "\n" + repo_id + "\n" + revision + "\n" + filename;
+}
+
+// Must be called with memory_mutex held
+void evict_to(uint64_t max_bytes) {
+  while (memory_stats.bytes > max_bytes && !recency.empty()) {
+    auto it = blobs.find(recency.back());
+    memory_stats.bytes -= it->second.contents->size();
+    ++memory_stats.evictions;
+    blobs.erase(it);
+    recency.pop_back();
+  }
+  memory_stats.entries = blobs.size();
+}
+
+// Find the snapshot file of a revision in the disk cache
+std::filesystem::path snapshot_file(const std::string &cache_dir,
+                                    const std::string &repo_id,
+                                    const std::string &revision,
+                                    const std::string &filename) {
+  std::filesystem::path model_path =
+      expand_user_home(cache_dir) / repo_folder_name(repo_id);
+
+  std::string commit = revision;
+  std::ifstream ref(model_path / "refs" / revision);
+  if (ref) {
+    std::getline(ref, commit);
+  }
+  return model_path / "snapshots" / commit / filename;
+}
+
+} // namespace
+
+void set_memory_cache_config(const MemoryCacheConfig &config) {
+  std::lock_guard<std::mutex> lock(memory_mutex);
+  memory_config = config;
+  evict_to(config.enabled ? config.max_bytes : 0);
+  if (!config.enabled) {
+    paths.clear();
+  }
+}
+
+MemoryCacheConfig get_memory_cache_config() {
+  std::lock_guard<std::mutex> lock(memory_mutex);
+  return memory_config;
+}
+
+MemoryCacheStats get_memory_cache_stats() {
+  std::lock_guard<std::mutex> lock(memory_mutex);
+  return memory_stats;
+}
+
+void clear_memory_cache() {
+  std::lock_guard<std::mutex> lock(memory_mutex);
+  blobs.clear();
+  recency.clear();
+  paths.clear();
+  memory_stats.bytes = 0;
+  memory_stats.entries = 0;
+}
+
+void forget_memory_cache_paths(const std::string &repo_id) {
+  std::lock_guard<std::mutex> lock(memory_mutex);
+  for (auto it = paths.begin(); it != paths.end();) {
+    it = it->second.repo_id == repo_id ? paths.erase(it) : std::next(it);
+  }
+}
+
+std::variant<std::shared_ptr<const std::string>, std::string>
+read_cached_file(const std::string &repo_id, const std::string &filename,
+                 const std::string &cache_dir, const std::string &revision) {
+  std::string key = path_key(cache_dir, repo_id, revision, filename);
+  {
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    auto path = paths.find(key);
+    auto blob = path != paths.end() ? blobs.find(path->second.blob)
+                                    : blobs.end();
+    if (blob != blobs.end()) {
+      recency.splice(recency.begin(), recency, blob->second.position);
+      ++memory_stats.hits;
+      return blob->second.contents;
+    }
+    ++memory_stats.misses;
+  }
+
+  // Read the blob from the disk cache, downloading it when it is missing
+  std::filesystem::path file_path =
+      snapshot_file(cache_dir, repo_id, revision, filename);
+  if (!std::filesystem::exists(file_path) && revision == "main") {
+    struct DownloadResult result =
+        hf_hub_download(repo_id, filename, cache_dir);
+    if (!result.success) {
+      return "Failed to download " + filename + " from " + repo_id;
+    }
+    file_path = result.path;
+  }
+  std::error_code error;
+  std::filesystem::path blob_path =
+      std::filesystem::canonical(file_path, error);
+  if (error) {
+    return "File " + filename + " of " + repo_id + " is not cached";
+  }
+
+  // Files the cache would not keep are only read when it is disabled, so a
+  // weights file is never pulled into memory by accident
+  uint64_t size = std::filesystem::file_size(blob_path, error);
+  if (error) {
+    return "Failed to read " + blob_path.string();
+  }
+  MemoryCacheConfig config = get_memory_cache_config();
+  if (config.enabled && size > config.max_file_size) {
+    return "File " + filename + " of " + repo_id + " is larger than " +
+           std::to_string(config.max_file_size) + " bytes";
+  }
+
+  std::ifstream file(blob_path, std::ios::binary);
+  std::string data(size, '\0');
+  if (!file.read(&data[0], size)) {
+    return "Failed to read " + blob_path.string();
+  }
+  auto contents = std::make_shared<const std::string>(std::move(data));
+
+  std::lock_guard<std::mutex> lock(memory_mutex);
+  if (!memory_config.enabled ||
+      contents->size() > memory_config.max_file_size ||
+      contents->size() > memory_config.max_bytes) {
+    return contents;
+  }
+  std::string blob = blob_path.filename().string();
+  paths[key] = {repo_id, blob};
+  auto it = blobs.find(blob);
+  if (it != blobs.end()) {
+    // Another path of the same blob was read meanwhile
+    recency.splice(recency.begin(), recency, it->second.position);
+    return it->second.contents;
+  }
+  recency.push_front(blob);
+  blobs[blob] = {contents, recency.begin()};
+  memory_stats.bytes += contents->size();
+  evict_to(memory_config.max_bytes);
+  return contents;
+}
+
+} // namespace huggingface_hub
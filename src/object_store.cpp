@@ -0,0 +1,644 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+// S3 rejects multipart parts below 5 MiB, except the last one, and uploads
+// of more than 10000 parts
+const uint64_t MIN_PART_SIZE = 5 * 1024 * 1024;
+const uint64_t MAX_PARTS = 10000;
+const int MAX_ATTEMPTS = 3;
+// Concurrent manifest merges each win in turn, so allow one per writer
+const int MAX_MERGE_ATTEMPTS = 16;
+
+const char UNSIGNED_PAYLOAD[] = "UNSIGNED-PAYLOAD";
+
+std::string sha256_hex(const std::string &data) {
+  Sha256 hash;
+  hash.update(data.data(), data.size());
+  return hash.hex_digest();
+}
+
+std::string hmac_sha256(const std::string &key, const std::string &message) {
+  uint8_t block[64] = {0};
+  if (key.size() > sizeof(block)) {
+    Sha256 hash;
+    hash.update(key.data(), key.size());
+    hash.digest(block);
+  } else {
+    memcpy(block, key.data(), key.size());
+  }
+
+  uint8_t pad[64];
+  uint8_t inner[32], outer[32];
+  Sha256 hash;
+  for (size_t i = 0; i < sizeof(pad); ++i) {
+    pad[i] = block[i] ^ 0x36;
+  }
+  hash.update(pad, sizeof(pad));
+  hash.update(message.data(), message.size());
+  hash.digest(inner);
+  for (size_t i = 0; i < sizeof(pad); ++i) {
+    pad[i] = block[i] ^ 0x5c;
+  }
+  hash.update(pad, sizeof(pad));
+  hash.update(inner, sizeof(inner));
+  hash.digest(outer);
+  return std::string(reinterpret_cast<char *>(outer), sizeof(outer));
+}
+
+// Find the text of the first <tag> element of an XML document
+std::string xml_value(const std::string &xml, const std::string &tag) {
+  size_t start = xml.find("<" + tag + ">");
+  if (start == std::string::npos) {
+    return "";
+  }
+  start += tag.size() + 2;
+  size_t end = xml.find("</" + tag + ">", start);
+  return end == std::string::npos ? "" : xml.substr(start, end - start);
+}
+
+// Find a response header of the last response, names are case-insensitive
+std::string header_value(const std::string &headers, const std::string &name) {
+  std::string value;
+  size_t start = 0;
+  while (start < headers.size()) {
+    size_t end = headers.find('\n', start);
+    std::string line = headers.substr(start, end - start);
+    start = end == std::string::npos ? headers.size() : end + 1;
+    size_t colon = line.find(':');
+    if (line.rfind("HTTP/", 0) == 0) {
+      value.clear();
+    } else if (colon == name.size() &&
+               strncasecmp(line.c_str(), name.c_str(), colon) == 0) {
+      value = line.substr(colon + 1);
+      value.erase(0, value.find_first_not_of(" \t"));
+      value.erase(value.find_last_not_of(" \t\r") + 1);
+    }
+  }
+  return value;
+}
+
+struct ObjectRequest {
+  std::string method = "GET";
+  std::string key;
+  std::string query; /**< Canonical query string, keys sorted */
+  std::string body;  /**< Small body, signed with its hash */
+  const char *upload = nullptr; /**< Streamed body, sent unsigned */
+  uint64_t upload_size = 0;
+  std::string range;         /**< Requested bytes, e.g. "0-1023" */
+  std::string if_match;      /**< ETag the object must still have */
+  std::string if_none_match; /**< "*" to write only a missing object */
+  write_callback write_function = write_string_data;
+  void *write_data = nullptr; /**< The response body if null */
+};
+
+struct ObjectResponse {
+  CURLcode code = CURLE_OK;
+  long status = 0;
+  std::string body;
+  std::string headers;
+
+  bool ok() const { return code == CURLE_OK && status / 100 == 2; }
+};
+
+// Body sink writing a ranged get at its place in the file
+struct RangeWriter {
+  int fd;
+  uint64_t offset;
+};
+
+size_t write_range_at(void *ptr, size_t size, size_t nmemb, void *stream) {
+  RangeWriter *writer = static_cast<RangeWriter *>(stream);
+  size_t length = size * nmemb;
+  const char *data = static_cast<const char *>(ptr);
+  size_t done = 0;
+  while (done < length) {
+    ssize_t count =
+        pwrite(writer->fd, data + done, length - done, writer->offset);
+    if (count <= 0) {
+      return 0;
+    }
+    done += count;
+    writer->offset += count;
+  }
+  return length;
+}
+
+// Run part jobs on a fixed number of threads, stopping at the first failure
+bool run_parts(size_t count, int workers,
+               const std::function<bool(size_t)> &work) {
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  std::vector<std::thread> threads;
+  int thread_count =
+      std::max(1, std::min<int>(workers, static_cast<int>(count)));
+  for (int i = 0; i < thread_count; ++i) {
+    threads.emplace_back([&]() {
+      size_t index;
+      while (!failed && (index = next++) < count) {
+        if (!work(index)) {
+          failed = true;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return !failed;
+}
+
+class ObjectStorage : public StorageBackend {
+public:
+  explicit ObjectStorage(const ObjectStoreConfig &config) : config_(config) {
+    while (!config_.endpoint.empty() && config_.endpoint.back() == '/') {
+      config_.endpoint.pop_back();
+    }
+    size_t scheme = config_.endpoint.find("://");
+    host_ = config_.endpoint.substr(
+        scheme == std::string::npos ? 0 : scheme + 3);
+    if (config_.access_key.empty() && std::getenv("AWS_ACCESS_KEY_ID")) {
+      config_.access_key = std::getenv("AWS_ACCESS_KEY_ID");
+    }
+    if (config_.secret_key.empty() && std::getenv("AWS_SECRET_ACCESS_KEY")) {
+      config_.secret_key = std::getenv("AWS_SECRET_ACCESS_KEY");
+    }
+    config_.part_size = std::max(config_.part_size, MIN_PART_SIZE);
+  }
+
+  bool put_blob(const std::string &repo_id, const std::string &blob,
+                const std::string &local_path) override {
+    int fd = open(local_path.c_str(), O_RDONLY);
+    struct stat stat_buf;
+    if (fd < 0 || fstat(fd, &stat_buf) != 0) {
+      log_error("Failed to open " + local_path);
+      if (fd >= 0) {
+        close(fd);
+      }
+      return false;
+    }
+    uint64_t size = stat_buf.st_size;
+    void *data = size > 0 ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)
+                          : nullptr;
+    close(fd);
+    if (data == MAP_FAILED) {
+      log_error("Failed to map " + local_path);
+      return false;
+    }
+
+    std::string key = blob_key(repo_id, blob);
+    const char *bytes = static_cast<const char *>(data);
+    bool stored = size <= config_.part_size
+                      ? put_object(key, bytes, size)
+                      : put_multipart(key, bytes, size);
+    if (data) {
+      munmap(data, size);
+    }
+    return stored;
+  }
+
+  bool get_blob(const std::string &repo_id, const std::string &blob,
+                const std::string &local_path) override {
+    std::string key = blob_key(repo_id, blob);
+    uint64_t size;
+    if (!stat_object(key, &size)) {
+      return false;
+    }
+    int fd = open(local_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, size) != 0) {
+      log_error("Failed to create " + local_path);
+      if (fd >= 0) {
+        close(fd);
+      }
+      return false;
+    }
+
+    // Ranges are fetched in parallel and written in place
+    uint64_t parts = (size + config_.part_size - 1) / config_.part_size;
+    bool fetched = run_parts(parts, config_.parallel_parts, [&](size_t i) {
+      uint64_t first = i * config_.part_size;
+      uint64_t last = std::min(size, first + config_.part_size) - 1;
+      for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+        RangeWriter writer{fd, first};
+        ObjectRequest request;
+        request.key = key;
+        request.range = std::to_string(first) + "-" + std::to_string(last);
+        request.write_function = write_range_at;
+        request.write_data = &writer;
+        if (send(request).ok() && writer.offset == last + 1) {
+          return true;
+        }
+      }
+      log_error("Failed to get bytes " + std::to_string(first) + "-" +
+                std::to_string(last) + " of " + key);
+      return false;
+    });
+    close(fd);
+    return fetched;
+  }
+
+  bool read_blob_range(const std::string &repo_id, const std::string &blob,
+                       uint64_t offset, uint64_t length,
+                       std::string &data) override {
+    if (length == 0) {
+      data.clear();
+      return true;
+    }
+    ObjectRequest request;
+    request.key = blob_key(repo_id, blob);
+    request.range =
+        std::to_string(offset) + "-" + std::to_string(offset + length - 1);
+    ObjectResponse response = send(request);
+    data = response.body;
+    return response.ok() && data.size() == length;
+  }
+
+  bool stat_blob(const std::string &repo_id, const std::string &blob,
+                 uint64_t *size) override {
+    return stat_object(blob_key(repo_id, blob), size);
+  }
+
+  std::string read_ref(const std::string &repo_id,
+                       const std::string &ref) override {
+    ObjectRequest request;
+    request.key = repo_key(repo_id) + "refs/" + ref;
+    ObjectResponse response = send(request);
+    std::string commit = response.ok() ? response.body : "";
+    commit.erase(commit.find_last_not_of(" \r\n") + 1);
+    return commit;
+  }
+
+  bool write_ref(const std::string &repo_id, const std::string &ref,
+                 const std::string &commit) override {
+    ObjectRequest request;
+    request.method = "PUT";
+    request.key = repo_key(repo_id) + "refs/" + ref;
+    request.body = commit;
+    return send(request).ok();
+  }
+
+  bool read_manifest(const std::string &repo_id, const std::string &commit,
+                     SnapshotManifest &manifest) override {
+    ObjectRequest request;
+    request.key = manifest_key(repo_id, commit);
+    ObjectResponse response = send(request);
+    if (!response.ok()) {
+      return false;
+    }
+    parse_manifest(response.body, manifest);
+    return true;
+  }
+
+  bool write_manifest(const std::string &repo_id, const std::string &commit,
+                      const SnapshotManifest &manifest) override {
+    ObjectRequest request;
+    request.method = "PUT";
+    request.key = manifest_key(repo_id, commit);
+    request.body = format_manifest(manifest);
+    return send(request).ok();
+  }
+
+  // The write is conditional on the manifest read: a writer that merged in
+  // between makes it fail with 412, or 409 while its write is in progress,
+  // and the merge starts over from its manifest
+  bool merge_manifest(const std::string &repo_id, const std::string &commit,
+                      const SnapshotManifest &files) override {
+    std::string key = manifest_key(repo_id, commit);
+    for (int attempt = 0; attempt < MAX_MERGE_ATTEMPTS; ++attempt) {
+      ObjectRequest read;
+      read.key = key;
+      ObjectResponse current = send(read);
+      if (current.code != CURLE_OK ||
+          (!current.ok() && current.status != 404)) {
+        return false;
+      }
+      SnapshotManifest merged;
+      if (current.ok()) {
+        parse_manifest(current.body, merged);
+      }
+      for (const auto &file : files) {
+        merged[file.first] = file.second;
+      }
+
+      ObjectRequest write;
+      write.method = "PUT";
+      write.key = key;
+      write.body = format_manifest(merged);
+      if (current.ok()) {
+        write.if_match = header_value(current.headers, "ETag");
+      } else {
+        write.if_none_match = "*";
+      }
+      ObjectResponse written = send(write);
+      if (written.ok()) {
+        return true;
+      }
+      if (written.status != 409 && written.status != 412) {
+        return false;
+      }
+      log_debug("Manifest " + key + " changed while merging, retrying");
+    }
+    log_error("Gave up merging the manifest " + key + " after " +
+              std::to_string(MAX_MERGE_ATTEMPTS) + " attempts");
+    return false;
+  }
+
+private:
+  std::string repo_key(const std::string &repo_id) const {
+    return config_.prefix + repo_folder_name(repo_id) + "/";
+  }
+
+  std::string blob_key(const std::string &repo_id,
+                       const std::string &blob) const {
+    return repo_key(repo_id) + "blobs/" + blob;
+  }
+
+  std::string manifest_key(const std::string &repo_id,
+                           const std::string &commit) const {
+    return repo_key(repo_id) + "snapshots/" + commit + ".manifest";
+  }
+
+  // Manifests hold one "<blob> <path>" line per file
+  static void parse_manifest(const std::string &text,
+                             SnapshotManifest &manifest) {
+    manifest.clear();
+    size_t start = 0;
+    while (start < text.size()) {
+      size_t end = text.find('\n', start);
+      std::string line = text.substr(start, end - start);
+      start = end == std::string::npos ? text.size() : end + 1;
+      size_t space = line.find(' ');
+      if (space != std::string::npos) {
+        manifest[line.substr(space + 1)] = line.substr(0, space);
+      }
+    }
+  }
+
+  static std::string format_manifest(const SnapshotManifest &manifest) {
+    std::string text;
+    for (const auto &file : manifest) {
+      text += file.second + " " + file.first + "\n";
+    }
+    return text;
+  }
+
+  bool stat_object(const std::string &key, uint64_t *size) {
+    ObjectRequest request;
+    request.method = "HEAD";
+    request.key = key;
+    ObjectResponse response = send(request);
+    if (!response.ok()) {
+      return false;
+    }
+    if (size) {
+      *size = std::stoull("0" + header_value(response.headers,
+                                             "Content-Length"));
+    }
+    return true;
+  }
+
+  bool put_object(const std::string &key, const char *data, uint64_t size) {
+    for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+      ObjectRequest request;
+      request.method = "PUT";
+      request.key = key;
+      request.upload = data;
+      request.upload_size = size;
+      if (send(request).ok()) {
+        return true;
+      }
+    }
+    log_error("Failed to put " + key);
+    return false;
+  }
+
+  bool put_multipart(const std::string &key, const char *data,
+                     uint64_t size) {
+    ObjectRequest create;
+    create.method = "POST";
+    create.key = key;
+    create.query = "uploads=";
+    ObjectResponse created = send(create);
+    std::string upload_id = xml_value(created.body, "UploadId");
+    if (!created.ok() || upload_id.empty()) {
+      log_error("Failed to start the upload of " + key);
+      return false;
+    }
+
+    uint64_t part_size =
+        std::max(config_.part_size, (size + MAX_PARTS - 1) / MAX_PARTS);
+    uint64_t parts = (size + part_size - 1) / part_size;
+    std::vector<std::string> etags(parts);
+    std::string upload_query = "uploadId=" + uri_encode(upload_id, false);
+    bool uploaded = run_parts(parts, config_.parallel_parts, [&](size_t i) {
+      uint64_t offset = i * part_size;
+      for (int attempt = 0; attempt < MAX_ATTEMPTS; ++attempt) {
+        ObjectRequest request;
+        request.method = "PUT";
+        request.key = key;
+        request.query =
+            "partNumber=" + std::to_string(i + 1) + "&" + upload_query;
+        request.upload = data + offset;
+        request.upload_size = std::min(part_size, size - offset);
+        ObjectResponse response = send(request);
+        etags[i] = header_value(response.headers, "ETag");
+        if (response.ok() && !etags[i].empty()) {
+          return true;
+        }
+      }
+      log_error("Failed to put part " + std::to_string(i + 1) + " of " +
+                key);
+      return false;
+    });
+
+    ObjectRequest complete;
+    complete.method = uploaded ? "POST" : "DELETE";
+    complete.key = key;
+    complete.query = upload_query;
+    if (uploaded) {
+      complete.body = "<CompleteMultipartUpload>";
+      for (size_t i = 0; i < parts; ++i) {
+        complete.body += "<Part><PartNumber>" + std::to_string(i + 1) +
+                         "</PartNumber><ETag>" + etags[i] +
+                         "</ETag></Part>";
+      }
+      complete.body += "</CompleteMultipartUpload>";
+    }
+    // Completing can fail after the 200 status, with an error in the body
+    ObjectResponse completed = send(complete);
+    if (!uploaded || !completed.ok() ||
+        completed.body.find("<Error>") != std::string::npos) {
+      log_error("Failed to complete the upload of " + key);
+      return false;
+    }
+    return true;
+  }
+
+  // Sign a request with AWS Signature Version 4 and send it
+  ObjectResponse send(const ObjectRequest &request) {
+    time_t now = time(nullptr);
+    struct tm utc;
+    gmtime_r(&now, &utc);
+    char amz_date[17];
+    strftime(amz_date, sizeof(amz_date), "%Y%m%dT%H%M%SZ", &utc);
+    std::string payload_hash =
+        request.upload ? UNSIGNED_PAYLOAD : sha256_hex(request.body);
+    std::string path =
+        "/" + config_.bucket + "/" + uri_encode(request.key, true);
+
+    std::map<std::string, std::string> headers = {
+        {"host", host_},
+        {"x-amz-content-sha256", payload_hash},
+        {"x-amz-date", amz_date}};
+    if (!request.range.empty()) {
+      headers["range"] = "bytes=" + request.range;
+    }
+    if (!request.if_match.empty()) {
+      headers["if-match"] = request.if_match;
+    }
+    if (!request.if_none_match.empty()) {
+      headers["if-none-match"] = request.if_none_match;
+    }
+    std::string authorization = sign_request(
+        request.method, path, request.query, headers, payload_hash, amz_date,
+        config_.region, config_.access_key, config_.secret_key);
+
+    ObjectResponse response;
+    CURL *curl = create_curl_handle(false);
+    if (!curl) {
+      response.code = CURLE_FAILED_INIT;
+      return response;
+    }
+    struct curl_slist *http_headers = nullptr;
+    for (const auto &header : headers) {
+      if (header.first != "host") {
+        http_headers = curl_slist_append(
+            http_headers, (header.first + ": " + header.second).c_str());
+      }
+    }
+    http_headers = curl_slist_append(
+        http_headers, ("Authorization: " + authorization).c_str());
+    // Bodies go out at once instead of waiting for 100-continue
+    http_headers = curl_slist_append(http_headers, "Expect:");
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, http_headers);
+    if (request.method == "HEAD") {
+      curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    }
+
+    HttpTransfer transfer;
+    transfer.method = request.method;
+    transfer.url = config_.endpoint + path +
+                   (request.query.empty() ? "" : "?" + request.query);
+    transfer.write_function = request.write_function;
+    transfer.write_data =
+        request.write_data ? request.write_data : &response.body;
+    transfer.header_function = write_string_data;
+    transfer.header_data = &response.headers;
+    MemoryReader reader;
+    if (request.upload || request.method == "PUT") {
+      reader.data = request.upload ? request.upload : request.body.data();
+      reader.size = request.upload ? request.upload_size : request.body.size();
+      transfer.method = "PUT";
+      transfer.read_function = read_memory_data;
+      transfer.read_data = &reader;
+      transfer.upload_size = reader.size;
+    } else {
+      transfer.request_body = request.body;
+    }
+
+    transfer.status = &response.status;
+    response.code = http_perform(curl, transfer);
+    curl_slist_free_all(http_headers);
+    curl_easy_cleanup(curl);
+    if (!response.ok()) {
+      log_debug(request.method + " " + transfer.url + " failed: " +
+                curl_easy_strerror(response.code) + " status " +
+                std::to_string(response.status));
+    }
+    return response;
+  }
+
+  ObjectStoreConfig config_;
+  std::string host_;
+};
+
+} // namespace
+
+std::string sign_request(const std::string &method, const std::string &path,
+                         const std::string &query,
+                         const std::map<std::string, std::string> &headers,
+                         const std::string &payload_hash,
+                         const std::string &amz_date,
+                         const std::string &region,
+                         const std::string &access_key,
+                         const std::string &secret_key) {
+  std::string canonical_headers, signed_headers;
+  for (const auto &header : headers) {
+    canonical_headers += header.first + ":" + header.second + "\n";
+    signed_headers += (signed_headers.empty() ? "" : ";") + header.first;
+  }
+  std::string canonical_request = method + "\n" + path + "\n" + query + "\n" +
+                                  canonical_headers + "\n" + signed_headers +
+                                  "\n" + payload_hash;
+
+  std::string date = amz_date.substr(0, 8);
+  std::string scope = date + "/" + region + "/s3/aws4_request";
+  std::string string_to_sign = "AWS4-HMAC-SHA256\n" + amz_date + "\n" +
+                               scope + "\n" + sha256_hex(canonical_request);
+  std::string key = hmac_sha256("AWS4" + secret_key, date);
+  key = hmac_sha256(key, region);
+  key = hmac_sha256(key, "s3");
+  key = hmac_sha256(key, "aws4_request");
+  std::string signature = hmac_sha256(key, string_to_sign);
+
+  return "AWS4-HMAC-SHA256 Credential=" + access_key + "/" + scope +
+         ", SignedHeaders=" + signed_headers + ", Signature=" +
+         to_hex(reinterpret_cast<const uint8_t *>(signature.data()),
+                signature.size());
+}
+
+std::shared_ptr<StorageBackend>
+create_object_storage(const ObjectStoreConfig &config) {
+  return std::make_shared<ObjectStorage>(config);
+}
+
+} // namespace huggingface_hub
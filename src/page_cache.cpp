@@ -0,0 +1,222 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <set>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+// Completion of each read-ahead is waited for in pieces of this size
+const size_t WAIT_BUFFER_SIZE = 1024 * 1024;
+
+struct WarmFile {
+  int fd = -1;
+  dev_t device = 0;
+  uint64_t size = 0;
+};
+
+struct WarmChunk {
+  size_t file = 0;
+  uint64_t offset = 0;
+  uint64_t length = 0;
+};
+
+std::filesystem::path model_cache_path(const std::string &cache_dir,
+                                       const std::string &repo_id) {
+  return expand_user_home(cache_dir) / repo_folder_name(repo_id);
+}
+
+uint64_t physical_memory() {
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long page_size = sysconf(_SC_PAGESIZE);
+  return pages > 0 && page_size > 0 ? (uint64_t)pages * page_size : 0;
+}
+
+// Queue the whole chunk at once so the device sees a deep queue, then read
+// it back to wait until the pages have landed
+uint64_t warm_chunk(const WarmFile &file, const WarmChunk &chunk,
+                    std::vector<char> &buffer) {
+  if (readahead(file.fd, chunk.offset, chunk.length) != 0) {
+    posix_fadvise(file.fd, chunk.offset, chunk.length, POSIX_FADV_WILLNEED);
+  }
+
+  uint64_t done = 0;
+  while (done < chunk.length) {
+    size_t length = std::min<uint64_t>(buffer.size(), chunk.length - done);
+    ssize_t count = pread(file.fd, buffer.data(), length, chunk.offset + done);
+    if (count <= 0) {
+      break;
+    }
+    done += count;
+  }
+  return done;
+}
+
+} // namespace
+
+WarmResult warm(const std::string &repo_id, const std::string &revision,
+                const std::vector<std::string> &files,
+                const WarmOptions &options) {
+  WarmResult result;
+  result.success = false;
+
+  // 1. Find the snapshot of the revision
+  std::filesystem::path model_path =
+      model_cache_path(options.cache_dir, repo_id);
+  std::string commit = revision;
+  std::ifstream ref(model_path / "refs" / revision);
+  if (ref) {
+    std::getline(ref, commit);
+  }
+  std::filesystem::path snapshot_path = model_path / "snapshots" / commit;
+  if (!std::filesystem::is_directory(snapshot_path)) {
+    log_error("No cached snapshot of " + repo_id + " at " + revision);
+    return result;
+  }
+
+  std::vector<std::string> targets = files;
+  if (targets.empty()) {
+    for (const auto &entry :
+         std::filesystem::recursive_directory_iterator(snapshot_path)) {
+      if (!entry.is_directory()) {
+        targets.push_back(
+            entry.path().lexically_relative(snapshot_path).string());
+      }
+    }
+  }
+
+  // 2. Open each blob once, up to the memory budget
+  uint64_t budget =
+      options.memory_budget > 0 ? options.memory_budget : physical_memory();
+  uint64_t chunk_size = std::max<uint64_t>(options.chunk_size, 1);
+  std::vector<WarmFile> blobs;
+  std::set<std::string> seen;
+  std::map<dev_t, std::vector<WarmChunk>> device_chunks;
+  uint64_t planned = 0;
+  for (const auto &target : targets) {
+    std::error_code error;
+    std::filesystem::path blob_path =
+        std::filesystem::canonical(snapshot_path / target, error);
+    struct stat stat_buf;
+    if (error || stat(blob_path.c_str(), &stat_buf) != 0) {
+      log_debug("Not cached: " + target);
+      ++result.files_missing;
+      continue;
+    }
+    if (!seen.insert(blob_path.string()).second) {
+      continue;
+    }
+    if (planned >= budget) {
+      result.budget_reached = true;
+      break;
+    }
+
+    WarmFile blob;
+    blob.fd = open(blob_path.c_str(), O_RDONLY);
+    if (blob.fd < 0) {
+      ++result.files_missing;
+      continue;
+    }
+    blob.device = stat_buf.st_dev;
+    blob.size = std::min<uint64_t>(stat_buf.st_size, budget - planned);
+    result.budget_reached = blob.size < (uint64_t)stat_buf.st_size;
+    planned += blob.size;
+
+    for (uint64_t offset = 0; offset < blob.size; offset += chunk_size) {
+      device_chunks[blob.device].push_back(
+          {blobs.size(), offset, std::min(chunk_size, blob.size - offset)});
+    }
+    blobs.push_back(blob);
+  }
+
+  // Interleave the devices so every one of them has reads in flight
+  std::vector<WarmChunk> chunks;
+  for (size_t i = 0;; ++i) {
+    bool added = false;
+    for (const auto &entry : device_chunks) {
+      if (i < entry.second.size()) {
+        chunks.push_back(entry.second[i]);
+        added = true;
+      }
+    }
+    if (!added) {
+      break;
+    }
+  }
+
+  // 3. Read the chunks in parallel
+  std::atomic<size_t> next_chunk(0);
+  std::atomic<uint64_t> bytes_warmed(0);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> workers;
+  size_t worker_count = std::min<size_t>(
+      std::max(options.parallel_reads, 1), std::max<size_t>(chunks.size(), 1));
+  for (size_t i = 0; i < worker_count; ++i) {
+    workers.emplace_back([&]() {
+      std::vector<char> buffer(WAIT_BUFFER_SIZE);
+      for (size_t index = next_chunk++; index < chunks.size();
+           index = next_chunk++) {
+        const WarmChunk &chunk = chunks[index];
+        bytes_warmed += warm_chunk(blobs[chunk.file], chunk, buffer);
+      }
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  result.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  for (const auto &blob : blobs) {
+    close(blob.fd);
+  }
+
+  result.files_warmed = blobs.size();
+  result.bytes_warmed = bytes_warmed;
+  if (result.seconds > 0) {
+    result.gigabytes_per_second = result.bytes_warmed / result.seconds / 1e9;
+  }
+  result.success = result.files_missing == 0;
+  log_info("Warmed " + std::to_string(result.files_warmed) + " files (" +
+           std::to_string(result.bytes_warmed) + " bytes) at " +
+           std::to_string(result.gigabytes_per_second) + " GB/s");
+  return result;
+}
+
+} // namespace huggingface_hub
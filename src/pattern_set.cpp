@@ -0,0 +1,409 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <array>
+#include <bitset>
+#include <map>
+#include <mutex>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+enum class PositionType {
+  LITERAL,  // One given byte
+  ANY,      // One byte other than '/'
+  CLASS,    // One byte of a bracket expression, other than '/'
+  STAR,     // Any run of bytes other than '/'
+  GLOBSTAR, // Any run of bytes, '/' included
+  SKIP,     // Before "**/", which may also match no directory at all
+  ACCEPT,   // The whole pattern matched
+  STICKY    // A parent directory matched, so every deeper path matches
+};
+
+struct Position {
+  PositionType type;
+  uint8_t literal = 0;
+  std::bitset<256> set;
+  size_t pattern = 0;
+};
+
+struct Pattern {
+  bool negated = false;
+  size_t first = 0;
+  size_t accept = 0;
+};
+
+typedef std::vector<uint64_t> StateSet;
+
+} // namespace
+
+// NFA of every pattern side by side, turned lazily into a DFA while paths
+// are matched. Positions of pattern p run from patterns[p].first to its
+// accept position, which is followed by its sticky position.
+struct PatternAutomaton {
+  std::vector<Pattern> patterns;
+  std::vector<Position> positions;
+  std::vector<bool> universal;
+  bool has_positive = false;
+
+  std::mutex mutex;
+  std::map<StateSet, int32_t> state_ids;
+  std::vector<StateSet> states;
+  std::vector<std::array<int32_t, 256>> transitions;
+  std::vector<int8_t> verdicts;
+  std::vector<int8_t> subtree_verdicts;
+
+  void compile(const std::string &pattern);
+  void close(StateSet &set) const;
+  int32_t intern(StateSet set);
+  int32_t step(int32_t state, uint8_t byte);
+  int32_t run(std::string_view text);
+  bool verdict(int32_t state);
+  bool subtree_verdict(int32_t state);
+};
+
+namespace {
+
+bool has_bit(const StateSet &set, size_t bit) {
+  return (set[bit / 64] >> (bit % 64)) & 1;
+}
+
+void set_bit(StateSet &set, size_t bit) {
+  set[bit / 64] |= uint64_t(1) << (bit % 64);
+}
+
+// Parse a bracket expression starting after '['; returns the index of the
+// closing ']', or npos if there is none
+size_t parse_class(const std::string &pattern, size_t start,
+                   std::bitset<256> &set) {
+  size_t i = start;
+  bool negated = i < pattern.size() && (pattern[i] == '!' || pattern[i] == '^');
+  if (negated) {
+    ++i;
+  }
+  for (bool first = true; i < pattern.size(); first = false) {
+    if (pattern[i] == ']' && !first) {
+      if (negated) {
+        set.flip();
+      }
+      return i;
+    }
+    uint8_t low = pattern[i];
+    if (i + 2 < pattern.size() && pattern[i + 1] == '-' &&
+        pattern[i + 2] != ']') {
+      for (int c = low; c <= static_cast<uint8_t>(pattern[i + 2]); ++c) {
+        set.set(c);
+      }
+      i += 3;
+    } else {
+      set.set(low);
+      ++i;
+    }
+  }
+  return std::string::npos;
+}
+
+} // namespace
+
+void PatternAutomaton::compile(const std::string &text) {
+  Pattern pattern;
+  std::string glob = text;
+  if (!glob.empty() && glob[0] == '!') {
+    pattern.negated = true;
+    glob = glob.substr(1);
+  }
+  has_positive = has_positive || !pattern.negated;
+  while (glob.size() > 1 && glob.back() == '/') {
+    glob.pop_back();
+  }
+
+  size_t index = patterns.size();
+  pattern.first = positions.size();
+  auto add = [&](PositionType type) -> Position & {
+    Position position;
+    position.type = type;
+    position.pattern = index;
+    positions.push_back(position);
+    return positions.back();
+  };
+
+  // Patterns without a slash match a name at any depth
+  if (glob.find('/') == std::string::npos) {
+    add(PositionType::SKIP);
+    add(PositionType::GLOBSTAR);
+    add(PositionType::LITERAL).literal = '/';
+  } else if (glob[0] == '/') {
+    glob = glob.substr(1);
+  }
+
+  for (size_t i = 0; i < glob.size(); ++i) {
+    char c = glob[i];
+    if (c == '*' && i + 1 < glob.size() && glob[i + 1] == '*') {
+      // Only a whole "**/" segment may stand for no directory; skipping it
+      // after the globstar consumed bytes would drop a '/' inside a name
+      bool segment = (i == 0 || glob[i - 1] == '/') && i + 2 < glob.size() &&
+                     glob[i + 2] == '/';
+      if (segment) {
+        add(PositionType::SKIP);
+      }
+      add(PositionType::GLOBSTAR);
+      i += 1;
+      if (i + 1 < glob.size() && glob[i + 1] == '/') {
+        add(PositionType::LITERAL).literal = '/';
+        i += 1;
+      }
+    } else if (c == '*') {
+      add(PositionType::STAR);
+    } else if (c == '?') {
+      add(PositionType::ANY);
+    } else if (c == '[') {
+      std::bitset<256> set;
+      size_t end = parse_class(glob, i + 1, set);
+      if (end == std::string::npos) {
+        add(PositionType::LITERAL).literal = '[';
+      } else {
+        add(PositionType::CLASS).set = set;
+        i = end;
+      }
+    } else if (c == '\\' && i + 1 < glob.size()) {
+      add(PositionType::LITERAL).literal = glob[++i];
+    } else {
+      add(PositionType::LITERAL).literal = c;
+    }
+  }
+
+  pattern.accept = positions.size();
+  add(PositionType::ACCEPT);
+  add(PositionType::STICKY);
+  patterns.push_back(pattern);
+}
+
+void PatternAutomaton::close(StateSet &set) const {
+  // Empty moves only go forward, so one ascending sweep reaches a fixpoint
+  for (size_t i = 0; i < positions.size(); ++i) {
+    if (!has_bit(set, i)) {
+      continue;
+    }
+    const Position &position = positions[i];
+    if (position.type == PositionType::STAR ||
+        position.type == PositionType::GLOBSTAR) {
+      set_bit(set, i + 1);
+    } else if (position.type == PositionType::SKIP) {
+      // Into the globstar, or past it and its slash
+      set_bit(set, i + 1);
+      set_bit(set, i + 3);
+    }
+  }
+}
+
+int32_t PatternAutomaton::intern(StateSet set) {
+  auto it = state_ids.find(set);
+  if (it != state_ids.end()) {
+    return it->second;
+  }
+  int32_t id = static_cast<int32_t>(states.size());
+  state_ids[set] = id;
+  states.push_back(std::move(set));
+  std::array<int32_t, 256> unknown;
+  unknown.fill(-1);
+  transitions.push_back(unknown);
+  verdicts.push_back(-1);
+  subtree_verdicts.push_back(-1);
+  return id;
+}
+
+int32_t PatternAutomaton::step(int32_t state, uint8_t byte) {
+  int32_t next = transitions[state][byte];
+  if (next >= 0) {
+    return next;
+  }
+
+  const StateSet &current = states[state];
+  StateSet set(current.size(), 0);
+  for (size_t i = 0; i < positions.size(); ++i) {
+    if (!has_bit(current, i)) {
+      continue;
+    }
+    const Position &position = positions[i];
+    switch (position.type) {
+    case PositionType::LITERAL:
+      if (byte == position.literal) {
+        set_bit(set, i + 1);
+      }
+      break;
+    case PositionType::ANY:
+      if (byte != '/') {
+        set_bit(set, i + 1);
+      }
+      break;
+    case PositionType::CLASS:
+      if (byte != '/' && position.set.test(byte)) {
+        set_bit(set, i + 1);
+      }
+      break;
+    case PositionType::STAR:
+      if (byte != '/') {
+        set_bit(set, i);
+      }
+      break;
+    case PositionType::GLOBSTAR:
+    case PositionType::STICKY:
+      set_bit(set, i);
+      break;
+    case PositionType::SKIP:
+      break;
+    case PositionType::ACCEPT:
+      // A matched directory covers every path below it
+      if (byte == '/') {
+        set_bit(set, i + 1);
+      }
+      break;
+    }
+  }
+  close(set);
+
+  next = intern(std::move(set));
+  transitions[state][byte] = next;
+  return next;
+}
+
+int32_t PatternAutomaton::run(std::string_view text) {
+  int32_t state = 0;
+  for (char c : text) {
+    state = step(state, static_cast<uint8_t>(c));
+  }
+  return state;
+}
+
+bool PatternAutomaton::verdict(int32_t state) {
+  if (verdicts[state] < 0) {
+    // The last matching pattern decides; with none, only positive-free sets
+    // select the path
+    bool selected = !has_positive;
+    for (const auto &pattern : patterns) {
+      if (has_bit(states[state], pattern.accept) ||
+          has_bit(states[state], pattern.accept + 1)) {
+        selected = !pattern.negated;
+      }
+    }
+    verdicts[state] = selected;
+  }
+  return verdicts[state];
+}
+
+bool PatternAutomaton::subtree_verdict(int32_t state) {
+  if (subtree_verdicts[state] < 0) {
+    // A pattern is certain to match every deeper path once it is sticky or
+    // only stars are left, and may match any path while it is still active.
+    // Treating every active pattern as avoidable keeps the answer safe.
+    const StateSet &set = states[state];
+    int last_certain = -1;
+    std::vector<bool> possible(patterns.size(), false);
+    for (size_t i = 0; i < positions.size(); ++i) {
+      if (!has_bit(set, i)) {
+        continue;
+      }
+      size_t p = positions[i].pattern;
+      possible[p] = true;
+      if (positions[i].type == PositionType::STICKY || universal[i]) {
+        last_certain = std::max(last_certain, static_cast<int>(p));
+      }
+    }
+
+    bool selected =
+        last_certain >= 0 ? !patterns[last_certain].negated : !has_positive;
+    for (size_t p = last_certain + 1; p < patterns.size(); ++p) {
+      if (possible[p] && !patterns[p].negated) {
+        selected = true;
+      }
+    }
+    subtree_verdicts[state] = selected;
+  }
+  return subtree_verdicts[state];
+}
+
+PatternSet::PatternSet(const std::vector<std::string> &patterns) {
+  if (patterns.empty()) {
+    return;
+  }
+
+  automaton_ = std::make_shared<PatternAutomaton>();
+  for (const auto &pattern : patterns) {
+    automaton_->compile(pattern);
+  }
+
+  // Positions followed only by stars match every non-empty deeper path
+  auto &positions = automaton_->positions;
+  automaton_->universal.assign(positions.size(), false);
+  for (const auto &pattern : automaton_->patterns) {
+    bool stars = true;
+    for (size_t i = pattern.accept; i-- > pattern.first;) {
+      stars = stars && (positions[i].type == PositionType::STAR ||
+                        positions[i].type == PositionType::GLOBSTAR ||
+                        positions[i].type == PositionType::SKIP);
+      automaton_->universal[i] = stars;
+    }
+  }
+
+  StateSet start((positions.size() + 63) / 64, 0);
+  for (const auto &pattern : automaton_->patterns) {
+    set_bit(start, pattern.first);
+  }
+  automaton_->close(start);
+  automaton_->intern(std::move(start));
+}
+
+PatternSet PatternSet::from_filters(const std::vector<std::string> &allow,
+                                    const std::vector<std::string> &ignore) {
+  std::vector<std::string> patterns = allow;
+  for (const auto &pattern : ignore) {
+    patterns.push_back("!" + pattern);
+  }
+  return PatternSet(patterns);
+}
+
+bool PatternSet::matches(std::string_view path) const {
+  if (!automaton_) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(automaton_->mutex);
+  return automaton_->verdict(automaton_->run(path));
+}
+
+bool PatternSet::may_match_under(std::string_view directory) const {
+  if (!automaton_) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(automaton_->mutex);
+  int32_t state = automaton_->run(directory);
+  if (!directory.empty() && directory.back() != '/') {
+    state = automaton_->step(state, '/');
+  }
+  return automaton_->subtree_verdict(state);
+}
+
+} // namespace huggingface_hub
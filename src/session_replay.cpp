@@ -0,0 +1,553 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+const char *CASSETTE_MAGIC = "HFHUB-CASSETTE 1";
+
+// Timing samples are taken at most this often while recording
+const uint64_t SAMPLE_INTERVAL_US = 5000;
+
+struct TimingSample {
+  uint64_t elapsed_us; // Time since the request started
+  uint64_t bytes;      // Cumulative body bytes delivered at that time
+};
+
+struct CassetteEntry {
+  std::string method;
+  std::string url;
+  std::string request_body;
+  curl_off_t resume_from = 0;
+  long curl_code = CURLE_OK;
+  long status = 0;
+  uint64_t body_size = 0; // Original body size, before truncation
+  std::vector<TimingSample> samples;
+  std::string headers;
+  std::string body;            // Recorded (possibly truncated) body
+  uint64_t body_length = 0;    // Length of the recorded body
+  std::streamoff body_pos = 0; // Offset of the body in the cassette file
+};
+
+std::mutex session_mutex;
+
+// Recording state
+std::ofstream record_stream;
+uint64_t record_max_body_bytes = 0;
+
+// Replay state
+bool replay_active = false;
+ReplayOptions replay_options;
+std::string replay_path;
+std::vector<std::shared_ptr<const CassetteEntry>> replay_entries;
+std::map<std::string, std::vector<size_t>> replay_index;
+std::map<std::string, size_t> replay_cursor;
+
+// Streamed request bodies are recorded as the digest of the bytes sent
+const char STREAMED_BODY[] = "streamed-sha256:";
+
+std::string entry_key(const std::string &method, const std::string &url,
+                      const std::string &request_body) {
+  return method + " " + url + "\n" + request_body;
+}
+
+uint64_t elapsed_us(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+void write_blob(std::ostream &out, const char *name, const std::string &blob) {
+  out << name << " " << blob.size() << "\n";
+  out.write(blob.data(), blob.size());
+  out << "\n";
+}
+
+bool read_blob(std::istream &in, const char *name, std::string &blob) {
+  std::string tag;
+  uint64_t length = 0;
+  if (!(in >> tag >> length) || tag != name) {
+    return false;
+  }
+  in.get(); // Newline after the length
+  blob.resize(length);
+  in.read(&blob[0], length);
+  in.get(); // Newline after the blob
+  return static_cast<bool>(in);
+}
+
+template <typename T>
+bool read_field(std::istream &in, const char *name, T &value) {
+  std::string tag;
+  return (in >> tag >> value) && tag == name;
+}
+
+bool read_entry(std::istream &in, bool preload, CassetteEntry &entry) {
+  size_t sample_count = 0;
+  if (!read_field(in, "method", entry.method) ||
+      !read_blob(in, "url", entry.url) ||
+      !read_blob(in, "request", entry.request_body) ||
+      !read_field(in, "resume", entry.resume_from) ||
+      !read_field(in, "curl_code", entry.curl_code) ||
+      !read_field(in, "status", entry.status) ||
+      !read_field(in, "body_size", entry.body_size) ||
+      !read_field(in, "samples", sample_count)) {
+    return false;
+  }
+
+  entry.samples.resize(sample_count);
+  for (auto &sample : entry.samples) {
+    if (!(in >> sample.elapsed_us >> sample.bytes)) {
+      return false;
+    }
+  }
+
+  if (!read_blob(in, "headers", entry.headers)) {
+    return false;
+  }
+
+  std::string tag;
+  if (!(in >> tag >> entry.body_length) || tag != "body") {
+    return false;
+  }
+  in.get();
+  entry.body_pos = in.tellg();
+  if (preload) {
+    entry.body.resize(entry.body_length);
+    in.read(&entry.body[0], entry.body_length);
+  } else {
+    in.seekg(entry.body_length, std::ios::cur);
+  }
+  in.get();
+
+  return (in >> tag) && tag == "end";
+}
+
+void write_entry(std::ostream &out, const CassetteEntry &entry) {
+  out << "entry\n";
+  out << "method " << entry.method << "\n";
+  write_blob(out, "url", entry.url);
+  write_blob(out, "request", entry.request_body);
+  out << "resume " << entry.resume_from << "\n";
+  out << "curl_code " << entry.curl_code << "\n";
+  out << "status " << entry.status << "\n";
+  out << "body_size " << entry.body_size << "\n";
+  out << "samples " << entry.samples.size() << "\n";
+  for (const auto &sample : entry.samples) {
+    out << sample.elapsed_us << " " << sample.bytes << "\n";
+  }
+  write_blob(out, "headers", entry.headers);
+  write_blob(out, "body", entry.body);
+  out << "end\n";
+}
+
+/* ---------------------------- Recording ---------------------------- */
+
+struct RecordingContext {
+  const HttpTransfer *transfer;
+  std::chrono::steady_clock::time_point start;
+  uint64_t max_body_bytes;
+  uint64_t last_sample_us = 0;
+  Sha256 request_hash; // Of the streamed request body
+  CassetteEntry entry;
+};
+
+size_t record_read(char *buffer, size_t size, size_t nitems, void *userdata) {
+  RecordingContext *ctx = static_cast<RecordingContext *>(userdata);
+  size_t count = ctx->transfer->read_function(buffer, size, nitems,
+                                              ctx->transfer->read_data);
+  if (count != CURL_READFUNC_ABORT && count != CURL_READFUNC_PAUSE) {
+    ctx->request_hash.update(buffer, count);
+  }
+  return count;
+}
+
+size_t record_write(void *ptr, size_t size, size_t nmemb, void *userdata) {
+  RecordingContext *ctx = static_cast<RecordingContext *>(userdata);
+  size_t written = ctx->transfer->write_function(ptr, size, nmemb,
+                                                 ctx->transfer->write_data);
+
+  CassetteEntry &entry = ctx->entry;
+  if (entry.body.size() < ctx->max_body_bytes) {
+    size_t keep = std::min<uint64_t>(written,
+                                     ctx->max_body_bytes - entry.body.size());
+    entry.body.append(static_cast<char *>(ptr), keep);
+  }
+  entry.body_size += written;
+
+  uint64_t now_us = elapsed_us(ctx->start);
+  if (entry.samples.empty() ||
+      now_us - ctx->last_sample_us >= SAMPLE_INTERVAL_US) {
+    entry.samples.push_back({now_us, entry.body_size});
+    ctx->last_sample_us = now_us;
+  } else {
+    entry.samples.back().bytes = entry.body_size;
+  }
+
+  return written;
+}
+
+size_t record_header(void *ptr, size_t size, size_t nmemb, void *userdata) {
+  RecordingContext *ctx = static_cast<RecordingContext *>(userdata);
+  ctx->entry.headers.append(static_cast<char *>(ptr), size * nmemb);
+  if (ctx->transfer->header_function) {
+    return ctx->transfer->header_function(ptr, size, nmemb,
+                                          ctx->transfer->header_data);
+  }
+  return size * nmemb;
+}
+
+/* ----------------------------- Replay ------------------------------ */
+
+std::shared_ptr<const CassetteEntry> next_replay_entry(const std::string &key) {
+  std::lock_guard<std::mutex> lock(session_mutex);
+  auto it = replay_index.find(key);
+  if (it == replay_index.end()) {
+    return nullptr;
+  }
+  // Identical requests are served in recording order, wrapping around so a
+  // benchmark loop can replay the same session several times
+  size_t &cursor = replay_cursor[key];
+  auto entry = replay_entries[it->second[cursor % it->second.size()]];
+  ++cursor;
+  return entry;
+}
+
+// Read a streamed request body through, as sending it would, for its digest
+std::string streamed_body_key(const HttpTransfer &transfer) {
+  Sha256 hash;
+  std::vector<char> buffer(CURL_MAX_READ_SIZE);
+  size_t count;
+  while ((count = transfer.read_function(buffer.data(), 1, buffer.size(),
+                                         transfer.read_data)) > 0 &&
+         count != CURL_READFUNC_ABORT && count != CURL_READFUNC_PAUSE) {
+    hash.update(buffer.data(), count);
+  }
+  return STREAMED_BODY + hash.hex_digest();
+}
+
+CURLcode replay_transfer(const HttpTransfer &transfer) {
+  auto entry = next_replay_entry(entry_key(
+      transfer.method, transfer.url,
+      transfer.read_function ? streamed_body_key(transfer)
+                             : transfer.request_body));
+  if (!entry) {
+    log_error("No recorded exchange for " + transfer.method + " " +
+              transfer.url);
+    return CURLE_COULDNT_CONNECT;
+  }
+  if (transfer.status) {
+    *transfer.status = entry->status;
+  }
+
+  ReplayOptions options;
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(session_mutex);
+    options = replay_options;
+    path = replay_path;
+  }
+
+  // A preloaded body is replayed in place, the others are read once
+  std::string loaded;
+  if (!options.preload && entry->body_length > 0) {
+    std::ifstream in(path, std::ios::binary);
+    loaded.resize(entry->body_length);
+    in.seekg(entry->body_pos);
+    in.read(&loaded[0], entry->body_length);
+    if (!in) {
+      log_error("Failed to read recorded body from " + path);
+      return CURLE_READ_ERROR;
+    }
+  }
+  const std::string &body = options.preload ? entry->body : loaded;
+
+  auto start = std::chrono::steady_clock::now();
+  auto wait_until = [&](uint64_t recorded_us) {
+    if (options.time_scale <= 0) {
+      return;
+    }
+    std::this_thread::sleep_until(
+        start + std::chrono::microseconds(static_cast<uint64_t>(
+                    recorded_us * options.time_scale)));
+  };
+
+  if (transfer.header_function) {
+    size_t line_start = 0;
+    while (line_start < entry->headers.size()) {
+      size_t line_end = entry->headers.find('\n', line_start);
+      line_end = line_end == std::string::npos ? entry->headers.size()
+                                               : line_end + 1;
+      std::string line =
+          entry->headers.substr(line_start, line_end - line_start);
+      if (transfer.header_function(&line[0], 1, line.size(),
+                                   transfer.header_data) != line.size()) {
+        return CURLE_WRITE_ERROR;
+      }
+      line_start = line_end;
+    }
+  }
+
+  // A resumed request only receives the part past the local file
+  uint64_t skip = 0;
+  if (transfer.resume_from > entry->resume_from) {
+    skip = std::min<uint64_t>(transfer.resume_from - entry->resume_from,
+                              entry->body_size);
+  }
+  uint64_t remaining = entry->body_size - skip;
+
+  uint64_t position = 0; // Position in the original body
+  uint64_t delivered = 0;
+  std::vector<char> chunk(CURL_MAX_WRITE_SIZE);
+  for (const auto &sample : entry->samples) {
+    wait_until(sample.elapsed_us);
+    while (position < sample.bytes) {
+      size_t length =
+          std::min<uint64_t>(chunk.size(), sample.bytes - position);
+      if (position + length <= skip) {
+        position += length;
+        continue;
+      }
+      size_t offset = position < skip ? skip - position : 0;
+      // Bytes past the truncated recording are replayed as zeros
+      for (size_t i = offset; i < length; ++i) {
+        chunk[i - offset] =
+            position + i < body.size() ? body[position + i] : '\0';
+      }
+      size_t count = length - offset;
+      if (transfer.write_function(chunk.data(), 1, count,
+                                  transfer.write_data) != count) {
+        return CURLE_WRITE_ERROR;
+      }
+      position += length;
+      delivered += count;
+    }
+
+    if (transfer.progress_function &&
+        transfer.progress_function(transfer.progress_data, remaining,
+                                   delivered, 0, 0) != 0) {
+      return CURLE_ABORTED_BY_CALLBACK;
+    }
+  }
+
+  return static_cast<CURLcode>(entry->curl_code);
+}
+
+} // namespace
+
+bool start_session_recording(const std::string &cassette_path,
+                             uint64_t max_body_bytes) {
+  std::lock_guard<std::mutex> lock(session_mutex);
+  if (record_stream.is_open()) {
+    record_stream.close();
+  }
+  record_stream.open(cassette_path, std::ios::binary | std::ios::trunc);
+  if (!record_stream.is_open()) {
+    log_error("Failed to open cassette " + cassette_path);
+    return false;
+  }
+  record_stream << CASSETTE_MAGIC << "\n";
+  record_max_body_bytes = max_body_bytes;
+  return true;
+}
+
+void stop_session_recording() {
+  std::lock_guard<std::mutex> lock(session_mutex);
+  if (record_stream.is_open()) {
+    record_stream.close();
+  }
+}
+
+bool start_session_replay(const std::string &cassette_path,
+                          const ReplayOptions &options) {
+  std::ifstream in(cassette_path, std::ios::binary);
+  std::string magic;
+  if (!in.is_open() || !std::getline(in, magic) || magic != CASSETTE_MAGIC) {
+    log_error("Invalid cassette " + cassette_path);
+    return false;
+  }
+
+  std::vector<std::shared_ptr<const CassetteEntry>> entries;
+  std::map<std::string, std::vector<size_t>> index;
+  std::string tag;
+  while (in >> tag) {
+    auto entry = std::make_shared<CassetteEntry>();
+    if (tag != "entry" || !read_entry(in, options.preload, *entry)) {
+      log_error("Corrupted cassette " + cassette_path);
+      return false;
+    }
+    index[entry_key(entry->method, entry->url, entry->request_body)]
+        .push_back(entries.size());
+    entries.push_back(entry);
+  }
+
+  std::lock_guard<std::mutex> lock(session_mutex);
+  replay_entries = std::move(entries);
+  replay_index = std::move(index);
+  replay_cursor.clear();
+  replay_options = options;
+  replay_path = cassette_path;
+  replay_active = true;
+  log_debug("Replaying " + std::to_string(replay_entries.size()) +
+            " exchanges from " + cassette_path);
+  return true;
+}
+
+void stop_session_replay() {
+  std::lock_guard<std::mutex> lock(session_mutex);
+  replay_active = false;
+  replay_entries.clear();
+  replay_index.clear();
+  replay_cursor.clear();
+}
+
+size_t read_memory_data(char *buffer, size_t size, size_t nitems,
+                        void *userdata) {
+  MemoryReader *reader = static_cast<MemoryReader *>(userdata);
+  size_t length = std::min(size * nitems, reader->size - reader->position);
+  memcpy(buffer, reader->data + reader->position, length);
+  reader->position += length;
+  return length;
+}
+
+bool session_is_live() {
+  std::lock_guard<std::mutex> lock(session_mutex);
+  return !replay_active && !record_stream.is_open();
+}
+
+CURLcode http_perform(CURL *curl, const HttpTransfer &transfer) {
+  bool replaying, recording;
+  uint64_t max_body_bytes;
+  {
+    std::lock_guard<std::mutex> lock(session_mutex);
+    replaying = replay_active;
+    recording = record_stream.is_open();
+    max_body_bytes = record_max_body_bytes;
+  }
+
+  if (replaying) {
+    return replay_transfer(transfer);
+  }
+
+  RecordingContext ctx;
+  ctx.transfer = &transfer;
+  curl_easy_setopt(curl, CURLOPT_URL, transfer.url.c_str());
+  if (transfer.read_function) {
+    if (recording) {
+      curl_easy_setopt(curl, CURLOPT_READFUNCTION, record_read);
+      curl_easy_setopt(curl, CURLOPT_READDATA, &ctx);
+    } else {
+      curl_easy_setopt(curl, CURLOPT_READFUNCTION, transfer.read_function);
+      curl_easy_setopt(curl, CURLOPT_READDATA, transfer.read_data);
+    }
+    if (transfer.method == "PUT") {
+      curl_easy_setopt(curl, CURLOPT_UPLOAD, 1L);
+      curl_easy_setopt(curl, CURLOPT_INFILESIZE_LARGE, transfer.upload_size);
+    } else {
+      curl_easy_setopt(curl, CURLOPT_POST, 1L);
+      curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                       transfer.upload_size);
+    }
+  } else if (transfer.method == "POST") {
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE_LARGE,
+                     (curl_off_t)transfer.request_body.size());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, transfer.request_body.c_str());
+  } else if (transfer.method != "GET") {
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, transfer.method.c_str());
+  }
+  if (transfer.method == "GET") {
+    allow_early_data(curl);
+  }
+  if (transfer.resume_from > 0) {
+    curl_easy_setopt(curl, CURLOPT_RESUME_FROM_LARGE, transfer.resume_from);
+  }
+  if (transfer.progress_function) {
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION,
+                     transfer.progress_function);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, transfer.progress_data);
+  }
+
+  if (!recording) {
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, transfer.write_function);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer.write_data);
+    if (transfer.header_function) {
+      curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, transfer.header_function);
+      curl_easy_setopt(curl, CURLOPT_HEADERDATA, transfer.header_data);
+    }
+    CURLcode res = curl_easy_perform(curl);
+    note_connection_reuse(curl, transfer.url);
+    if (transfer.status) {
+      curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, transfer.status);
+    }
+    return res;
+  }
+
+  ctx.start = std::chrono::steady_clock::now();
+  ctx.max_body_bytes = max_body_bytes;
+  ctx.entry.method = transfer.method;
+  ctx.entry.url = transfer.url;
+  ctx.entry.request_body = transfer.request_body;
+  ctx.entry.resume_from = transfer.resume_from;
+
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, record_write);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &ctx);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, record_header);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &ctx);
+
+  CURLcode res = curl_easy_perform(curl);
+  note_connection_reuse(curl, transfer.url);
+
+  ctx.entry.curl_code = res;
+  if (transfer.read_function) {
+    ctx.entry.request_body = STREAMED_BODY + ctx.request_hash.hex_digest();
+  }
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &ctx.entry.status);
+  if (transfer.status) {
+    *transfer.status = ctx.entry.status;
+  }
+  ctx.entry.samples.push_back({elapsed_us(ctx.start), ctx.entry.body_size});
+
+  std::lock_guard<std::mutex> lock(session_mutex);
+  if (record_stream.is_open()) {
+    write_entry(record_stream, ctx.entry);
+    record_stream.flush();
+  }
+  return res;
+}
+
+} // namespace huggingface_hub
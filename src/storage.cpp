@@ -0,0 +1,281 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <atomic>
+#include <fstream>
+#include <mutex>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+std::mutex storage_mutex;
+std::shared_ptr<StorageBackend> shared_storage;
+SharedStorageStats storage_stats;
+
+// Distinguishes temporary names of blobs put by threads of this process
+std::atomic<uint64_t> put_counter(0);
+
+// A cache folder in the layout of the download cache
+class PosixStorage : public StorageBackend {
+public:
+  explicit PosixStorage(const std::string &cache_dir)
+      : cache_dir_(cache_dir) {}
+
+  bool put_blob(const std::string &repo_id, const std::string &blob,
+                const std::string &local_path) override {
+    std::shared_ptr<RepoCache> cache = open_repo_cache(cache_dir_, repo_id);
+    if (stat_at(cache->blobs->fd, blob)) {
+      return true;
+    }
+    std::string temporary_name = blob + ".incomplete-" +
+                                 std::to_string(getpid()) + "-" +
+                                 std::to_string(put_counter++);
+    std::string temporary_path = cache->path + "blobs/" + temporary_name;
+    std::error_code error;
+    std::filesystem::copy_file(
+        local_path, temporary_path,
+        std::filesystem::copy_options::overwrite_existing, error);
+    DurabilityMode durability = get_durability_config().mode;
+    if (!error && durability != DurabilityMode::NONE) {
+      sync_file(temporary_path);
+    }
+    if (error || renameat(cache->blobs->fd, temporary_name.c_str(),
+                          cache->blobs->fd, blob.c_str()) != 0) {
+      log_error("Failed to store " + cache->path + "blobs/" + blob);
+      std::filesystem::remove(temporary_path, error);
+      return false;
+    }
+    if (durability == DurabilityMode::FULL) {
+      sync_directory(cache->path + "blobs");
+    }
+    return true;
+  }
+
+  bool get_blob(const std::string &repo_id, const std::string &blob,
+                const std::string &local_path) override {
+    std::error_code error;
+    std::filesystem::copy_file(
+        blob_path(repo_id, blob), local_path,
+        std::filesystem::copy_options::overwrite_existing, error);
+    return !error;
+  }
+
+  bool read_blob_range(const std::string &repo_id, const std::string &blob,
+                       uint64_t offset, uint64_t length,
+                       std::string &data) override {
+    int fd = open(blob_path(repo_id, blob).c_str(), O_RDONLY);
+    if (fd < 0) {
+      return false;
+    }
+    data.resize(length);
+    uint64_t done = 0;
+    ssize_t count;
+    while (done < length &&
+           (count = pread(fd, &data[done], length - done, offset + done)) >
+               0) {
+      done += count;
+    }
+    close(fd);
+    data.resize(done);
+    return done == length;
+  }
+
+  bool stat_blob(const std::string &repo_id, const std::string &blob,
+                 uint64_t *size) override {
+    return stat_at(open_repo_cache(cache_dir_, repo_id)->blobs->fd, blob,
+                   size);
+  }
+
+  std::string read_ref(const std::string &repo_id,
+                       const std::string &ref) override {
+    std::string commit;
+    std::ifstream file(open_repo_cache(cache_dir_, repo_id)->path + "refs/" +
+                       ref);
+    std::getline(file, commit);
+    return commit;
+  }
+
+  bool write_ref(const std::string &repo_id, const std::string &ref,
+                 const std::string &commit) override {
+    return write_file_atomically(
+        open_repo_cache(cache_dir_, repo_id)->path + "refs/" + ref, commit);
+  }
+
+  // The manifest is the tree of links of the snapshot
+  bool read_manifest(const std::string &repo_id, const std::string &commit,
+                     SnapshotManifest &manifest) override {
+    std::filesystem::path snapshot_path =
+        open_repo_cache(cache_dir_, repo_id)->path + "snapshots/" + commit;
+    std::error_code error;
+    std::filesystem::recursive_directory_iterator it(snapshot_path, error);
+    if (error) {
+      return false;
+    }
+    manifest.clear();
+    for (; it != std::filesystem::recursive_directory_iterator();
+         it.increment(error)) {
+      if (it->is_symlink(error)) {
+        manifest[it->path().lexically_relative(snapshot_path).string()] =
+            std::filesystem::read_symlink(it->path(), error)
+                .filename()
+                .string();
+      }
+    }
+    return !error;
+  }
+
+  // Links are only ever added, so writing the new files merges them
+  bool merge_manifest(const std::string &repo_id, const std::string &commit,
+                      const SnapshotManifest &files) override {
+    return write_manifest(repo_id, commit, files);
+  }
+
+  bool write_manifest(const std::string &repo_id, const std::string &commit,
+                      const SnapshotManifest &manifest) override {
+    std::shared_ptr<RepoCache> cache = open_repo_cache(cache_dir_, repo_id);
+    for (const auto &file : manifest) {
+      if (!link_snapshot_file(*cache, cache->path + "blobs/" + file.second,
+                              commit + "/" + file.first)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+private:
+  std::string blob_path(const std::string &repo_id, const std::string &blob) {
+    return open_repo_cache(cache_dir_, repo_id)->path + "blobs/" + blob;
+  }
+
+  std::string cache_dir_;
+};
+
+void count_storage_failure(const std::string &what) {
+  log_error("Shared storage: " + what + " failed");
+  std::lock_guard<std::mutex> lock(storage_mutex);
+  ++storage_stats.failures;
+}
+
+} // namespace
+
+bool StorageBackend::merge_manifest(const std::string &repo_id,
+                                    const std::string &commit,
+                                    const SnapshotManifest &files) {
+  SnapshotManifest merged;
+  read_manifest(repo_id, commit, merged);
+  for (const auto &file : files) {
+    merged[file.first] = file.second;
+  }
+  return write_manifest(repo_id, commit, merged);
+}
+
+std::shared_ptr<StorageBackend>
+create_posix_storage(const std::string &cache_dir) {
+  return std::make_shared<PosixStorage>(cache_dir);
+}
+
+void set_shared_storage(std::shared_ptr<StorageBackend> storage) {
+  std::lock_guard<std::mutex> lock(storage_mutex);
+  shared_storage = storage;
+}
+
+std::shared_ptr<StorageBackend> get_shared_storage() {
+  std::lock_guard<std::mutex> lock(storage_mutex);
+  return shared_storage;
+}
+
+SharedStorageStats get_shared_storage_stats() {
+  std::lock_guard<std::mutex> lock(storage_mutex);
+  return storage_stats;
+}
+
+bool fetch_shared_blob(const std::string &repo_id,
+                       const FileMetadata &metadata,
+                       const std::string &local_path) {
+  std::shared_ptr<StorageBackend> storage = get_shared_storage();
+  std::string blob = metadata.sha256.empty() ? metadata.oid : metadata.sha256;
+  uint64_t size = 0;
+  if (!storage || !storage->stat_blob(repo_id, blob, &size) ||
+      size != metadata.size) {
+    return false;
+  }
+
+  // A damaged shared copy must not spread to every node
+  std::error_code error;
+  if (!storage->get_blob(repo_id, blob, local_path) ||
+      (!metadata.sha256.empty() &&
+       sha256_file(local_path) != metadata.sha256)) {
+    std::filesystem::remove(local_path, error);
+    count_storage_failure("fetching blob " + blob + " of " + repo_id);
+    return false;
+  }
+
+  log_debug("Fetched blob " + blob + " from the shared storage");
+  std::lock_guard<std::mutex> lock(storage_mutex);
+  ++storage_stats.blobs_fetched;
+  storage_stats.bytes_fetched += size;
+  return true;
+}
+
+void publish_shared_blob(const std::string &repo_id, const std::string &blob,
+                         const std::string &local_path) {
+  std::shared_ptr<StorageBackend> storage = get_shared_storage();
+  if (!storage || storage->stat_blob(repo_id, blob)) {
+    return;
+  }
+  if (!storage->put_blob(repo_id, blob, local_path)) {
+    count_storage_failure("storing blob " + blob + " of " + repo_id);
+    return;
+  }
+
+  std::error_code error;
+  uint64_t size = std::filesystem::file_size(local_path, error);
+  std::lock_guard<std::mutex> lock(storage_mutex);
+  ++storage_stats.blobs_published;
+  storage_stats.bytes_published += error ? 0 : size;
+}
+
+void publish_shared_snapshot(
+    const std::string &repo_id, const std::string &ref,
+    const std::string &commit,
+    const std::map<std::string, std::string> &manifest) {
+  std::shared_ptr<StorageBackend> storage = get_shared_storage();
+  if (!storage) {
+    return;
+  }
+  // Filtered downloads of the same commit add up to one manifest. Readers
+  // following the ref must find a complete manifest.
+  if (!storage->merge_manifest(repo_id, commit, manifest) ||
+      !storage->write_ref(repo_id, ref, commit)) {
+    count_storage_failure("storing snapshot " + commit + " of " + repo_id);
+  }
+}
+
+} // namespace huggingface_hub
@@ -0,0 +1,779 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+// Peers that stop announcing themselves are dropped by the tracker
+const auto PEER_LIFETIME = std::chrono::seconds(60);
+// How often a download asks the peers which chunks they hold
+const auto REFRESH_INTERVAL = std::chrono::milliseconds(250);
+// How long to wait for a chunk a peer is fetching from the origin
+const auto PENDING_TIMEOUT = std::chrono::seconds(10);
+const int MAX_ATTEMPTS = 3;
+const size_t MAX_REQUEST_SIZE = 8192;
+// Complete blobs kept open for peers; the oldest are dropped beyond this
+const size_t MAX_SERVED_BLOBS = 64;
+// Listed in place of the hash of a chunk being fetched from the origin
+const char PENDING[] = "-";
+
+// A blob whose chunks this node serves
+struct SwarmBlob {
+  int fd = -1; // Kept open, the file is renamed once complete
+  uint64_t size = 0;
+  uint64_t chunk_size = 0;
+  std::vector<std::string> hashes; // Hex SHA-256 of held chunks, or empty
+  std::vector<bool> pending;       // Chunks being fetched from the origin
+  bool complete = false;           // Verified and renamed into the cache
+
+  ~SwarmBlob() {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+};
+
+std::mutex swarm_mutex;
+SwarmConfig swarm_config;
+SwarmStats swarm_stats;
+std::map<std::string, std::shared_ptr<SwarmBlob>> swarm_blobs;
+std::deque<std::string> served_blobs; // Complete blobs, oldest first
+std::map<std::string, std::chrono::steady_clock::time_point> announced_peers;
+
+int chunk_listener = -1;
+// Never destroyed, so a server still running at exit does not terminate
+// the process
+std::thread *chunk_server = nullptr;
+
+// False once the blob was deleted from the cache, e.g. by a cleanup
+bool still_in_cache(const SwarmBlob &blob) {
+  struct stat stat_buf;
+  return fstat(blob.fd, &stat_buf) == 0 && stat_buf.st_nlink > 0;
+}
+
+// Stop serving blobs deleted from the cache and the oldest ones beyond
+// MAX_SERVED_BLOBS, closing their files. Called with swarm_mutex held.
+void prune_served_blobs() {
+  for (auto it = served_blobs.begin(); it != served_blobs.end();) {
+    auto blob = swarm_blobs.find(*it);
+    if (blob == swarm_blobs.end() || !blob->second->complete) {
+      it = served_blobs.erase(it); // Dropped, or downloaded again
+    } else if (!still_in_cache(*blob->second)) {
+      swarm_blobs.erase(blob);
+      it = served_blobs.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  while (served_blobs.size() > MAX_SERVED_BLOBS) {
+    swarm_blobs.erase(served_blobs.front());
+    served_blobs.pop_front();
+  }
+}
+
+bool send_all(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+    if (sent <= 0) {
+      return false;
+    }
+    data += sent;
+    size -= sent;
+  }
+  return true;
+}
+
+void respond(int fd, int status, const std::string &body) {
+  std::string response = "HTTP/1.1 " + std::to_string(status) +
+                         (status == 200 ? " OK" : " Not Found") +
+                         "\r\nContent-Length: " + std::to_string(body.size()) +
+                         "\r\nConnection: close\r\n\r\n" + body;
+  send_all(fd, response.data(), response.size());
+}
+
+// Register the announcing node and list the others
+std::string list_peers(const std::string &announce) {
+  auto now = std::chrono::steady_clock::now();
+  std::lock_guard<std::mutex> lock(swarm_mutex);
+  if (!announce.empty()) {
+    announced_peers[announce] = now;
+  }
+  std::string peers;
+  for (auto it = announced_peers.begin(); it != announced_peers.end();) {
+    if (now - it->second > PEER_LIFETIME) {
+      it = announced_peers.erase(it);
+      continue;
+    }
+    if (it->first != announce) {
+      peers += it->first + "\n";
+    }
+    ++it;
+  }
+  return peers;
+}
+
+// Routes: /swarm/peers?announce=<host:port>, /swarm/<sha256>/have and
+// /swarm/<sha256>/chunk/<index>
+void handle_connection(int fd) {
+  struct timeval timeout = {10, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  std::string request;
+  char buffer[1024];
+  ssize_t count;
+  while (request.find("\r\n\r\n") == std::string::npos &&
+         request.size() < MAX_REQUEST_SIZE &&
+         (count = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+    request.append(buffer, count);
+  }
+
+  std::istringstream line(request);
+  std::string method, path;
+  line >> method >> path;
+  const std::string announce = "/swarm/peers?announce=";
+  if (method != "GET") {
+    respond(fd, 404, "");
+  } else if (path.rfind(announce, 0) == 0 || path == "/swarm/peers") {
+    respond(fd, 200,
+            list_peers(path.size() > announce.size()
+                           ? path.substr(announce.size())
+                           : ""));
+  } else if (path.rfind("/swarm/", 0) == 0) {
+    std::string rest = path.substr(7);
+    size_t slash = rest.find('/');
+    std::string sha256 = rest.substr(0, slash);
+    std::string what = slash == std::string::npos ? "" : rest.substr(slash);
+
+    std::shared_ptr<SwarmBlob> blob;
+    std::string have;
+    int64_t chunk = -1;
+    uint64_t offset = 0, length = 0;
+    {
+      std::lock_guard<std::mutex> lock(swarm_mutex);
+      auto it = swarm_blobs.find(sha256);
+      if (it != swarm_blobs.end() && it->second->complete &&
+          !still_in_cache(*it->second)) {
+        prune_served_blobs();
+        it = swarm_blobs.end();
+      }
+      if (it != swarm_blobs.end()) {
+        blob = it->second;
+        have = std::to_string(blob->chunk_size) + " " +
+               std::to_string(blob->size) + " " +
+               (blob->complete ? "1" : "0") + "\n";
+        for (size_t i = 0; i < blob->hashes.size(); ++i) {
+          if (!blob->hashes[i].empty() || blob->pending[i]) {
+            have += std::to_string(i) + " " +
+                    (blob->pending[i] ? PENDING : blob->hashes[i]) + "\n";
+          }
+        }
+        if (what.rfind("/chunk/", 0) == 0) {
+          chunk = std::strtoll(what.c_str() + 7, nullptr, 10);
+          if (chunk >= 0 && static_cast<size_t>(chunk) < blob->hashes.size() &&
+              !blob->hashes[chunk].empty()) {
+            offset = chunk * blob->chunk_size;
+            length = std::min(blob->chunk_size, blob->size - offset);
+          }
+        }
+      }
+    }
+
+    std::string body(length, '\0');
+    if (blob && what == "/have") {
+      respond(fd, 200, have);
+    } else if (length > 0 &&
+               pread(blob->fd, &body[0], length, offset) ==
+                   static_cast<ssize_t>(length)) {
+      respond(fd, 200, body);
+      std::lock_guard<std::mutex> lock(swarm_mutex);
+      ++swarm_stats.chunks_served;
+      swarm_stats.bytes_served += length;
+    } else {
+      respond(fd, 404, "");
+    }
+  } else {
+    respond(fd, 404, "");
+  }
+  close(fd);
+}
+
+int open_listener(int port) {
+  int fd = socket(AF_INET6, SOCK_STREAM, 0);
+  int on = 1, off = 0;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+  struct sockaddr_in6 address;
+  memset(&address, 0, sizeof(address));
+  address.sin6_family = AF_INET6;
+  address.sin6_addr = in6addr_any;
+  address.sin6_port = htons(port);
+  if (fd < 0 ||
+      bind(fd, reinterpret_cast<struct sockaddr *>(&address),
+           sizeof(address)) != 0 ||
+      listen(fd, 128) != 0) {
+    log_error("Swarm: cannot listen on port " + std::to_string(port) + ": " +
+              strerror(errno));
+    if (fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+  return fd;
+}
+
+// Accept connections until the listener is shut down
+void serve(int listener) {
+  int fd;
+  while ((fd = accept(listener, nullptr, nullptr)) >= 0 || errno == EINTR) {
+    if (fd >= 0) {
+      std::thread(handle_connection, fd).detach();
+    }
+  }
+}
+
+void stop_chunk_server() {
+  if (chunk_listener >= 0) {
+    shutdown(chunk_listener, SHUT_RDWR);
+    chunk_server->join();
+    delete chunk_server;
+    chunk_server = nullptr;
+    close(chunk_listener);
+    chunk_listener = -1;
+  }
+}
+
+CURLcode http_get(const std::string &url, const std::string &range,
+                  std::string &body) {
+  CURL *curl = create_curl_handle(false);
+  if (!curl) {
+    return CURLE_FAILED_INIT;
+  }
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+  if (!range.empty()) {
+    curl_easy_setopt(curl, CURLOPT_RANGE, range.c_str());
+  }
+  HttpTransfer transfer;
+  transfer.url = url;
+  transfer.write_function = write_string_data;
+  transfer.write_data = &body;
+  CURLcode res = http_perform(curl, transfer);
+  curl_easy_cleanup(curl);
+  return res;
+}
+
+std::string hash_of(const std::string &data) {
+  Sha256 hash;
+  hash.update(data.data(), data.size());
+  return hash.hex_digest();
+}
+
+// The chunks a peer holds, with their hashes, or PENDING
+typedef std::map<uint64_t, std::string> PeerChunks;
+
+enum ChunkState { CHUNK_NEEDED, CHUNK_ACTIVE, CHUNK_DONE };
+
+enum PickResult { PICKED, WAIT, FINISHED };
+
+// Chunk bookkeeping of one swarm download
+struct SwarmDownload {
+  std::string url;
+  std::string sha256;
+  std::string self;
+  std::shared_ptr<SwarmBlob> blob;
+  std::vector<std::string> peers; // Static peers
+
+  std::mutex mutex;
+  std::vector<ChunkState> chunks;
+  std::map<std::string, PeerChunks> holders;
+  // Hashes a chunk from a peer must match, see trusted_hashes()
+  std::map<uint64_t, std::string> trusted;
+  // Chunks a peer sent with the wrong content are not asked of it again
+  std::set<std::pair<std::string, uint64_t>> rejected;
+  // When each chunk was first seen pending at a peer
+  std::map<uint64_t, std::chrono::steady_clock::time_point> waiting;
+  std::chrono::steady_clock::time_point refreshed;
+  bool refreshing = false;
+  bool failed = false;
+  uint64_t done_bytes = 0;
+  size_t start = 0; // Origin fetches start here, nodes spread their origin
+                    // requests over the blob
+};
+
+// A peer only vouches for the chunks it holds, so its hashes are not
+// trusted on their own: a chunk hash is trusted when the peers holding the
+// verified blob all list it, or, while none does, when at least
+// min_agreeing peers list it and no other hash is listed as often
+std::map<uint64_t, std::string>
+trusted_hashes(const std::map<std::string, PeerChunks> &holders,
+               const std::set<std::string> &complete, int min_agreeing) {
+  std::map<uint64_t, std::map<std::string, int>> votes, verified;
+  for (const auto &holder : holders) {
+    for (const auto &chunk : holder.second) {
+      if (chunk.second == PENDING) {
+        continue;
+      }
+      ++votes[chunk.first][chunk.second];
+      if (complete.count(holder.first)) {
+        ++verified[chunk.first][chunk.second];
+      }
+    }
+  }
+
+  std::map<uint64_t, std::string> trusted;
+  for (const auto &chunk : votes) {
+    auto vouched = verified.find(chunk.first);
+    if (vouched != verified.end()) {
+      // Verified nodes that disagree leave the chunk to the origin
+      if (vouched->second.size() == 1) {
+        trusted[chunk.first] = vouched->second.begin()->first;
+      }
+      continue;
+    }
+    int best = 0;
+    bool tie = false;
+    std::string hash;
+    for (const auto &vote : chunk.second) {
+      if (vote.second > best) {
+        best = vote.second;
+        hash = vote.first;
+        tie = false;
+      } else if (vote.second == best) {
+        tie = true;
+      }
+    }
+    if (best >= std::max(1, min_agreeing) && !tie) {
+      trusted[chunk.first] = hash;
+    }
+  }
+  return trusted;
+}
+
+// Ask the peers which chunks they hold
+void refresh_holders(SwarmDownload &download, const SwarmConfig &config) {
+  std::vector<std::string> peers = download.peers;
+  if (!config.tracker.empty()) {
+    std::string listing;
+    std::string announce = config.listen_port > 0 ? download.self : "";
+    if (http_get("http://" + config.tracker + "/swarm/peers?announce=" +
+                     announce,
+                 "", listing) == CURLE_OK) {
+      std::istringstream lines(listing);
+      std::string peer;
+      while (std::getline(lines, peer)) {
+        if (!peer.empty() &&
+            std::find(peers.begin(), peers.end(), peer) == peers.end()) {
+          peers.push_back(peer);
+        }
+      }
+    }
+  }
+
+  std::map<std::string, PeerChunks> holders;
+  std::set<std::string> complete;
+  for (const auto &peer : peers) {
+    std::string have;
+    if (peer == download.self ||
+        http_get("http://" + peer + "/swarm/" + download.sha256 + "/have", "",
+                 have) != CURLE_OK) {
+      continue;
+    }
+    std::istringstream lines(have);
+    uint64_t chunk_size = 0, size = 0;
+    int verified = 0;
+    lines >> chunk_size >> size >> verified;
+    if (chunk_size != download.blob->chunk_size ||
+        size != download.blob->size) {
+      continue; // Chunks of another size cannot be checked
+    }
+    if (verified) {
+      complete.insert(peer);
+    }
+    uint64_t index;
+    std::string hash;
+    while (lines >> index >> hash) {
+      holders[peer][index] = hash;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(download.mutex);
+  for (const auto &bad : download.rejected) {
+    auto it = holders.find(bad.first);
+    if (it != holders.end()) {
+      it->second.erase(bad.second);
+    }
+  }
+  download.trusted =
+      trusted_hashes(holders, complete, config.min_agreeing_peers);
+  download.holders = holders;
+  download.refreshed = std::chrono::steady_clock::now();
+  download.refreshing = false;
+}
+
+// Pick the next chunk: one a peer holds under its trusted hash, else one
+// no peer is fetching from the origin. Chunks peers are fetching are waited
+// for, for a while, if enough peers will hold them to trust their hash.
+PickResult pick_chunk(SwarmDownload &download, int min_agreeing,
+                      uint64_t &index, std::string &peer, std::string &hash) {
+  std::lock_guard<std::mutex> lock(download.mutex);
+  auto now = std::chrono::steady_clock::now();
+  size_t count = download.chunks.size();
+  int64_t origin = -1;
+  bool wait = false;
+  for (size_t k = 0; k < count && !download.failed; ++k) {
+    size_t i = (download.start + k) % count;
+    if (download.chunks[i] != CHUNK_NEEDED) {
+      continue;
+    }
+    // Holders are tried in turn, so chunks spread over the peers
+    std::vector<std::pair<std::string, std::string>> candidates;
+    auto trusted = download.trusted.find(i);
+    int holders = 0, fetching = 0;
+    for (const auto &holder : download.holders) {
+      auto it = holder.second.find(i);
+      if (it == holder.second.end()) {
+        continue;
+      } else if (it->second == PENDING) {
+        ++fetching;
+      } else if (trusted != download.trusted.end() &&
+                 it->second == trusted->second) {
+        candidates.emplace_back(holder.first, it->second);
+      } else {
+        ++holders;
+      }
+    }
+    bool pending = fetching > 0 && holders + fetching >= min_agreeing;
+    if (!candidates.empty()) {
+      index = i;
+      peer = candidates[i % candidates.size()].first;
+      hash = candidates[i % candidates.size()].second;
+      download.chunks[i] = CHUNK_ACTIVE;
+      return PICKED;
+    }
+    if (pending) {
+      auto first_seen = download.waiting.emplace(i, now).first->second;
+      pending = now - first_seen < PENDING_TIMEOUT;
+    }
+    wait |= pending;
+    if (origin < 0 && !pending) {
+      origin = i;
+    }
+  }
+  if (origin < 0) {
+    return wait && !download.failed ? WAIT : FINISHED;
+  }
+  index = origin;
+  peer.clear();
+  download.chunks[origin] = CHUNK_ACTIVE;
+  return PICKED;
+}
+
+void fetch_chunks(SwarmDownload &download, const SwarmConfig &config,
+                  TrackedTransfer &transfer) {
+  SwarmBlob &blob = *download.blob;
+  uint64_t index;
+  std::string peer, expected;
+  while (true) {
+    bool refresh;
+    {
+      std::lock_guard<std::mutex> lock(download.mutex);
+      refresh = !download.refreshing &&
+                std::chrono::steady_clock::now() - download.refreshed >
+                    REFRESH_INTERVAL;
+      download.refreshing |= refresh;
+    }
+    if (refresh) {
+      refresh_holders(download, config);
+    }
+    PickResult pick = pick_chunk(download, config.min_agreeing_peers, index,
+                                 peer, expected);
+    if (pick == FINISHED) {
+      return;
+    } else if (pick == WAIT) {
+      std::this_thread::sleep_for(REFRESH_INTERVAL);
+      continue;
+    }
+
+    uint64_t offset = index * blob.chunk_size;
+    uint64_t length = std::min(blob.chunk_size, blob.size - offset);
+    std::string data, hash;
+    bool fetched = false;
+    if (!peer.empty()) {
+      fetched = http_get("http://" + peer + "/swarm/" + download.sha256 +
+                             "/chunk/" + std::to_string(index),
+                         "", data) == CURLE_OK &&
+                data.size() == length && (hash = hash_of(data)) == expected;
+    } else {
+      {
+        std::lock_guard<std::mutex> lock(swarm_mutex);
+        blob.pending[index] = true;
+      }
+      std::string range = std::to_string(offset) + "-" +
+                          std::to_string(offset + length - 1);
+      for (int attempt = 0; attempt < MAX_ATTEMPTS && !fetched; ++attempt) {
+        data.clear();
+        fetched = http_get(download.url, range, data) == CURLE_OK &&
+                  data.size() == length;
+      }
+      hash = fetched ? hash_of(data) : "";
+    }
+    fetched = fetched && pwrite(blob.fd, data.data(), length, offset) ==
+                             static_cast<ssize_t>(length);
+
+    {
+      std::lock_guard<std::mutex> lock(swarm_mutex);
+      blob.pending[index] = false;
+    }
+    if (fetched) {
+      std::lock_guard<std::mutex> lock(swarm_mutex);
+      blob.hashes[index] = hash;
+      ++(peer.empty() ? swarm_stats.chunks_from_origin
+                      : swarm_stats.chunks_from_peers);
+      (peer.empty() ? swarm_stats.bytes_from_origin
+                    : swarm_stats.bytes_from_peers) += length;
+    } else if (!peer.empty()) {
+      log_debug("Swarm: chunk " + std::to_string(index) + " from " + peer +
+                " rejected");
+      std::lock_guard<std::mutex> lock(swarm_mutex);
+      ++swarm_stats.chunks_rejected;
+    }
+
+    std::lock_guard<std::mutex> lock(download.mutex);
+    if (fetched) {
+      download.chunks[index] = CHUNK_DONE;
+      download.done_bytes += length;
+      transfer.set_progress(download.done_bytes, blob.size);
+    } else if (!peer.empty()) {
+      // Ask another holder, or the origin
+      download.chunks[index] = CHUNK_NEEDED;
+      download.holders[peer].erase(index);
+      download.rejected.emplace(peer, index);
+    } else {
+      log_error("Swarm: failed to fetch chunk " + std::to_string(index) +
+                " from " + download.url);
+      download.failed = true;
+      return;
+    }
+  }
+}
+
+// Keep the chunks of a partial download left by an earlier attempt. A file
+// shorter than the blob is a prefix written from the origin; in a file of
+// the full size, only chunks matching their trusted hash are kept.
+void resume_chunks(SwarmDownload &download, const SwarmConfig &config,
+                   uint64_t existing) {
+  SwarmBlob &blob = *download.blob;
+  bool prefix = existing < blob.size;
+  if (existing == 0) {
+    return;
+  } else if (!prefix) {
+    download.refreshing = true;
+    refresh_holders(download, config);
+  }
+
+  std::string data;
+  size_t kept = 0;
+  for (size_t i = 0; i < download.chunks.size(); ++i) {
+    uint64_t offset = i * blob.chunk_size;
+    uint64_t length = std::min(blob.chunk_size, blob.size - offset);
+    bool written = prefix && offset + length <= existing;
+    std::string trusted;
+    {
+      std::lock_guard<std::mutex> lock(download.mutex);
+      auto it = download.trusted.find(i);
+      trusted = it != download.trusted.end() ? it->second : "";
+    }
+    if (!written && trusted.empty()) {
+      continue;
+    }
+    data.resize(length);
+    if (pread(blob.fd, &data[0], length, offset) !=
+        static_cast<ssize_t>(length)) {
+      continue;
+    }
+    std::string hash = hash_of(data);
+    if (!written && hash != trusted) {
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(swarm_mutex);
+      blob.hashes[i] = hash;
+    }
+    std::lock_guard<std::mutex> lock(download.mutex);
+    download.chunks[i] = CHUNK_DONE;
+    download.done_bytes += length;
+    ++kept;
+  }
+  if (kept > 0) {
+    log_debug("Swarm: resuming with " + std::to_string(kept) + " chunks of " +
+              download.url);
+  }
+}
+
+} // namespace
+
+bool set_swarm_config(const SwarmConfig &config) {
+  std::lock_guard<std::mutex> lock(swarm_mutex);
+  bool serving = chunk_listener >= 0;
+  bool serve_now = config.enabled && config.listen_port > 0;
+  if (serving &&
+      (!serve_now || config.listen_port != swarm_config.listen_port)) {
+    stop_chunk_server();
+  }
+  swarm_config = config;
+  if (serve_now && chunk_listener < 0) {
+    chunk_listener = open_listener(config.listen_port);
+    if (chunk_listener < 0) {
+      return false;
+    }
+    chunk_server = new std::thread(serve, chunk_listener);
+  }
+  return true;
+}
+
+SwarmConfig get_swarm_config() {
+  std::lock_guard<std::mutex> lock(swarm_mutex);
+  return swarm_config;
+}
+
+SwarmStats get_swarm_stats() {
+  std::lock_guard<std::mutex> lock(swarm_mutex);
+  return swarm_stats;
+}
+
+bool start_swarm_tracker(int port) {
+  int listener = open_listener(port);
+  if (listener < 0) {
+    return false;
+  }
+  std::thread(serve, listener).detach();
+  return true;
+}
+
+bool swarm_enabled() { return get_swarm_config().enabled; }
+
+bool swarm_download(const std::string &url, const FileMetadata &metadata,
+                    const std::string &path, TrackedTransfer &transfer) {
+  SwarmConfig config = get_swarm_config();
+  if (metadata.size == 0 || metadata.sha256.empty() ||
+      config.chunk_size == 0) {
+    return false;
+  }
+  // A partial download is kept, see resume_chunks()
+  int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+  struct stat stat_buf;
+  uint64_t existing = fd >= 0 && fstat(fd, &stat_buf) == 0
+                          ? static_cast<uint64_t>(stat_buf.st_size)
+                          : 0;
+  if (fd < 0 || ftruncate(fd, metadata.size) != 0) {
+    log_error("Swarm: failed to create " + path);
+    if (fd >= 0) {
+      close(fd);
+    }
+    return false;
+  }
+
+  SwarmDownload download;
+  download.url = url;
+  download.sha256 = metadata.sha256;
+  download.self =
+      config.advertise_host + ":" + std::to_string(config.listen_port);
+  download.peers = config.peers;
+  download.blob = std::make_shared<SwarmBlob>();
+  download.blob->fd = fd;
+  download.blob->size = metadata.size;
+  download.blob->chunk_size = config.chunk_size;
+  size_t count = (metadata.size + config.chunk_size - 1) / config.chunk_size;
+  download.blob->hashes.resize(count);
+  download.blob->pending.resize(count);
+  download.chunks.assign(count, CHUNK_NEEDED);
+  download.start = std::hash<std::string>()(download.self + metadata.sha256 +
+                                            std::to_string(getpid())) %
+                   count;
+  {
+    std::lock_guard<std::mutex> lock(swarm_mutex);
+    prune_served_blobs();
+    swarm_blobs[metadata.sha256] = download.blob;
+  }
+  resume_chunks(download, config, existing);
+  transfer.set_progress(download.done_bytes, metadata.size);
+
+  transfer.set_state(TransferState::DOWNLOADING);
+  int workers = std::max(1, std::min<int>(config.parallel_chunks, count));
+  transfer.set_connections(workers);
+  Deadline deadline = current_deadline();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < workers; ++i) {
+    threads.emplace_back([&]() {
+      DeadlineScope scope(deadline, false);
+      fetch_chunks(download, config, transfer);
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  transfer.set_connections(0);
+  transfer.set_state(TransferState::VERIFYING);
+
+  // Peers vouch for their chunks only, the blob hash has the last word
+  bool valid = !download.failed && sha256_file(path) == metadata.sha256;
+  std::lock_guard<std::mutex> lock(swarm_mutex);
+  if (!valid) {
+    log_error("Swarm: download of " + url + " failed");
+    swarm_blobs.erase(metadata.sha256);
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    return false;
+  }
+  // Served until deleted from the cache or pushed out by newer blobs
+  download.blob->complete = true;
+  served_blobs.erase(std::remove(served_blobs.begin(), served_blobs.end(),
+                                 metadata.sha256),
+                     served_blobs.end());
+  served_blobs.push_back(metadata.sha256);
+  prune_served_blobs();
+  return true;
+}
+
+} // namespace huggingface_hub
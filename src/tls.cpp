@@ -0,0 +1,117 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <mutex>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+std::mutex kernel_tls_mutex;
+KernelTlsStats kernel_tls_stats;
+
+#ifdef HFHUB_HAVE_OPENSSL
+// The SSL_CTX handed to CURLOPT_SSL_CTX_FUNCTION is only an OpenSSL context
+// when curl itself was built against OpenSSL
+bool curl_uses_openssl() {
+  const curl_version_info_data *info = curl_version_info(CURLVERSION_NOW);
+  return info->ssl_version &&
+         std::string(info->ssl_version).rfind("OpenSSL", 0) == 0;
+}
+
+// OpenSSL only offloads records written to a socket BIO. Since 7.87 curl
+// reads and writes through its connection filters with a BIO of its own,
+// so kTLS can never be enabled there
+bool curl_uses_socket_bio() {
+  return curl_version_info(CURLVERSION_NOW)->version_num < 0x075700;
+}
+
+bool kernel_tls_possible() {
+  static const bool possible = curl_uses_socket_bio();
+  return possible;
+}
+
+void note_kernel_tls(SSL *ssl) {
+  bool receive = BIO_get_ktls_recv(SSL_get_rbio(ssl));
+  bool send = BIO_get_ktls_send(SSL_get_wbio(ssl));
+  const char *host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+  log_debug(std::string("kTLS on ") + (host ? host : "unknown host") +
+            ": receive " + (receive ? "offloaded" : "in user space") +
+            ", send " + (send ? "offloaded" : "in user space"));
+
+  std::lock_guard<std::mutex> lock(kernel_tls_mutex);
+  ++kernel_tls_stats.handshakes;
+  kernel_tls_stats.receive_offloaded += receive;
+  kernel_tls_stats.send_offloaded += send;
+}
+
+void tls_info_callback(const SSL *ssl, int where, int) {
+  SSL *connection = const_cast<SSL *>(ssl);
+  note_session_handshake(connection, where);
+  if ((where & SSL_CB_HANDSHAKE_DONE) &&
+      (SSL_get_options(connection) & SSL_OP_ENABLE_KTLS)) {
+    note_kernel_tls(connection);
+  }
+}
+
+CURLcode configure_ssl_context(CURL *, void *context, void *) {
+  SSL_CTX *ssl_context = static_cast<SSL_CTX *>(context);
+  prepare_session_cache(ssl_context);
+  if (get_transport_config().kernel_tls && kernel_tls_possible()) {
+    SSL_CTX_set_options(ssl_context, SSL_OP_ENABLE_KTLS);
+  }
+  SSL_CTX_set_info_callback(ssl_context, tls_info_callback);
+  return CURLE_OK;
+}
+#endif
+
+} // namespace
+
+void apply_tls_hooks(CURL *curl) {
+#ifdef HFHUB_HAVE_OPENSSL
+  static const bool openssl = curl_uses_openssl();
+  bool kernel_tls = get_transport_config().kernel_tls;
+  if (kernel_tls && !(openssl && kernel_tls_possible())) {
+    static std::once_flag logged;
+    std::call_once(logged, [] {
+      log_info("kTLS is not available with this curl build, ignoring it");
+    });
+    kernel_tls = false;
+  }
+  if (openssl && (kernel_tls || get_connection_cache_config().enabled)) {
+    curl_easy_setopt(curl, CURLOPT_SSL_CTX_FUNCTION, configure_ssl_context);
+  }
+#else
+  (void)curl;
+#endif
+}
+
+KernelTlsStats get_kernel_tls_stats() {
+  std::lock_guard<std::mutex> lock(kernel_tls_mutex);
+  return kernel_tls_stats;
+}
+
+} // namespace huggingface_hub
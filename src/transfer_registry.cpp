@@ -0,0 +1,130 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+// Counters are atomics so that progress callbacks never take a lock
+struct TransferRecord {
+  uint64_t id = 0;
+  std::string repo_id;
+  std::string filename;
+  std::chrono::steady_clock::time_point started;
+  std::atomic<TransferState> state{TransferState::METADATA};
+  std::atomic<uint64_t> bytes_done{0};
+  std::atomic<uint64_t> bytes_total{0};
+  std::atomic<int> connections{0};
+  std::atomic<int> retries{0};
+
+  // Rate sample, only touched by get_active_transfers() under its lock
+  std::chrono::steady_clock::time_point sample_time;
+  uint64_t sample_bytes = 0;
+  double bytes_per_second = 0;
+};
+
+namespace {
+
+// Rates are averaged over at least this long, however often they are polled
+const double RATE_WINDOW_SECONDS = 1.0;
+
+std::mutex registry_mutex;
+uint64_t next_transfer_id = 1;
+std::map<uint64_t, std::shared_ptr<TransferRecord>> active_transfers;
+
+} // namespace
+
+TrackedTransfer::TrackedTransfer(const std::string &repo_id,
+                                 const std::string &filename)
+    : record(std::make_shared<TransferRecord>()) {
+  record->repo_id = repo_id;
+  record->filename = filename;
+  record->started = std::chrono::steady_clock::now();
+  record->sample_time = record->started;
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  record->id = next_transfer_id++;
+  active_transfers[record->id] = record;
+}
+
+TrackedTransfer::~TrackedTransfer() {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  active_transfers.erase(record->id);
+}
+
+void TrackedTransfer::set_state(TransferState state) { record->state = state; }
+
+void TrackedTransfer::set_progress(uint64_t done, uint64_t total) {
+  record->bytes_done = done;
+  record->bytes_total = total;
+}
+
+void TrackedTransfer::set_connections(int connections) {
+  record->connections = connections;
+}
+
+void TrackedTransfer::add_retry() { ++record->retries; }
+
+std::vector<TransferInfo> get_active_transfers() {
+  auto now = std::chrono::steady_clock::now();
+  std::vector<TransferInfo> transfers;
+
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  transfers.reserve(active_transfers.size());
+  for (auto &entry : active_transfers) {
+    TransferRecord &record = *entry.second;
+    TransferInfo info;
+    info.id = record.id;
+    info.repo_id = record.repo_id;
+    info.filename = record.filename;
+    info.state = record.state;
+    info.bytes_done = record.bytes_done;
+    info.bytes_total = record.bytes_total;
+    info.connections = record.connections;
+    info.retries = record.retries;
+    info.age_seconds =
+        std::chrono::duration<double>(now - record.started).count();
+
+    double elapsed =
+        std::chrono::duration<double>(now - record.sample_time).count();
+    if (elapsed >= RATE_WINDOW_SECONDS) {
+      uint64_t delta = info.bytes_done - std::min(info.bytes_done,
+                                                  record.sample_bytes);
+      record.bytes_per_second = delta / elapsed;
+      record.sample_time = now;
+      record.sample_bytes = info.bytes_done;
+    }
+    info.bytes_per_second = record.bytes_per_second;
+    transfers.push_back(std::move(info));
+  }
+  return transfers;
+}
+
+} // namespace huggingface_hub
@@ -0,0 +1,348 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <sys/socket.h>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+std::mutex transport_mutex;
+TransportConfig transport_config;
+
+// Connection, DNS and TLS session caches shared by every handle
+CURLSH *share_handle = nullptr;
+std::once_flag share_once;
+std::mutex share_mutexes[CURL_LOCK_DATA_LAST];
+
+// Hosts warmed by prewarm() and the setup time each warm connection cost
+std::mutex prewarm_mutex;
+std::map<std::string, double> warm_hosts;
+PrewarmStats prewarm_stats;
+// Warming threads, joined at exit before the state they use is destroyed
+std::vector<std::thread> prewarm_threads;
+std::atomic<bool> prewarm_stopping(false);
+
+// CDN hosts the public Hub redirects downloads to
+const char *HUB_CDN_HOSTS[] = {
+    "cdn-lfs.huggingface.co",
+    "cdn-lfs-us-1.hf.co",
+    "cas-bridge.xethub.hf.co",
+};
+
+void share_lock(CURL *, curl_lock_data data, curl_lock_access, void *) {
+  share_mutexes[data].lock();
+}
+
+void share_unlock(CURL *, curl_lock_data data, void *) {
+  share_mutexes[data].unlock();
+}
+
+CURLSH *get_share_handle() {
+  std::call_once(share_once, []() {
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    share_handle = curl_share_init();
+    curl_share_setopt(share_handle, CURLSHOPT_LOCKFUNC, share_lock);
+    curl_share_setopt(share_handle, CURLSHOPT_UNLOCKFUNC, share_unlock);
+    curl_share_setopt(share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+    curl_share_setopt(share_handle, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_handle, CURLSHOPT_SHARE,
+                      CURL_LOCK_DATA_SSL_SESSION);
+  });
+  return share_handle;
+}
+
+std::string url_host(const std::string &url) {
+  std::string host;
+  CURLU *handle = curl_url();
+  char *part = nullptr;
+  if (curl_url_set(handle, CURLUPART_URL, url.c_str(), 0) == CURLUE_OK &&
+      curl_url_get(handle, CURLUPART_HOST, &part, 0) == CURLUE_OK) {
+    host = part;
+    curl_free(part);
+  }
+  curl_url_cleanup(handle);
+  return host;
+}
+
+size_t discard_data(void *, size_t size, size_t nmemb, void *) {
+  return size * nmemb;
+}
+
+// Abort the warming requests still running at exit
+int prewarm_progress(void *, curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+  return prewarm_stopping ? 1 : 0;
+}
+
+void join_prewarm_threads() {
+  prewarm_stopping = true;
+  std::vector<std::thread> threads;
+  {
+    std::lock_guard<std::mutex> lock(prewarm_mutex);
+    threads.swap(prewarm_threads);
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
+void prewarm_url(const std::string &url) {
+  CURL *curl = create_curl_handle(true);
+  if (!curl) {
+    return;
+  }
+  curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+  HttpTransfer transfer;
+  transfer.method = "HEAD";
+  transfer.url = url;
+  transfer.write_function = discard_data;
+  transfer.progress_function = prewarm_progress;
+  CURLcode res = http_perform(curl, transfer);
+  note_connection(curl, url);
+
+  std::string host = url_host(url);
+  std::lock_guard<std::mutex> lock(prewarm_mutex);
+  if (res != CURLE_OK) {
+    log_debug("Failed to prewarm " + host + ": " + curl_easy_strerror(res));
+    ++prewarm_stats.hosts_failed;
+  } else {
+    double setup_seconds = 0;
+    curl_easy_getinfo(curl, CURLINFO_APPCONNECT_TIME, &setup_seconds);
+    if (setup_seconds <= 0) {
+      curl_easy_getinfo(curl, CURLINFO_CONNECT_TIME, &setup_seconds);
+    }
+    warm_hosts[host] = setup_seconds;
+    ++prewarm_stats.hosts_warmed;
+    prewarm_stats.warmup_seconds += setup_seconds;
+  }
+  // The connection stays in the shared pool after the handle is gone
+  curl_easy_cleanup(curl);
+}
+
+void prewarm_urls(std::vector<std::string> urls) {
+  std::vector<std::thread> workers;
+  for (const auto &url : urls) {
+    workers.emplace_back(prewarm_url, url);
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+int transport_sockopt_callback(void *, curl_socket_t fd, curlsocktype purpose) {
+  if (purpose != CURLSOCKTYPE_IPCXN) {
+    return CURL_SOCKOPT_OK;
+  }
+
+  int receive_buffer, send_buffer;
+  {
+    std::lock_guard<std::mutex> lock(transport_mutex);
+    receive_buffer = transport_config.socket_receive_buffer;
+    send_buffer = transport_config.socket_send_buffer;
+  }
+
+  // Failing to resize a buffer is not fatal, the kernel default is used
+  if (receive_buffer > 0 &&
+      setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receive_buffer,
+                 sizeof(receive_buffer)) != 0) {
+    log_debug("Failed to set SO_RCVBUF to " + std::to_string(receive_buffer));
+  }
+  if (send_buffer > 0 && setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &send_buffer,
+                                    sizeof(send_buffer)) != 0) {
+    log_debug("Failed to set SO_SNDBUF to " + std::to_string(send_buffer));
+  }
+
+  return CURL_SOCKOPT_OK;
+}
+
+} // namespace
+
+TransportConfig TransportConfig::lan() {
+  TransportConfig config;
+  config.connect_timeout_ms = 2000;
+  config.api_timeout_ms = 10000;
+  config.low_speed_limit = 1024 * 1024;
+  config.low_speed_time = 5;
+  config.receive_buffer_size = 256 * 1024;
+  config.keepalive_idle = 15;
+  config.keepalive_interval = 5;
+  return config;
+}
+
+TransportConfig TransportConfig::wan() {
+  TransportConfig config;
+  config.connect_timeout_ms = 10000;
+  config.api_timeout_ms = 60000;
+  config.low_speed_limit = 16 * 1024;
+  config.low_speed_time = 30;
+  config.receive_buffer_size = 128 * 1024;
+  return config;
+}
+
+TransportConfig TransportConfig::high_bdp() {
+  TransportConfig config;
+  config.connect_timeout_ms = 15000;
+  config.api_timeout_ms = 60000;
+  config.low_speed_limit = 64 * 1024;
+  config.low_speed_time = 60;
+  config.receive_buffer_size = CURL_MAX_READ_SIZE;
+  config.socket_receive_buffer = 32 * 1024 * 1024;
+  config.socket_send_buffer = 4 * 1024 * 1024;
+  return config;
+}
+
+void set_transport_config(const TransportConfig &config) {
+  std::lock_guard<std::mutex> lock(transport_mutex);
+  transport_config = config;
+}
+
+TransportConfig get_transport_config() {
+  std::lock_guard<std::mutex> lock(transport_mutex);
+  return transport_config;
+}
+
+void apply_transport_config(CURL *curl, bool api_request) {
+  TransportConfig config = get_transport_config();
+  long timeout_ms =
+      api_request ? config.api_timeout_ms : config.total_timeout_ms;
+  apply_deadline_timeouts(config.connect_timeout_ms, timeout_ms,
+                          config.low_speed_time);
+
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, config.connect_timeout_ms);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout_ms);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, config.low_speed_limit);
+  curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, config.low_speed_time);
+
+  if (config.receive_buffer_size > 0) {
+    curl_easy_setopt(curl, CURLOPT_BUFFERSIZE,
+                     std::min<long>(config.receive_buffer_size,
+                                    CURL_MAX_READ_SIZE));
+  }
+  if (config.socket_receive_buffer > 0 || config.socket_send_buffer > 0) {
+    curl_easy_setopt(curl, CURLOPT_SOCKOPTFUNCTION,
+                     transport_sockopt_callback);
+  }
+
+  if (!config.ca_bundle.empty()) {
+    curl_easy_setopt(curl, CURLOPT_CAINFO, config.ca_bundle.c_str());
+  }
+
+  curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, config.tcp_nodelay ? 1L : 0L);
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE,
+                   config.tcp_keepalive ? 1L : 0L);
+  if (config.tcp_keepalive) {
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, config.keepalive_idle);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, config.keepalive_interval);
+  }
+
+  switch (config.ip_resolve) {
+  case IpResolve::V4:
+    curl_easy_setopt(curl, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V4);
+    break;
+  case IpResolve::V6:
+    curl_easy_setopt(curl, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_V6);
+    break;
+  default:
+    curl_easy_setopt(curl, CURLOPT_IPRESOLVE, CURL_IPRESOLVE_WHATEVER);
+    break;
+  }
+}
+
+CURL *create_curl_handle(bool api_request) {
+  CURLSH *share = get_share_handle();
+  CURL *curl = curl_easy_init();
+  if (curl) {
+    curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    apply_transport_config(curl, api_request);
+    apply_connection_cache(curl);
+    apply_tls_hooks(curl);
+  }
+  return curl;
+}
+
+void note_connection_reuse(CURL *curl, const std::string &url) {
+  note_connection(curl, url);
+
+  long new_connections = 0;
+  curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_connections);
+  if (new_connections > 0) {
+    return;
+  }
+
+  char *effective_url = nullptr;
+  curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effective_url);
+
+  std::lock_guard<std::mutex> lock(prewarm_mutex);
+  if (warm_hosts.empty()) {
+    return;
+  }
+  // Each warm connection is credited once, on its first reuse
+  for (const std::string &host :
+       {url_host(url), url_host(effective_url ? effective_url : "")}) {
+    auto it = warm_hosts.find(host);
+    if (it != warm_hosts.end()) {
+      ++prewarm_stats.connections_reused;
+      prewarm_stats.time_saved_seconds += it->second;
+      warm_hosts.erase(it);
+    }
+  }
+}
+
+void prewarm(const std::vector<std::string> &hosts) {
+  std::vector<std::string> urls;
+  for (const auto &host : hosts) {
+    urls.push_back("https://" + host + "/");
+  }
+  if (urls.empty()) {
+    std::string endpoint = get_hf_endpoint();
+    urls.push_back(endpoint + "/");
+    // A mirror set through HF_ENDPOINT does not redirect to the Hub CDN
+    if (url_host(endpoint) == "huggingface.co") {
+      for (const char *host : HUB_CDN_HOSTS) {
+        urls.push_back(std::string("https://") + host + "/");
+      }
+    }
+  }
+  get_share_handle();
+  static std::once_flag exit_join;
+  std::call_once(exit_join, []() { std::atexit(join_prewarm_threads); });
+  std::lock_guard<std::mutex> lock(prewarm_mutex);
+  prewarm_threads.emplace_back(prewarm_urls, urls);
+}
+
+PrewarmStats get_prewarm_stats() {
+  std::lock_guard<std::mutex> lock(prewarm_mutex);
+  return prewarm_stats;
+}
+
+} // namespace huggingface_hub
@@ -0,0 +1,910 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <regex>
+#include <set>
+#include <thread>
+
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "huggingface_hub.h"
+#include "huggingface_hub_internal.h"
+
+namespace huggingface_hub {
+
+namespace {
+
+// Number of leading bytes sent to the preupload endpoint
+const size_t PREUPLOAD_SAMPLE_SIZE = 512;
+// Inlined contents are base64-encoded this many bytes at a time
+const size_t PAYLOAD_BLOCK_SIZE = 3 * 16384;
+
+struct HttpResponse {
+  CURLcode code = CURLE_OK;
+  std::string body;
+  std::string headers;
+};
+
+struct MappedFile {
+  const char *data = nullptr;
+  size_t size = 0;
+  bool mapped = false;
+
+  ~MappedFile() {
+    if (mapped) {
+      munmap(const_cast<char *>(data), size);
+    }
+  }
+};
+
+struct PendingFile {
+  UploadFile file;
+  const std::string *content = nullptr; // In-memory content, if any
+  uint64_t size = 0;
+  std::string sha256;
+  std::string sample;
+  bool lfs = false;
+  bool ignored = false;
+  MappedFile mapping;
+};
+
+struct PartJob {
+  PendingFile *file;
+  int number;
+  uint64_t offset;
+  uint64_t length;
+  std::string url;
+  std::string etag;
+};
+
+std::string repo_api_path(const std::string &repo_id,
+                          const UploadOptions &options) {
+  return "/api/" + options.repo_type + "s/" + repo_id;
+}
+
+std::string repo_git_url(const std::string &repo_id,
+                         const UploadOptions &options) {
+  std::string prefix =
+      options.repo_type == "model" ? "" : options.repo_type + "s/";
+  return get_hf_endpoint() + "/" + prefix + repo_id + ".git";
+}
+
+HttpResponse send_request(const std::string &method, const std::string &url,
+                          const std::vector<std::string> &headers,
+                          const std::string &body,
+                          curl_read_callback read_function = nullptr,
+                          void *read_data = nullptr,
+                          curl_off_t upload_size = -1) {
+  HttpResponse response;
+  CURL *curl = create_curl_handle(method != "PUT");
+  if (!curl) {
+    response.code = CURLE_FAILED_INIT;
+    return response;
+  }
+
+  struct curl_slist *http_headers = NULL;
+  for (const auto &header : headers) {
+    http_headers = curl_slist_append(http_headers, header.c_str());
+  }
+  // Pre-signed storage URLs must not receive the Hub token
+  if (url.rfind(get_hf_endpoint(), 0) == 0) {
+    http_headers = append_auth_header(http_headers);
+  }
+
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, http_headers);
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
+
+  HttpTransfer transfer;
+  transfer.method = method;
+  transfer.url = url;
+  transfer.request_body = body;
+  transfer.write_function = write_string_data;
+  transfer.write_data = &response.body;
+  transfer.header_function = write_string_data;
+  transfer.header_data = &response.headers;
+  transfer.read_function = read_function;
+  transfer.read_data = read_data;
+  transfer.upload_size = upload_size;
+
+  response.code = http_perform(curl, transfer);
+  if (response.code != CURLE_OK) {
+    log_debug(method + " " + url + " failed: " +
+              curl_easy_strerror(response.code) + " " + response.body);
+  }
+
+  curl_slist_free_all(http_headers);
+  curl_easy_cleanup(curl);
+  return response;
+}
+
+std::string request_error(const std::string &what,
+                          const HttpResponse &response) {
+  return what + " failed: " + curl_easy_strerror(response.code);
+}
+
+// Run jobs on a fixed number of threads; each job returns false on failure
+template <typename Job>
+bool run_parallel(std::vector<Job> &jobs, int workers,
+                  bool (*work)(Job &, const UploadOptions &),
+                  const UploadOptions &options) {
+  std::atomic<size_t> next(0);
+  std::atomic<bool> failed(false);
+  std::vector<std::thread> threads;
+  int count = std::max(1, std::min<int>(workers, jobs.size()));
+  for (int i = 0; i < count; ++i) {
+    threads.emplace_back([&]() {
+      size_t index;
+      while (!failed && (index = next++) < jobs.size()) {
+        if (!work(jobs[index], options)) {
+          failed = true;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  return !failed;
+}
+
+bool map_file(const std::string &path, MappedFile &mapping) {
+  int fd = open(path.c_str(), O_RDONLY);
+  struct stat stat_buf;
+  if (fd < 0 || fstat(fd, &stat_buf) != 0) {
+    log_error("Failed to open " + path);
+    if (fd >= 0) {
+      close(fd);
+    }
+    return false;
+  }
+
+  mapping.size = stat_buf.st_size;
+  if (mapping.size > 0) {
+    void *data = mmap(nullptr, mapping.size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      log_error("Failed to map " + path);
+      close(fd);
+      return false;
+    }
+    mapping.data = static_cast<const char *>(data);
+    mapping.mapped = true;
+  }
+  close(fd);
+  return true;
+}
+
+bool hash_file(PendingFile *&pending, const UploadOptions &) {
+  const std::string &path = pending->file.local_path;
+  if (pending->content) {
+    pending->mapping.data = pending->content->data();
+    pending->mapping.size = pending->content->size();
+  } else if (!map_file(path, pending->mapping)) {
+    return false;
+  }
+  pending->size = pending->mapping.size;
+
+  // Hash straight from the mapping, which is reused to send the file
+  Sha256 hash;
+  if (pending->size > 0) {
+    madvise(const_cast<char *>(pending->mapping.data), pending->size,
+            MADV_SEQUENTIAL);
+    hash.update(pending->mapping.data, pending->size);
+    pending->sample.assign(
+        pending->mapping.data,
+        std::min<uint64_t>(PREUPLOAD_SAMPLE_SIZE, pending->size));
+  }
+  pending->sha256 = hash.hex_digest();
+  return true;
+}
+
+bool upload_part(PartJob &part, const UploadOptions &options) {
+  for (int attempt = 0; attempt <= options.max_retries; ++attempt) {
+    if (attempt > 0) {
+      log_debug("Retrying part " + std::to_string(part.number) + " of " +
+                part.file->file.path_in_repo);
+      std::this_thread::sleep_for(std::chrono::milliseconds(500 << attempt));
+    }
+
+    MemoryReader reader;
+    reader.data = part.file->mapping.data + part.offset;
+    reader.size = part.length;
+    HttpResponse response = send_request("PUT", part.url, {}, "",
+                                         read_memory_data, &reader,
+                                         reader.size);
+    if (response.code != CURLE_OK) {
+      continue;
+    }
+
+    std::smatch match;
+    if (std::regex_search(response.headers, match,
+                          std::regex(R"(\n[Ee][Tt][Aa][Gg]:\s*([^\r\n]+))"))) {
+      part.etag = match[1];
+    }
+    return true;
+  }
+
+  log_error("Failed to upload part " + std::to_string(part.number) + " of " +
+            part.file->file.path_in_repo);
+  return false;
+}
+
+bool upload_basic(PendingFile &file, const std::string &url,
+                  const std::vector<std::string> &headers,
+                  const UploadOptions &options) {
+  for (int attempt = 0; attempt <= options.max_retries; ++attempt) {
+    MemoryReader reader;
+    reader.data = file.mapping.data;
+    reader.size = file.size;
+    if (send_request("PUT", url, headers, "", read_memory_data, &reader,
+                     reader.size)
+            .code == CURLE_OK) {
+      return true;
+    }
+  }
+  log_error("Failed to upload " + file.file.path_in_repo);
+  return false;
+}
+
+std::vector<std::string> action_headers(const std::string &action) {
+  std::vector<std::string> headers;
+  std::string header = json_value_of(action, "header");
+  std::regex pair(R"re("([^"]+)"\s*:\s*"((?:[^"\\]|\\.)*)")re");
+  for (auto it = std::sregex_iterator(header.begin(), header.end(), pair);
+       it != std::sregex_iterator(); ++it) {
+    headers.push_back((*it)[1].str() + ": " + json_unescape((*it)[2]));
+  }
+  return headers;
+}
+
+// Upload the blobs the Hub does not have yet through the LFS batch API
+bool upload_lfs_files(const std::string &repo_id,
+                      std::vector<PendingFile *> &files,
+                      const UploadOptions &options, UploadResult &result) {
+  std::map<std::string, PendingFile *> by_oid;
+  std::string body = "{\"operation\": \"upload\", \"transfers\": [\"basic\", "
+                     "\"multipart\"], \"hash_algo\": \"sha256\", "
+                     "\"ref\": {\"name\": \"" +
+                     json_escape(options.revision) + "\"}, \"objects\": [";
+  for (size_t i = 0; i < files.size(); ++i) {
+    body += std::string(i > 0 ? ", " : "") + "{\"oid\": \"" +
+            files[i]->sha256 + "\", \"size\": " +
+            std::to_string(files[i]->size) + "}";
+    by_oid[files[i]->sha256] = files[i];
+  }
+  body += "]}";
+
+  std::vector<std::string> headers = {
+      "Accept: application/vnd.git-lfs+json",
+      "Content-Type: application/vnd.git-lfs+json"};
+  HttpResponse batch =
+      send_request("POST", repo_git_url(repo_id, options) +
+                               "/info/lfs/objects/batch",
+                   headers, body);
+  if (batch.code != CURLE_OK) {
+    result.error = request_error("LFS batch", batch);
+    return false;
+  }
+
+  std::vector<PartJob> parts;
+  std::vector<std::pair<PendingFile *, std::string>> completions;
+  std::vector<std::pair<PendingFile *, std::string>> verifications;
+  std::set<std::string> answered;
+  for (const auto &object : split_json_objects(json_value_of(batch.body,
+                                                             "objects"))) {
+    auto it = by_oid.find(json_string_of(object, "oid"));
+    if (it == by_oid.end()) {
+      continue;
+    }
+    PendingFile *file = it->second;
+    answered.insert(it->first);
+
+    // A refused object must fail the upload, or the commit would reference
+    // a blob the Hub does not store
+    std::string error = json_value_of(object, "error");
+    if (!error.empty()) {
+      result.error = "LFS batch refused " + file->file.path_in_repo + ": " +
+                     json_string_of(error, "message");
+      return false;
+    }
+
+    std::string upload = json_value_of(object, "upload");
+    if (upload.empty()) {
+      // No upload action means the Hub already stores this blob
+      ++result.files_deduplicated;
+      continue;
+    }
+    ++result.files_uploaded;
+    result.bytes_uploaded += file->size;
+
+    std::string href = json_string_of(upload, "href");
+    std::string header = json_value_of(upload, "header");
+    std::string chunk_size = json_string_of(header, "chunk_size");
+    if (chunk_size.empty()) {
+      if (!upload_basic(*file, href, action_headers(upload), options)) {
+        result.error = "Failed to upload " + file->file.path_in_repo;
+        return false;
+      }
+    } else {
+      uint64_t chunk = std::stoull(chunk_size);
+      int count = static_cast<int>((file->size + chunk - 1) / chunk);
+      for (int number = 1; number <= count; ++number) {
+        char key[12];
+        snprintf(key, sizeof(key), "%05d", number);
+        PartJob part;
+        part.file = file;
+        part.number = number;
+        part.offset = (number - 1) * chunk;
+        part.length = std::min<uint64_t>(chunk, file->size - part.offset);
+        part.url = json_string_of(header, key);
+        parts.push_back(part);
+      }
+      completions.push_back({file, href});
+    }
+
+    std::string verify = json_value_of(object, "verify");
+    if (!verify.empty()) {
+      verifications.push_back({file, verify});
+    }
+  }
+
+  for (const auto &file : by_oid) {
+    if (!answered.count(file.first)) {
+      result.error = "LFS batch did not answer for " +
+                     file.second->file.path_in_repo;
+      return false;
+    }
+  }
+
+  if (!run_parallel(parts, options.parallel_parts, upload_part, options)) {
+    result.error = "Failed to upload multipart LFS files";
+    return false;
+  }
+
+  for (const auto &completion : completions) {
+    PendingFile *file = completion.first;
+    std::string parts_json;
+    for (const auto &part : parts) {
+      if (part.file == file) {
+        parts_json += std::string(parts_json.empty() ? "" : ", ") +
+                      "{\"partNumber\": " + std::to_string(part.number) +
+                      ", \"etag\": \"" + json_escape(part.etag) + "\"}";
+      }
+    }
+    std::string complete_body =
+        "{\"oid\": \"" + file->sha256 + "\", \"parts\": [" + parts_json + "]}";
+    HttpResponse complete =
+        send_request("POST", completion.second, headers, complete_body);
+    if (complete.code != CURLE_OK) {
+      result.error = request_error("Multipart completion", complete);
+      return false;
+    }
+  }
+
+  for (const auto &verification : verifications) {
+    PendingFile *file = verification.first;
+    std::vector<std::string> verify_headers =
+        action_headers(verification.second);
+    verify_headers.insert(verify_headers.end(), headers.begin(), headers.end());
+    HttpResponse verify =
+        send_request("POST", json_string_of(verification.second, "href"),
+                     verify_headers,
+                     "{\"oid\": \"" + file->sha256 +
+                         "\", \"size\": " + std::to_string(file->size) + "}");
+    if (verify.code != CURLE_OK) {
+      result.error = request_error("LFS verification", verify);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::string base64_encode(const char *data, size_t size) {
+  static const char alphabet[] =
+      "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  std::string encoded;
+  encoded.reserve((size + 2) / 3 * 4);
+  for (size_t i = 0; i < size; i += 3) {
+    uint32_t chunk = static_cast<uint8_t>(data[i]) << 16;
+    if (i + 1 < size) {
+      chunk |= static_cast<uint8_t>(data[i + 1]) << 8;
+    }
+    if (i + 2 < size) {
+      chunk |= static_cast<uint8_t>(data[i + 2]);
+    }
+    encoded += alphabet[(chunk >> 18) & 0x3f];
+    encoded += alphabet[(chunk >> 12) & 0x3f];
+    encoded += i + 1 < size ? alphabet[(chunk >> 6) & 0x3f] : '=';
+    encoded += i + 2 < size ? alphabet[chunk & 0x3f] : '=';
+  }
+  return encoded;
+}
+
+// A piece of the commit payload: literal text, or bytes sent as base64
+struct PayloadSegment {
+  std::string text;
+  const char *data = nullptr;
+  size_t size = 0;
+};
+
+struct PayloadReader {
+  std::vector<PayloadSegment> segments;
+  size_t segment = 0;
+  size_t offset = 0;
+  std::string staged;
+  size_t staged_position = 0;
+};
+
+// Stage the next piece of the payload; returns false once it is all sent
+bool stage_payload(PayloadReader &reader) {
+  while (reader.segment < reader.segments.size()) {
+    const PayloadSegment &segment = reader.segments[reader.segment];
+    reader.staged_position = 0;
+    if (!segment.data) {
+      reader.staged = segment.text;
+      ++reader.segment;
+      return true;
+    }
+    if (reader.offset < segment.size) {
+      size_t length =
+          std::min(PAYLOAD_BLOCK_SIZE, segment.size - reader.offset);
+      reader.staged = base64_encode(segment.data + reader.offset, length);
+      reader.offset += length;
+      return true;
+    }
+    reader.offset = 0;
+    ++reader.segment;
+  }
+  return false;
+}
+
+size_t read_payload(char *buffer, size_t size, size_t nitems, void *userdata) {
+  PayloadReader *reader = static_cast<PayloadReader *>(userdata);
+  size_t capacity = size * nitems;
+  size_t written = 0;
+  while (written < capacity) {
+    if (reader->staged_position == reader->staged.size() &&
+        !stage_payload(*reader)) {
+      break;
+    }
+    size_t length = std::min(capacity - written,
+                             reader->staged.size() - reader->staged_position);
+    memcpy(buffer + written, reader->staged.data() + reader->staged_position,
+           length);
+    reader->staged_position += length;
+    written += length;
+  }
+  return written;
+}
+
+void add_text(std::vector<PayloadSegment> &segments, const std::string &text) {
+  PayloadSegment segment;
+  segment.text = text;
+  segments.push_back(segment);
+}
+
+std::string path_value(const std::string &key, const std::string &path) {
+  return "{\"key\": \"" + key + "\", \"value\": {\"path\": \"" +
+         json_escape(path) + "\"";
+}
+
+// Resolve the copied files, grouped by source revision
+bool resolve_copies(const std::string &repo_id,
+                    const std::vector<CommitOperation> &operations,
+                    const UploadOptions &options,
+                    std::vector<PendingFile> &pending,
+                    std::vector<std::string> &copied, UploadResult &result) {
+  std::map<std::string, std::vector<size_t>> by_revision;
+  for (size_t i = 0; i < operations.size(); ++i) {
+    if (operations[i].type == CommitOperationType::COPY) {
+      const std::string &revision = operations[i].src_revision;
+      by_revision[revision.empty() ? options.revision : revision].push_back(i);
+    }
+  }
+
+  std::string prefix =
+      options.repo_type == "model" ? "" : options.repo_type + "s/";
+  for (const auto &group : by_revision) {
+    std::string body = "{\"paths\": [";
+    for (size_t i = 0; i < group.second.size(); ++i) {
+      body += (i > 0 ? ", \"" : "\"") +
+              json_escape(operations[group.second[i]].src_path) + "\"";
+    }
+    body += "]}";
+
+    std::string response;
+    CURLcode res = api_post(repo_api_path(repo_id, options) + "/paths-info/" +
+                                group.first,
+                            body, response);
+    if (res != CURLE_OK) {
+      result.error =
+          "Paths info failed: " + std::string(curl_easy_strerror(res));
+      return false;
+    }
+    std::map<std::string, std::string> objects;
+    for (const auto &object : split_json_objects(response)) {
+      objects[json_string_of(object, "path")] = object;
+    }
+
+    for (size_t index : group.second) {
+      const CommitOperation &operation = operations[index];
+      auto it = objects.find(operation.src_path);
+      if (it == objects.end()) {
+        result.error = "File " + operation.src_path + " not found in " +
+                       repo_id + " at " + group.first;
+        return false;
+      }
+
+      FileMetadata metadata = extract_metadata(it->second);
+      PendingFile &file = pending[index];
+      if (!metadata.sha256.empty()) {
+        // LFS copies point the new path at the stored blob
+        file.lfs = true;
+        file.sha256 = metadata.sha256;
+        file.size = metadata.size;
+        continue;
+      }
+
+      HttpResponse content =
+          send_request("GET", get_hf_endpoint() + "/" + prefix + repo_id +
+                                  "/resolve/" + group.first + "/" +
+                                  operation.src_path,
+                       {}, "");
+      if (content.code != CURLE_OK) {
+        result.error = request_error("Download of " + operation.src_path,
+                                     content);
+        return false;
+      }
+      copied[index] = std::move(content.body);
+      file.mapping.data = copied[index].data();
+      file.mapping.size = copied[index].size();
+      file.size = copied[index].size();
+    }
+  }
+  return true;
+}
+
+// Store the content of a sent file as a blob, under a temporary name first
+// Copy a file by sharing its extents, on file systems that support it
+bool clone_file(const std::string &source, const std::string &target) {
+#ifdef FICLONE
+  int in = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+  int out = open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                 0644);
+  bool cloned = in >= 0 && out >= 0 && ioctl(out, FICLONE, in) == 0;
+  if (in >= 0) {
+    close(in);
+  }
+  if (out >= 0) {
+    close(out);
+  }
+  return cloned;
+#else
+  (void)source;
+  (void)target;
+  return false;
+#endif
+}
+
+bool seed_blob(RepoCache &cache, const std::string &blob,
+               const PendingFile &file) {
+  static std::atomic<uint64_t> seed_counter(0);
+  std::string temporary_name = blob + ".incomplete-" +
+                               std::to_string(getpid()) + "-" +
+                               std::to_string(seed_counter++);
+  std::string temporary_path = cache.path + "blobs/" + temporary_name;
+  std::error_code error;
+  if (file.content) {
+    std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+    stream.write(file.content->data(), file.content->size());
+    if (!stream) {
+      error = std::make_error_code(std::errc::io_error);
+    }
+  } else if (!clone_file(file.file.local_path, temporary_path)) {
+    // Not a hard link: editing the local file must not change the blob
+    std::filesystem::copy_file(
+        file.file.local_path, temporary_path,
+        std::filesystem::copy_options::overwrite_existing, error);
+  }
+  // The local file may have changed since it was hashed and sent
+  if (!error && sha256_file(temporary_path) != file.sha256) {
+    error = std::make_error_code(std::errc::io_error);
+    log_error(file.file.path_in_repo + " changed since it was uploaded");
+  }
+
+  DurabilityMode durability = get_durability_config().mode;
+  if (!error && durability != DurabilityMode::NONE) {
+    sync_file(temporary_path);
+  }
+  if (error || renameat(cache.blobs->fd, temporary_name.c_str(),
+                        cache.blobs->fd, blob.c_str()) != 0) {
+    log_error("Failed to cache " + file.file.path_in_repo +
+              (error ? ": " + error.message() : ""));
+    std::filesystem::remove(temporary_path, error);
+    return false;
+  }
+  if (durability == DurabilityMode::FULL) {
+    sync_directory(cache.path + "blobs");
+  }
+  return true;
+}
+
+// Seed the cache with a new commit. The sent files are stored under the
+// blob names the Hub lists for them, every file of the commit whose blob
+// is cached is linked, and refs/<revision> is moved last, only once the
+// snapshot holds the whole commit.
+void seed_cache(const std::string &repo_id, const UploadOptions &options,
+                const std::string &commit_oid,
+                const std::vector<PendingFile> &pending) {
+  auto listing_result =
+      list_repo_files(repo_id, options.repo_type, commit_oid);
+  if (std::holds_alternative<std::string>(listing_result)) {
+    log_error("Cache not seeded with " + commit_oid + ": " +
+              std::get<std::string>(listing_result));
+    return;
+  }
+  const FileListing &listing = std::get<FileListing>(listing_result);
+
+  std::map<std::string, const PendingFile *> sent;
+  for (const auto &file : pending) {
+    if (!file.ignored && (!file.file.local_path.empty() || file.content)) {
+      sent[file.file.path_in_repo] = &file;
+    }
+  }
+
+  std::shared_ptr<RepoCache> cache =
+      open_repo_cache(options.cache_dir, repo_id);
+  size_t missing = 0;
+  for (size_t i = 0; i < listing.size(); ++i) {
+    std::string path(listing.path(i));
+    FileMetadata metadata = listing.metadata(i);
+    std::string blob = blob_name_of(metadata);
+    auto it = sent.find(path);
+    if (!stat_at(cache->blobs->fd, blob) && it != sent.end() &&
+        it->second->size == metadata.size) {
+      seed_blob(*cache, blob, *it->second);
+    }
+    if (!stat_at(cache->blobs->fd, blob) ||
+        !link_snapshot_file(*cache, cache->path + "blobs/" + blob,
+                            commit_oid + "/" + path)) {
+      ++missing;
+    }
+  }
+
+  if (missing > 0) {
+    log_debug("Left refs/" + options.revision + " unchanged, " +
+              std::to_string(missing) + " files of " + commit_oid +
+              " are not cached");
+    return;
+  }
+  std::filesystem::path ref = cache->path + "refs/" + options.revision;
+  std::error_code error;
+  std::filesystem::create_directories(ref.parent_path(), error);
+  if (write_file_atomically(ref, commit_oid)) {
+    forget_memory_cache_paths(repo_id);
+    log_debug("Cached commit " + commit_oid + " in " + cache->path);
+  }
+}
+
+} // namespace
+
+CommitOperation CommitOperation::add_file(const std::string &local_path,
+                                          const std::string &path_in_repo) {
+  CommitOperation operation;
+  operation.local_path = local_path;
+  operation.path_in_repo = path_in_repo;
+  return operation;
+}
+
+CommitOperation CommitOperation::add_bytes(const std::string &content,
+                                           const std::string &path_in_repo) {
+  CommitOperation operation;
+  operation.content = content;
+  operation.path_in_repo = path_in_repo;
+  return operation;
+}
+
+CommitOperation CommitOperation::delete_file(const std::string &path_in_repo) {
+  CommitOperation operation;
+  operation.type = CommitOperationType::DELETE_FILE;
+  operation.path_in_repo = path_in_repo;
+  return operation;
+}
+
+CommitOperation
+CommitOperation::delete_folder(const std::string &path_in_repo) {
+  CommitOperation operation;
+  operation.type = CommitOperationType::DELETE_FOLDER;
+  operation.path_in_repo = path_in_repo;
+  return operation;
+}
+
+CommitOperation CommitOperation::copy_file(const std::string &src_path,
+                                           const std::string &path_in_repo,
+                                           const std::string &src_revision) {
+  CommitOperation operation;
+  operation.type = CommitOperationType::COPY;
+  operation.src_path = src_path;
+  operation.path_in_repo = path_in_repo;
+  operation.src_revision = src_revision;
+  return operation;
+}
+
+UploadResult create_commit(const std::string &repo_id,
+                           const std::vector<CommitOperation> &operations,
+                           const UploadOptions &options) {
+  UploadResult result;
+  result.success = false;
+
+  std::vector<PendingFile> pending(operations.size());
+  std::vector<std::string> copied(operations.size());
+  std::vector<PendingFile *> added;
+  for (size_t i = 0; i < operations.size(); ++i) {
+    const CommitOperation &operation = operations[i];
+    pending[i].file.local_path = operation.local_path;
+    pending[i].file.path_in_repo = operation.path_in_repo;
+    if (operation.type == CommitOperationType::ADD) {
+      if (operation.local_path.empty()) {
+        pending[i].content = &operation.content;
+      }
+      added.push_back(&pending[i]);
+    }
+  }
+
+  // 1. Resolve copies and hash every added file in parallel
+  if (!resolve_copies(repo_id, operations, options, pending, copied,
+                      result)) {
+    return result;
+  }
+  if (!run_parallel(added, options.parallel_parts, hash_file, options)) {
+    result.error = "Failed to hash files";
+    return result;
+  }
+
+  // 2. Ask the Hub which added files go through LFS
+  if (!added.empty()) {
+    std::string preupload_body = "{\"files\": [";
+    for (size_t i = 0; i < added.size(); ++i) {
+      preupload_body +=
+          std::string(i > 0 ? ", " : "") + "{\"path\": \"" +
+          json_escape(added[i]->file.path_in_repo) + "\", \"sample\": \"" +
+          base64_encode(added[i]->sample.data(), added[i]->sample.size()) +
+          "\", \"size\": " + std::to_string(added[i]->size) + "}";
+    }
+    preupload_body += "]}";
+
+    std::string preupload;
+    CURLcode res = api_post(repo_api_path(repo_id, options) + "/preupload/" +
+                                options.revision,
+                            preupload_body, preupload);
+    if (res != CURLE_OK) {
+      result.error =
+          "Preupload failed: " + std::string(curl_easy_strerror(res));
+      return result;
+    }
+
+    std::map<std::string, std::string> upload_modes;
+    std::map<std::string, bool> ignored;
+    for (const auto &object :
+         split_json_objects(json_value_of(preupload, "files"))) {
+      std::string path = json_string_of(object, "path");
+      upload_modes[path] = json_string_of(object, "uploadMode");
+      ignored[path] = std::regex_search(
+          object, std::regex(R"(\"shouldIgnore\"\s*:\s*true)"));
+    }
+    for (PendingFile *file : added) {
+      file->lfs = upload_modes[file->file.path_in_repo] == "lfs";
+      file->ignored = ignored[file->file.path_in_repo];
+    }
+  }
+
+  // 3. Upload the LFS blobs the Hub does not have yet
+  std::vector<PendingFile *> lfs_files;
+  for (PendingFile *file : added) {
+    if (file->lfs && !file->ignored) {
+      lfs_files.push_back(file);
+    }
+  }
+  if (!lfs_files.empty() &&
+      !upload_lfs_files(repo_id, lfs_files, options, result)) {
+    return result;
+  }
+
+  // 4. Stream a single NDJSON commit with every operation
+  PayloadReader reader;
+  add_text(reader.segments,
+           "{\"key\": \"header\", \"value\": {\"summary\": \"" +
+               json_escape(options.commit_message) + "\", \"description\": \"" +
+               json_escape(options.commit_description) + "\"}}\n");
+  for (size_t i = 0; i < operations.size(); ++i) {
+    const PendingFile &file = pending[i];
+    const std::string &path = operations[i].path_in_repo;
+    if (operations[i].type == CommitOperationType::DELETE_FILE) {
+      add_text(reader.segments, path_value("deletedFile", path) + "}}\n");
+    } else if (operations[i].type == CommitOperationType::DELETE_FOLDER) {
+      add_text(reader.segments, path_value("deletedFolder", path) + "}}\n");
+    } else if (file.ignored) {
+      continue;
+    } else if (file.lfs) {
+      add_text(reader.segments, path_value("lfsFile", path) +
+                                    ", \"algo\": \"sha256\", \"oid\": \"" +
+                                    file.sha256 + "\", \"size\": " +
+                                    std::to_string(file.size) + "}}\n");
+    } else {
+      add_text(reader.segments,
+               path_value("file", path) + ", \"content\": \"");
+      PayloadSegment content;
+      content.data = file.mapping.data;
+      content.size = file.size;
+      reader.segments.push_back(content);
+      add_text(reader.segments, "\", \"encoding\": \"base64\"}}\n");
+    }
+  }
+
+  HttpResponse response = send_request(
+      "POST",
+      get_hf_endpoint() + repo_api_path(repo_id, options) + "/commit/" +
+          options.revision,
+      {"Content-Type: application/x-ndjson"}, "", read_payload, &reader);
+  if (response.code != CURLE_OK) {
+    result.error = request_error("Commit", response);
+    return result;
+  }
+
+  result.commit_oid = json_string_of(response.body, "commitOid");
+  result.success = true;
+  log_info("Committed " + std::to_string(operations.size()) +
+           " operations to " + repo_id + " (" + result.commit_oid + ")");
+
+  if (!options.cache_dir.empty() && options.repo_type == "model") {
+    seed_cache(repo_id, options, result.commit_oid, pending);
+  }
+  return result;
+}
+
+UploadResult upload_files(const std::string &repo_id,
+                          const std::vector<UploadFile> &files,
+                          const UploadOptions &options) {
+  std::vector<CommitOperation> operations;
+  for (const auto &file : files) {
+    operations.push_back(
+        CommitOperation::add_file(file.local_path, file.path_in_repo));
+  }
+  return create_commit(repo_id, operations, options);
+}
+
+} // namespace huggingface_hub
@@ -0,0 +1,57 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef HFHUB_TEST_CHECK_H
+#define HFHUB_TEST_CHECK_H
+
+#include <cstdio>
+
+// Minimal assertions for the test programs: a failed check is reported and
+// makes the program exit with a non-zero status
+namespace hfhub_test {
+
+inline int &failures() {
+  static int count = 0;
+  return count;
+}
+
+inline int result() {
+  if (failures() > 0) {
+    std::fprintf(stderr, "%d check(s) failed\n", failures());
+    return 1;
+  }
+  return 0;
+}
+
+} // namespace hfhub_test
+
+#define CHECK(condition)                                                       \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,    \
+                   #condition);                                                \
+      ++hfhub_test::failures();                                                \
+    }                                                                          \
+  } while (0)
+
+#endif // HFHUB_TEST_CHECK_H
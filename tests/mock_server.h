@@ -0,0 +1,120 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef HFHUB_TEST_MOCK_SERVER_H
+#define HFHUB_TEST_MOCK_SERVER_H
+
+#include <csignal>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace hfhub_test {
+
+// A mock server from tests/mocks, run with Python. The script listens on an
+// ephemeral port and prints it on its first line; the server is stopped
+// when the object goes out of scope.
+class MockServer {
+public:
+  explicit MockServer(const std::string &script,
+                      const std::vector<std::string> &args = {},
+                      const std::map<std::string, std::string> &env = {}) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+      return;
+    }
+    pid_ = fork();
+    if (pid_ == 0) {
+      dup2(fds[1], STDOUT_FILENO);
+      close(fds[0]);
+      close(fds[1]);
+      for (const auto &variable : env) {
+        setenv(variable.first.c_str(), variable.second.c_str(), 1);
+      }
+      std::string path = std::string(HFHUB_TEST_MOCKS) + "/" + script;
+      std::vector<char *> argv = {const_cast<char *>(HFHUB_TEST_PYTHON),
+                                  const_cast<char *>(path.c_str())};
+      for (const auto &arg : args) {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+      }
+      argv.push_back(nullptr);
+      execv(HFHUB_TEST_PYTHON, argv.data());
+      _exit(127);
+    }
+    close(fds[1]);
+    FILE *out = fdopen(fds[0], "r");
+    if (!out || fscanf(out, "%d", &port_) != 1) {
+      port_ = 0;
+    }
+    if (out) {
+      fclose(out);
+    }
+  }
+
+  ~MockServer() {
+    if (pid_ > 0) {
+      kill(pid_, SIGTERM);
+      waitpid(pid_, nullptr, 0);
+    }
+  }
+
+  MockServer(const MockServer &) = delete;
+  MockServer &operator=(const MockServer &) = delete;
+
+  bool started() const { return port_ > 0; }
+  int port() const { return port_; }
+  std::string url() const {
+    return "http://127.0.0.1:" + std::to_string(port_);
+  }
+
+private:
+  pid_t pid_ = -1;
+  int port_ = 0;
+};
+
+inline size_t append_body(char *data, size_t size, size_t count,
+                          void *body) {
+  static_cast<std::string *>(body)->append(data, size * count);
+  return size * count;
+}
+
+// Body of a GET request, empty if it failed
+inline std::string http_get(const std::string &url) {
+  std::string body;
+  CURL *curl = curl_easy_init();
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, append_body);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+  CURLcode res = curl_easy_perform(curl);
+  curl_easy_cleanup(curl);
+  return res == CURLE_OK ? body : "";
+}
+
+} // namespace hfhub_test
+
+#endif // HFHUB_TEST_MOCK_SERVER_H
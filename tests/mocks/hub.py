@@ -0,0 +1,154 @@
+# MIT License
+#
+# Copyright (c) 2025 Alejandro González Cantón
+# Copyright (c) 2025 Miguel Ángel González Santamarta
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+"""Hub stand-in for the upload tests.
+
+The repository name picks how the LFS batch endpoint answers: "basic" and
+"multipart" ask for the blob, "existing" reports it stored, "error" refuses
+it and "missing" leaves it out. Every request is logged and served back
+from GET /_log.
+"""
+
+import hashlib
+import http.server
+import json
+import re
+import threading
+
+lock = threading.Lock()
+requests = []
+parts = {}
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def read_body(self):
+        if self.headers.get("Transfer-Encoding") == "chunked":
+            data = b""
+            while True:
+                size = int(self.rfile.readline().strip(), 16)
+                if size == 0:
+                    self.rfile.readline()
+                    return data
+                data += self.rfile.read(size)
+                self.rfile.readline()
+        return self.rfile.read(int(self.headers.get("Content-Length", 0)))
+
+    def reply(self, body=b"", status=200, headers=None):
+        if not isinstance(body, bytes):
+            body = json.dumps(body).encode()
+        self.send_response(status)
+        for name, value in (headers or {}).items():
+            self.send_header(name, value)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log(self, line):
+        with lock:
+            requests.append(line)
+
+    def mode(self):
+        match = re.search(r"/test/(\w+)", self.path)
+        return match.group(1) if match else ""
+
+    def base(self):
+        return "http://%s:%d" % self.server.server_address
+
+    def do_GET(self):
+        if self.path == "/_log":
+            with lock:
+                self.reply("\n".join(requests).encode())
+        else:
+            self.reply({"error": "not found"}, 404)
+
+    def do_POST(self):
+        body = self.read_body()
+        self.log("POST " + self.path)
+        if "/preupload/" in self.path:
+            files = json.loads(body)["files"]
+            self.reply({"files": [{
+                "path": f["path"],
+                "uploadMode": "lfs" if f["size"] > 64 else "regular",
+                "shouldIgnore": False} for f in files]})
+        elif self.path.endswith("/info/lfs/objects/batch"):
+            self.reply({"transfer": "basic", "objects": [
+                obj for obj in map(self.batch_object,
+                                   json.loads(body)["objects"])
+                if obj is not None]})
+        elif self.path.startswith("/complete/"):
+            oid = self.path.split("/")[-1]
+            numbers = sorted(p["partNumber"] for p in json.loads(body)["parts"])
+            with lock:
+                data = b"".join(parts.pop((oid, n), b"") for n in numbers)
+            self.log("STORED %s %s" % (
+                oid, hashlib.sha256(data).hexdigest() == oid))
+            self.reply({})
+        elif "/commit/" in self.path:
+            self.reply({"commitOid": "c" * 40, "commitUrl": self.base()})
+        else:
+            self.reply({"error": "not found"}, 404)
+
+    def do_PUT(self):
+        data = self.read_body()
+        self.log("PUT " + self.path)
+        fields = self.path.split("/")
+        if fields[1] == "part":
+            with lock:
+                parts[(fields[2], int(fields[3]))] = data
+            self.reply(headers={"ETag": '"%s"' % fields[3]})
+        else:
+            oid = fields[-1]
+            self.log("STORED %s %s" % (
+                oid, hashlib.sha256(data).hexdigest() == oid))
+            self.reply()
+
+    def batch_object(self, request):
+        oid, size = request["oid"], request["size"]
+        answer = {"oid": oid, "size": size}
+        mode = self.mode()
+        if mode == "missing":
+            return None
+        if mode == "error":
+            answer["error"] = {"code": 422, "message": "size too large"}
+        elif mode == "multipart":
+            chunk = 100
+            header = {"chunk_size": str(chunk)}
+            for number in range(1, (size + chunk - 1) // chunk + 1):
+                header["%05d" % number] = "%s/part/%s/%d" % (
+                    self.base(), oid, number)
+            answer["actions"] = {"upload": {
+                "href": self.base() + "/complete/" + oid, "header": header}}
+        elif mode == "basic":
+            answer["actions"] = {"upload": {
+                "href": self.base() + "/basic/" + oid}}
+        return answer
+
+    def log_message(self, *args):
+        pass
+
+
+server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+print(server.server_address[1], flush=True)
+server.serve_forever()
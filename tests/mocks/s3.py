@@ -0,0 +1,171 @@
+# MIT License
+#
+# Copyright (c) 2025 Alejandro González Cantón
+# Copyright (c) 2025 Miguel Ángel González Santamarta
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+"""S3 stand-in for the object store tests, in the way MinIO answers.
+
+Requests must carry a valid AWS Signature Version 4 for the minio/minio123
+key pair. Objects are kept in memory, with multipart uploads, ranged gets
+and conditional puts (If-Match and If-None-Match: *). GET /_log lists the
+requests received.
+"""
+
+import hashlib
+import hmac
+import http.server
+import re
+import threading
+import urllib.parse
+import uuid
+
+ACCESS_KEY, SECRET_KEY = "minio", "minio123"
+
+lock = threading.Lock()
+objects = {}
+uploads = {}
+requests = []
+
+
+def etag(data):
+    return '"%s"' % hashlib.md5(data).hexdigest()
+
+
+def signature(method, path, query, headers, signed, payload_hash, date,
+              region):
+    canonical_query = "&".join(sorted(query.split("&"))) if query else ""
+    canonical_headers = "".join(
+        "%s:%s\n" % (name, headers[name].strip()) for name in signed)
+    canonical_request = "\n".join([method, path, canonical_query,
+                                   canonical_headers, ";".join(signed),
+                                   payload_hash])
+    scope = "%s/%s/s3/aws4_request" % (date[:8], region)
+    string_to_sign = "\n".join([
+        "AWS4-HMAC-SHA256", date, scope,
+        hashlib.sha256(canonical_request.encode()).hexdigest()])
+    key = ("AWS4" + SECRET_KEY).encode()
+    for part in (date[:8], region, "s3", "aws4_request"):
+        key = hmac.new(key, part.encode(), hashlib.sha256).digest()
+    return hmac.new(key, string_to_sign.encode(), hashlib.sha256).hexdigest()
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def reply(self, status, body=b"", headers=None):
+        self.send_response(status)
+        headers = dict(headers or {})
+        headers.setdefault("Content-Length", str(len(body)))
+        for name, value in headers.items():
+            self.send_header(name, value)
+        self.end_headers()
+        if self.command != "HEAD":
+            self.wfile.write(body)
+
+    def authorized(self, path, query, body):
+        headers = {k.lower(): v for k, v in self.headers.items()}
+        match = re.match(
+            r"AWS4-HMAC-SHA256 Credential=([^/]+)/\d+/([^/]+)/s3/aws4_request,"
+            r" SignedHeaders=([^,]+), Signature=(\w+)",
+            headers.get("authorization", ""))
+        payload_hash = headers.get("x-amz-content-sha256", "")
+        if not match or match.group(1) != ACCESS_KEY:
+            return False
+        expected = signature(self.command, path, query, headers,
+                             match.group(3).split(";"), payload_hash,
+                             headers.get("x-amz-date", ""), match.group(2))
+        if expected != match.group(4):
+            return False
+        return payload_hash == "UNSIGNED-PAYLOAD" or \
+            hashlib.sha256(body).hexdigest() == payload_hash
+
+    def handle_request(self):
+        url = urllib.parse.urlsplit(self.path)
+        body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        if url.path == "/_log":
+            with lock:
+                return self.reply(200, "\n".join(requests).encode())
+        with lock:
+            requests.append("%s %s %s" % (self.command, url.path, url.query))
+        if not self.authorized(url.path, url.query, body):
+            return self.reply(403, b"<Error>SignatureDoesNotMatch</Error>")
+
+        key = urllib.parse.unquote(url.path)
+        query = urllib.parse.parse_qs(url.query, keep_blank_values=True)
+        if self.command == "PUT" and "partNumber" in query:
+            with lock:
+                uploads[query["uploadId"][0]][int(query["partNumber"][0])] = \
+                    body
+            return self.reply(200, headers={"ETag": etag(body)})
+        if self.command == "PUT":
+            with lock:
+                current = objects.get(key)
+                if_match = self.headers.get("If-Match")
+                if (if_match and (current is None or
+                                  etag(current) != if_match)) or \
+                        (self.headers.get("If-None-Match") == "*" and
+                         current is not None):
+                    requests.append("PRECONDITION FAILED " + key)
+                    return self.reply(412,
+                                      b"<Error>PreconditionFailed</Error>")
+                objects[key] = body
+            return self.reply(200, headers={"ETag": etag(body)})
+        if self.command == "POST" and "uploads" in query:
+            upload_id = uuid.uuid4().hex
+            with lock:
+                uploads[upload_id] = {}
+            return self.reply(200, (
+                "<InitiateMultipartUploadResult><UploadId>%s</UploadId>"
+                "</InitiateMultipartUploadResult>" % upload_id).encode())
+        if self.command == "POST" and "uploadId" in query:
+            numbers = [int(n) for n in re.findall(
+                r"<PartNumber>(\d+)</PartNumber>", body.decode())]
+            with lock:
+                parts = uploads.pop(query["uploadId"][0])
+                objects[key] = b"".join(parts[n] for n in numbers)
+            return self.reply(200, b"<CompleteMultipartUploadResult/>")
+        if self.command == "DELETE":
+            with lock:
+                uploads.pop(query.get("uploadId", [""])[0], None)
+            return self.reply(204)
+
+        with lock:
+            data = objects.get(key)
+        if data is None:
+            return self.reply(404, b"<Error>NoSuchKey</Error>")
+        if self.command == "HEAD":
+            return self.reply(200, headers={"Content-Length": str(len(data)),
+                                            "ETag": etag(data)})
+        match = re.match(r"bytes=(\d+)-(\d+)", self.headers.get("Range", ""))
+        if match:
+            first, last = int(match.group(1)), int(match.group(2))
+            return self.reply(206, data[first:last + 1])
+        return self.reply(200, data, {"ETag": etag(data)})
+
+    do_GET = do_PUT = do_POST = do_HEAD = do_DELETE = handle_request
+
+    def log_message(self, *args):
+        pass
+
+
+server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+print(server.server_address[1], flush=True)
+server.serve_forever()
@@ -0,0 +1,107 @@
+# MIT License
+#
+# Copyright (c) 2025 Alejandro González Cantón
+# Copyright (c) 2025 Miguel Ángel González Santamarta
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+"""Origin and lying peer for the swarm tests.
+
+"origin <size> <chunk size>" serves one LFS file, blob.bin, whose byte at
+offset i is i % 256, with ranged gets slowed down so that peers are worth
+asking. "liar <size> <chunk size>" is a swarm peer that lists chunk hashes
+of bytes that are not the file, and serves those bytes. GET /_log lists the
+ranges and chunks served.
+"""
+
+import hashlib
+import http.server
+import json
+import re
+import sys
+import threading
+import time
+
+role = sys.argv[1]
+size, chunk_size = int(sys.argv[2]), int(sys.argv[3])
+data = (bytes(range(256)) * (size // 256 + 1))[:size]
+sha256 = hashlib.sha256(data).hexdigest()
+lock = threading.Lock()
+served = []
+
+
+def fake_chunk(index):
+    return b"x" * min(chunk_size, size - index * chunk_size)
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def reply(self, body, status=200):
+        self.send_response(status)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log(self, line):
+        with lock:
+            served.append(line)
+
+    def do_POST(self):
+        request = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        paths = json.loads(request)["paths"] if "/paths-info/" in self.path \
+            else []
+        self.reply(json.dumps([{
+            "type": "file", "path": path, "oid": "e" * 40, "size": size,
+            "lfs": {"oid": sha256, "size": size},
+            "lastCommit": {"id": "b" * 40}} for path in paths]).encode())
+
+    def do_GET(self):
+        if self.path == "/_log":
+            with lock:
+                return self.reply("\n".join(served).encode())
+        if role == "liar":
+            return self.serve_lies()
+        match = re.match(r"bytes=(\d+)-(\d+)", self.headers.get("Range", ""))
+        if not match:
+            self.log("FULL")
+            return self.reply(data)
+        first, last = int(match.group(1)), int(match.group(2))
+        self.log("RANGE %d-%d" % (first, last))
+        time.sleep(0.05)
+        self.reply(data[first:last + 1], 206)
+
+    def serve_lies(self):
+        count = (size + chunk_size - 1) // chunk_size
+        if self.path.endswith("/have"):
+            lines = ["%d %d 0" % (chunk_size, size)] + [
+                "%d %s" % (i, hashlib.sha256(fake_chunk(i)).hexdigest())
+                for i in range(count)]
+            return self.reply(("\n".join(lines) + "\n").encode())
+        index = int(self.path.rsplit("/", 1)[1])
+        self.log("CHUNK %d" % index)
+        self.reply(fake_chunk(index))
+
+    def log_message(self, *args):
+        pass
+
+
+server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+print(server.server_address[1], flush=True)
+server.serve_forever()
@@ -0,0 +1,89 @@
+# MIT License
+#
+# Copyright (c) 2025 Alejandro González Cantón
+# Copyright (c) 2025 Miguel Ángel González Santamarta
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in
+# all copies or substantial portions of the Software.
+
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+"""Hub stand-in over TLS for the kernel TLS tests.
+
+Serves one LFS file, model.bin, of the size in MiB given as argument, whose
+byte at offset i is i % 251. The certificate is the self-signed
+localhost.crt next to this script.
+"""
+
+import hashlib
+import http.server
+import json
+import os
+import re
+import ssl
+import sys
+
+here = os.path.dirname(os.path.abspath(__file__))
+size = int(sys.argv[1]) << 20
+pattern = bytes(range(251))
+data = (pattern * (size // len(pattern) + 1))[:size]
+sha256 = hashlib.sha256(data).hexdigest()
+
+
+class Handler(http.server.BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def reply(self, body, status=200, headers=None):
+        self.send_response(status)
+        for name, value in (headers or {}).items():
+            self.send_header(name, value)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_POST(self):
+        request = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+        paths = json.loads(request)["paths"] if "/paths-info/" in self.path \
+            else []
+        self.reply(json.dumps([{
+            "type": "file", "path": path, "oid": "d" * 40, "size": size,
+            "lfs": {"oid": sha256, "size": size},
+            "lastCommit": {"id": "b" * 40}} for path in paths]).encode())
+
+    def do_GET(self):
+        if not self.path.endswith("/resolve/main/model.bin"):
+            self.reply(b"{}", 404)
+            return
+        match = re.match(r"bytes=(\d+)-(\d*)", self.headers.get("Range", ""))
+        if not match:
+            self.reply(data)
+            return
+        first = int(match.group(1))
+        last = min(int(match.group(2) or size - 1), size - 1)
+        self.reply(data[first:last + 1], 206, {
+            "Content-Range": "bytes %d-%d/%d" % (first, last, size)})
+
+    def log_message(self, *args):
+        pass
+
+
+server = http.server.ThreadingHTTPServer(("127.0.0.1", 0), Handler)
+context = ssl.SSLContext(ssl.PROTOCOL_TLS_SERVER)
+context.load_cert_chain(os.path.join(here, "localhost.crt"),
+                        os.path.join(here, "localhost.key"))
+server.socket = context.wrap_socket(server.socket, server_side=True)
+print(server.server_address[1], flush=True)
+server.serve_forever()
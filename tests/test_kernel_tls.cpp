@@ -0,0 +1,119 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+
+#include "check.h"
+#include "huggingface_hub.h"
+#include "mock_server.h"
+
+using namespace huggingface_hub;
+using hfhub_test::MockServer;
+
+namespace {
+
+const int FILE_MIB = 64;
+
+std::string work_dir;
+
+// The served file holds i % 251 at offset i
+bool has_pattern(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  uint64_t size = uint64_t(FILE_MIB) << 20;
+  for (uint64_t offset : {uint64_t(0), uint64_t(1) << 20, size - 1}) {
+    char byte;
+    in.seekg(offset);
+    if (!in.get(byte) ||
+        static_cast<unsigned char>(byte) != offset % 251) {
+      return false;
+    }
+  }
+  return std::filesystem::file_size(path) == size;
+}
+
+// Downloads the file into a fresh cache and reports the time it took, as a
+// local benchmark of the TLS receive path
+void download(bool kernel_tls) {
+  TransportConfig config;
+  config.ca_bundle = std::string(HFHUB_TEST_MOCKS) + "/localhost.crt";
+  config.kernel_tls = kernel_tls;
+  set_transport_config(config);
+  std::string cache = work_dir + (kernel_tls ? "/ktls" : "/user");
+
+  auto start = std::chrono::steady_clock::now();
+  std::clock_t cpu_start = std::clock();
+  DownloadResult result = hf_hub_download("test/tls", "model.bin", cache);
+  double cpu = double(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+  double wall = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now() - start)
+                    .count();
+
+  CHECK(result.success);
+  CHECK(result.success && has_pattern(result.path));
+  std::printf("%s: %d MiB in %.2f s, %.2f s of CPU\n",
+              kernel_tls ? "kTLS requested" : "user space TLS", FILE_MIB, wall,
+              cpu);
+}
+
+void test_user_space_tls() {
+  KernelTlsStats before = get_kernel_tls_stats();
+  download(false);
+  KernelTlsStats after = get_kernel_tls_stats();
+  CHECK(after.handshakes == before.handshakes);
+}
+
+// Whether the kernel takes the records over depends on curl, OpenSSL and the
+// kernel; the download must work either way and the stats stay consistent
+void test_kernel_tls() {
+  download(true);
+  KernelTlsStats stats = get_kernel_tls_stats();
+  CHECK(stats.receive_offloaded <= stats.handshakes);
+  CHECK(stats.send_offloaded <= stats.handshakes);
+  std::printf("kTLS handshakes %zu, receive offloaded %zu, send offloaded "
+              "%zu\n",
+              stats.handshakes, stats.receive_offloaded, stats.send_offloaded);
+}
+
+} // namespace
+
+int main() {
+  MockServer hub("tls_hub.py", {std::to_string(FILE_MIB)});
+  CHECK(hub.started());
+  if (!hub.started()) {
+    return hfhub_test::result();
+  }
+  std::string endpoint = "https://127.0.0.1:" + std::to_string(hub.port());
+  setenv("HF_ENDPOINT", endpoint.c_str(), 1);
+  char dir[] = "/tmp/hfhub-test-tls-XXXXXX";
+  work_dir = mkdtemp(dir);
+
+  test_user_space_tls();
+  test_kernel_tls();
+
+  std::filesystem::remove_all(work_dir);
+  return hfhub_test::result();
+}
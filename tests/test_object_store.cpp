@@ -0,0 +1,160 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#include "check.h"
+#include "huggingface_hub.h"
+#include "mock_server.h"
+
+using namespace huggingface_hub;
+using hfhub_test::MockServer;
+
+namespace {
+
+const std::string REPO = "test/store";
+
+std::string work_dir;
+
+std::string read_file(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::string(std::istreambuf_iterator<char>(in), {});
+}
+
+std::string write_file(const std::string &name, size_t size) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<char>(i * 7 % 253);
+  }
+  std::string path = work_dir + "/" + name;
+  std::ofstream(path, std::ios::binary) << data;
+  return path;
+}
+
+bool contains(const std::string &text, const std::string &part) {
+  return text.find(part) != std::string::npos;
+}
+
+std::shared_ptr<StorageBackend> open_store(const MockServer &s3) {
+  ObjectStoreConfig config;
+  config.endpoint = s3.url();
+  config.bucket = "cache";
+  config.prefix = "hub/";
+  config.access_key = "minio";
+  config.secret_key = "minio123";
+  config.part_size = 5 * 1024 * 1024;
+  return create_object_storage(config);
+}
+
+void test_small_blob(StorageBackend &store) {
+  std::string path = write_file("small", 1000);
+  CHECK(!store.stat_blob(REPO, "small"));
+  CHECK(store.put_blob(REPO, "small", path));
+  uint64_t size = 0;
+  CHECK(store.stat_blob(REPO, "small", &size));
+  CHECK(size == 1000);
+  CHECK(store.get_blob(REPO, "small", work_dir + "/small.copy"));
+  CHECK(read_file(work_dir + "/small.copy") == read_file(path));
+}
+
+// Twelve MiB go out as three multipart parts and come back as ranged gets
+void test_multipart_blob(StorageBackend &store, const MockServer &s3) {
+  std::string path = write_file("large", 12 * 1024 * 1024);
+  CHECK(store.put_blob(REPO, "large", path));
+  std::string requests = hfhub_test::http_get(s3.url() + "/_log");
+  CHECK(contains(requests, "partNumber=3"));
+  CHECK(store.get_blob(REPO, "large", work_dir + "/large.copy"));
+  std::string data = read_file(path);
+  CHECK(read_file(work_dir + "/large.copy") == data);
+
+  std::string range;
+  CHECK(store.read_blob_range(REPO, "large", 5 * 1024 * 1024 - 3, 6, range));
+  CHECK(range == data.substr(5 * 1024 * 1024 - 3, 6));
+}
+
+void test_refs(StorageBackend &store) {
+  CHECK(store.read_ref(REPO, "main").empty());
+  CHECK(store.write_ref(REPO, "main", std::string(40, 'a')));
+  CHECK(store.read_ref(REPO, "main") == std::string(40, 'a'));
+}
+
+// Writers merging into one manifest at once must not drop each other's files
+void test_concurrent_merges(StorageBackend &store, const MockServer &s3) {
+  std::string commit(40, 'c');
+  std::vector<std::thread> writers;
+  std::vector<char> merged(8);
+  for (size_t i = 0; i < merged.size(); ++i) {
+    writers.emplace_back([&, i]() {
+      merged[i] = store.merge_manifest(
+          REPO, commit,
+          {{"file" + std::to_string(i), "blob" + std::to_string(i)}});
+    });
+  }
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  for (char ok : merged) {
+    CHECK(ok);
+  }
+
+  SnapshotManifest manifest;
+  CHECK(store.read_manifest(REPO, commit, manifest));
+  CHECK(manifest.size() == merged.size());
+  CHECK(manifest["file3"] == "blob3");
+
+  CHECK(store.merge_manifest(REPO, commit, {{"file3", "blob9"}}));
+  CHECK(store.read_manifest(REPO, commit, manifest));
+  CHECK(manifest.size() == merged.size());
+  CHECK(manifest["file3"] == "blob9");
+
+  std::string requests = hfhub_test::http_get(s3.url() + "/_log");
+  std::printf("Concurrent merges retried %s\n",
+              contains(requests, "PRECONDITION FAILED") ? "after a conflict"
+                                                        : "never");
+}
+
+} // namespace
+
+int main() {
+  MockServer s3("s3.py");
+  CHECK(s3.started());
+  if (!s3.started()) {
+    return hfhub_test::result();
+  }
+  char dir[] = "/tmp/hfhub-test-store-XXXXXX";
+  work_dir = mkdtemp(dir);
+  std::shared_ptr<StorageBackend> store = open_store(s3);
+
+  test_small_blob(*store);
+  test_multipart_blob(*store, s3);
+  test_refs(*store);
+  test_concurrent_merges(*store, s3);
+
+  std::filesystem::remove_all(work_dir);
+  return hfhub_test::result();
+}
@@ -0,0 +1,105 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "check.h"
+#include "huggingface_hub.h"
+
+using huggingface_hub::PatternSet;
+
+namespace {
+
+bool matches(const std::string &pattern, const std::string &path) {
+  return PatternSet({pattern}).matches(path);
+}
+
+void test_names_match_whole_names() {
+  CHECK(matches("tokenizer.json", "tokenizer.json"));
+  CHECK(matches("tokenizer.json", "sub/dir/tokenizer.json"));
+  CHECK(!matches("tokenizer.json", "xtokenizer.json"));
+  CHECK(!matches("tokenizer.json", "sub/xtokenizer.json"));
+  CHECK(!matches("config.json", "adapter_config.json"));
+}
+
+void test_globstar_segments() {
+  CHECK(matches("**/config.json", "config.json"));
+  CHECK(matches("**/config.json", "a/b/config.json"));
+  CHECK(!matches("**/config.json", "myconfig.json"));
+  CHECK(!matches("**/config.json", "a/myconfig.json"));
+  CHECK(matches("a/**/b", "a/b"));
+  CHECK(matches("a/**/b", "a/x/y/b"));
+  CHECK(!matches("a/**/b", "a/xb"));
+  CHECK(matches("**", "any/path"));
+}
+
+void test_stars_stay_in_names() {
+  CHECK(matches("a*.json", "a.json"));
+  CHECK(matches("a*.json", "abc.json"));
+  CHECK(matches("a*.json", "dir/ab.json"));
+  CHECK(!matches("a*.json", "ba.json"));
+  CHECK(!matches("a*.json", "dir/ba.json"));
+  CHECK(!matches("*.json", "dir/x.bin"));
+}
+
+void test_filters() {
+  PatternSet allow = PatternSet::from_filters({"config.json"}, {});
+  CHECK(allow.matches("config.json"));
+  CHECK(!allow.matches("adapter_config.json"));
+
+  PatternSet ignore = PatternSet::from_filters({}, {"*.bin"});
+  CHECK(ignore.matches("model.safetensors"));
+  CHECK(ignore.matches("model.bin.json"));
+  CHECK(!ignore.matches("sub/model.bin"));
+}
+
+void test_directories() {
+  PatternSet set({"onnx/"});
+  CHECK(set.matches("onnx/model.onnx"));
+  CHECK(!set.matches("myonnx/model.onnx"));
+  CHECK(set.may_match_under("onnx"));
+
+  PatternSet root({"/config.json"});
+  CHECK(root.matches("config.json"));
+  CHECK(!root.matches("sub/config.json"));
+  CHECK(!root.may_match_under("sub"));
+}
+
+void test_escapes() {
+  CHECK(matches("/\\!important.txt", "!important.txt"));
+  CHECK(!matches("/\\!important.txt", "sub/!important.txt"));
+  CHECK(matches("/a\\\\b", "a\\b"));
+  CHECK(matches("/\\*.bin", "*.bin"));
+  CHECK(!matches("/\\*.bin", "model.bin"));
+  CHECK(!PatternSet({"/d/\\[x].bin"}).may_match_under("e"));
+}
+
+} // namespace
+
+int main() {
+  test_names_match_whole_names();
+  test_globstar_segments();
+  test_stars_stay_in_names();
+  test_filters();
+  test_directories();
+  test_escapes();
+  return hfhub_test::result();
+}
@@ -0,0 +1,177 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdlib>
+#include <filesystem>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "check.h"
+#include "huggingface_hub.h"
+#include "mock_server.h"
+
+using namespace huggingface_hub;
+using hfhub_test::MockServer;
+
+namespace {
+
+const uint64_t CHUNK_SIZE = 1024 * 1024;
+const uint64_t BLOB_SIZE = 8 * CHUNK_SIZE + 123;
+
+std::string work_dir;
+
+// A port nothing listens on right now, for a node to serve chunks on
+int free_port() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t length = sizeof(address);
+  int port = 0;
+  if (bind(fd, reinterpret_cast<sockaddr *>(&address), length) == 0 &&
+      getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length) == 0) {
+    port = ntohs(address.sin_port);
+  }
+  close(fd);
+  return port;
+}
+
+std::string peer(int port) { return "127.0.0.1:" + std::to_string(port); }
+
+struct NodeReport {
+  int success = 0;
+  size_t from_peers = 0;
+  size_t from_origin = 0;
+  size_t rejected = 0;
+};
+
+// A swarm node in its own process. It downloads the blob, reports its
+// swarm stats and keeps serving chunks until it is stopped.
+class Node {
+public:
+  Node(int port, const std::vector<std::string> &peers) {
+    int report[2], control[2];
+    if (pipe(report) != 0 || pipe(control) != 0) {
+      return;
+    }
+    pid_ = fork();
+    if (pid_ == 0) {
+      close(report[0]);
+      close(control[1]);
+      SwarmConfig config;
+      config.enabled = true;
+      config.listen_port = port;
+      config.peers = peers;
+      config.chunk_size = CHUNK_SIZE;
+      config.parallel_chunks = 4;
+      bool success =
+          set_swarm_config(config) &&
+          hf_hub_download("test/swarm", "blob.bin",
+                          work_dir + "/node" + std::to_string(port))
+              .success;
+      SwarmStats stats = get_swarm_stats();
+      dprintf(report[1], "%d %zu %zu %zu\n", success ? 1 : 0,
+              stats.chunks_from_peers, stats.chunks_from_origin,
+              stats.chunks_rejected);
+      close(report[1]);
+      char byte;
+      while (read(control[0], &byte, 1) > 0) {
+      }
+      _exit(0);
+    }
+    close(report[1]);
+    close(control[0]);
+    report_fd_ = report[0];
+    control_fd_ = control[1];
+  }
+
+  ~Node() {
+    if (pid_ > 0) {
+      close(control_fd_);
+      waitpid(pid_, nullptr, 0);
+    }
+  }
+
+  NodeReport wait_report() {
+    NodeReport report;
+    FILE *in = fdopen(report_fd_, "r");
+    if (!in || fscanf(in, "%d %zu %zu %zu", &report.success,
+                      &report.from_peers, &report.from_origin,
+                      &report.rejected) != 4) {
+      report.success = 0;
+    }
+    if (in) {
+      fclose(in);
+    }
+    return report;
+  }
+
+private:
+  pid_t pid_ = -1;
+  int report_fd_ = -1;
+  int control_fd_ = -1;
+};
+
+} // namespace
+
+int main() {
+  std::string size = std::to_string(BLOB_SIZE);
+  std::string chunk = std::to_string(CHUNK_SIZE);
+  MockServer origin("swarm.py", {"origin", size, chunk});
+  MockServer liar("swarm.py", {"liar", size, chunk});
+  CHECK(origin.started() && liar.started());
+  if (!origin.started() || !liar.started()) {
+    return hfhub_test::result();
+  }
+  setenv("HF_ENDPOINT", origin.url().c_str(), 1);
+  char dir[] = "/tmp/hfhub-test-swarm-XXXXXX";
+  work_dir = mkdtemp(dir);
+  int a = free_port(), b = free_port(), c = free_port();
+
+  // Alone with the liar, whose single word is not enough to trust a chunk
+  Node first(a, {peer(b), peer(c), peer(liar.port())});
+  NodeReport report = first.wait_report();
+  CHECK(report.success);
+  CHECK(report.from_peers == 0);
+  CHECK(report.from_origin == 9);
+
+  // The first node holds the verified blob, whose hashes outvote the liar
+  Node second(b, {peer(a), peer(c), peer(liar.port())});
+  Node third(c, {peer(a), peer(b), peer(liar.port())});
+  size_t from_peers = 0;
+  for (Node *node : {&second, &third}) {
+    report = node->wait_report();
+    CHECK(report.success);
+    CHECK(report.rejected == 0);
+    from_peers += report.from_peers;
+  }
+  CHECK(from_peers > 0);
+  std::printf("Later nodes fetched %zu of 18 chunks from peers\n", from_peers);
+
+  std::string lies = hfhub_test::http_get(liar.url() + "/_log");
+  CHECK(lies.find("CHUNK") == std::string::npos);
+
+  std::filesystem::remove_all(work_dir);
+  return hfhub_test::result();
+}
@@ -0,0 +1,135 @@
+// MIT License
+//
+// Copyright (c) 2025 Alejandro González Cantón
+// Copyright (c) 2025 Miguel Ángel González Santamarta
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+#include "check.h"
+#include "huggingface_hub.h"
+#include "mock_server.h"
+
+using namespace huggingface_hub;
+using hfhub_test::MockServer;
+
+namespace {
+
+std::string work_dir;
+
+// Requests the hub received since the last call
+std::string new_requests(const MockServer &hub) {
+  static size_t seen = 0;
+  std::string log = hfhub_test::http_get(hub.url() + "/_log");
+  std::string added = log.substr(std::min(seen, log.size()));
+  seen = log.size();
+  return added;
+}
+
+bool contains(const std::string &text, const std::string &part) {
+  return text.find(part) != std::string::npos;
+}
+
+// Uploads a 1000-byte LFS file and a small regular one to test/<mode>, whose
+// name tells the hub how to answer the LFS batch
+UploadResult upload(const std::string &mode) {
+  std::string lfs = work_dir + "/" + mode + ".bin";
+  std::string regular = work_dir + "/" + mode + ".txt";
+  std::ofstream(lfs) << mode << std::string(1000 - mode.size(), 'x');
+  std::ofstream(regular) << mode;
+  return upload_files("test/" + mode,
+                      {{lfs, "weights.bin"}, {regular, "notes.txt"}});
+}
+
+void test_basic_upload(const MockServer &hub) {
+  UploadResult result = upload("basic");
+  std::string requests = new_requests(hub);
+  CHECK(result.success);
+  CHECK(result.files_uploaded == 1);
+  CHECK(result.bytes_uploaded == 1000);
+  CHECK(contains(requests, "PUT /basic/"));
+  CHECK(contains(requests, " True"));
+  CHECK(!contains(requests, " False"));
+  CHECK(contains(requests, "POST /api/models/test/basic/commit/main"));
+}
+
+void test_multipart_upload(const MockServer &hub) {
+  UploadResult result = upload("multipart");
+  std::string requests = new_requests(hub);
+  CHECK(result.success);
+  CHECK(result.files_uploaded == 1);
+  CHECK(contains(requests, "PUT /part/"));
+  CHECK(contains(requests, " True"));
+  CHECK(!contains(requests, " False"));
+  CHECK(contains(requests, "POST /api/models/test/multipart/commit/main"));
+}
+
+void test_existing_blob(const MockServer &hub) {
+  UploadResult result = upload("existing");
+  std::string requests = new_requests(hub);
+  CHECK(result.success);
+  CHECK(result.files_uploaded == 0);
+  CHECK(result.files_deduplicated == 1);
+  CHECK(!contains(requests, "PUT "));
+  CHECK(contains(requests, "POST /api/models/test/existing/commit/main"));
+}
+
+// A commit must never reference a blob the storage did not take
+void test_refused_blob(const MockServer &hub) {
+  UploadResult result = upload("error");
+  std::string requests = new_requests(hub);
+  CHECK(!result.success);
+  CHECK(result.files_deduplicated == 0);
+  CHECK(contains(result.error, "weights.bin"));
+  CHECK(contains(result.error, "size too large"));
+  CHECK(!contains(requests, "/commit/"));
+}
+
+void test_unanswered_blob(const MockServer &hub) {
+  UploadResult result = upload("missing");
+  std::string requests = new_requests(hub);
+  CHECK(!result.success);
+  CHECK(contains(result.error, "weights.bin"));
+  CHECK(!contains(requests, "/commit/"));
+}
+
+} // namespace
+
+int main() {
+  MockServer hub("hub.py");
+  CHECK(hub.started());
+  if (!hub.started()) {
+    return hfhub_test::result();
+  }
+  setenv("HF_ENDPOINT", hub.url().c_str(), 1);
+  char dir[] = "/tmp/hfhub-test-upload-XXXXXX";
+  work_dir = mkdtemp(dir);
+
+  test_basic_upload(hub);
+  test_multipart_upload(hub);
+  test_existing_blob(hub);
+  test_refused_blob(hub);
+  test_unanswered_blob(hub);
+
+  std::filesystem::remove_all(work_dir);
+  return hfhub_test::result();
+}